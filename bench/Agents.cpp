@@ -0,0 +1,101 @@
+// Multi-agent benchmark: N agents between random free cells of one grid,
+// planned independently with A* (which lets them collide), with Cooperative
+// A* and with Windowed Hierarchical Cooperative A* at several windows.
+// Reports the planning time, space-time expansions, makespan, sum of costs,
+// the agents that arrived, the conflicts left and the reservation table size.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "Cooperative.hpp"
+#include "Engines.hpp"
+
+int main(int argc, char** argv)
+{
+    i32 size = argc > 1 ? std::stoi(argv[1]) : 128;
+    double density = argc > 2 ? std::stod(argv[2]) : 0.2;
+
+    std::vector<u32> counts;
+    for (i32 i = 3; i < argc; i++) counts.push_back((u32)std::stoul(argv[i]));
+    if (counts.empty()) counts = {16, 64, 256};
+
+    std::mt19937 rng(1);
+    std::bernoulli_distribution blocked(density);
+
+    Grid grid(size, size);
+    for (i32 y = 0; y < size; y++) {
+        for (i32 x = 0; x < size; x++) {
+            if (blocked(rng)) grid.set({x, y});
+        }
+    }
+
+    // Starts and targets on free cells of one component, so every agent
+    // has a path when it is alone
+    Components components;
+    std::uniform_int_distribution<i32> coord(0, size - 1);
+    std::pair<i32, i32> anchor;
+    do anchor = {coord(rng), coord(rng)}; while (grid.isObstacle(anchor));
+
+    auto engine = createEngine("astar");
+
+    printf("%dx%d, density %.2f\n", size, size, density);
+    printf("  %6s  %-12s %10s %12s %9s %10s %9s %10s %10s\n",
+            "agents", "method", "ms", "expanded", "makespan", "cost", "arrived", "conflicts", "table KB");
+
+    for (u32 count : counts) {
+        std::unordered_set<std::pair<i32, i32>, pair_hash> starts, targets;
+        std::vector<AgentTask> tasks;
+        while (tasks.size() < count) {
+            std::pair<i32, i32> from = {coord(rng), coord(rng)};
+            std::pair<i32, i32> to   = {coord(rng), coord(rng)};
+            if (grid.isObstacle(from) || grid.isObstacle(to)) continue;
+            if (!components.connected(grid, anchor, from) || !components.connected(grid, anchor, to)) continue;
+            if (starts.count(from) || targets.count(to)) continue;
+
+            starts.insert(from);
+            targets.insert(to);
+            tasks.push_back({from, to});
+        }
+
+        auto row = [&](const char* method, double ms, u64 expanded, u32 makespan, u64 cost, u32 arrived, u64 conflicts, size_t bytes) {
+            printf("  %6u  %-12s %10.3f %12llu %9u %10llu %9u %10llu %10.1f\n",
+                    count, method, ms, (unsigned long long)expanded, makespan, (unsigned long long)cost,
+                    arrived, (unsigned long long)conflicts, bytes / 1024.0);
+        };
+
+        // Shortest paths, each as if the agent were alone
+        double ms = 0.0;
+        u64 expanded = 0, cost = 0;
+        u32 makespan = 0, arrived = 0;
+        std::vector<std::vector<std::pair<i32, i32>>> paths;
+        for (const auto& task : tasks) {
+            SearchQuery query;
+            query.start  = task.start;
+            query.target = task.target;
+
+            SearchResult r = engine->search(grid, query);
+            ms += r.elapsed_ms;
+            expanded += r.expanded;
+            if (r.found) {
+                arrived++;
+                cost += r.path.size() - 1;
+                makespan = std::max(makespan, (u32)r.path.size() - 1);
+            }
+            paths.push_back(r.found ? r.path : std::vector<std::pair<i32, i32>>{task.start});
+        }
+        row("independent", ms, expanded, makespan, cost, arrived, countConflicts(paths), 0);
+
+        for (u32 window : {0u, 8u, 16u, 32u}) {
+            CooperativePlanner planner(window);
+            AgentPlan plan = planner.plan(grid, tasks);
+
+            std::string method = window == 0 ? "CA*" : "WHCA* " + std::to_string(window);
+            row(method.c_str(), plan.elapsed_ms, plan.expanded, plan.makespan, plan.sum_of_costs,
+                    plan.arrived, countConflicts(plan.paths), planner.reservationBytes());
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Any-angle benchmark: Theta* and Lazy Theta* against A* followed by
+// post-smoothing, on random maps of a few densities. Costs are measured the
+// same way for every method, as straight segments between waypoints.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "AnyAngleSearch.hpp"
+
+struct Method {
+    const char* name;
+
+    u32 solved = 0;
+    double cost = 0.0;
+    double waypoints = 0.0;
+    double ms = 0.0;
+    u64 expanded = 0;
+    u64 line_checks = 0;
+};
+
+static void report(const Method& m)
+{
+    double n = std::max<u32>(m.solved, 1);
+    printf("  %-18s %10.1f %10.1f %10.3f %12.1f %12.1f\n",
+            m.name, m.cost / n, m.waypoints / n, m.ms / n, m.expanded / n, m.line_checks / n);
+}
+
+int main(int argc, char** argv)
+{
+    i32 width   = argc > 1 ? std::stoi(argv[1]) : 512;
+    i32 height  = argc > 2 ? std::stoi(argv[2]) : 512;
+    u32 queries = argc > 3 ? (u32)std::stoul(argv[3]) : 50;
+
+    for (double density : {0.05, 0.15, 0.25}) {
+        std::mt19937 rng(1);
+        std::bernoulli_distribution blocked(density);
+
+        Grid grid(width, height);
+        for (i32 y = 0; y < height; y++) {
+            for (i32 x = 0; x < width; x++) {
+                if (blocked(rng)) grid.set({x, y});
+            }
+        }
+
+        Components components;
+        std::uniform_int_distribution<i32> xs(0, width - 1), ys(0, height - 1);
+
+        Method astar{"A*"}, smoothed{"A* + smoothing"}, theta{"Theta*"}, lazy{"Lazy Theta*"};
+        AStarSearch astar_engine;
+        ThetaStarSearch theta_engine(false), lazy_engine(true);
+
+        for (u32 q = 0; q < queries; ) {
+            SearchQuery query;
+            query.start  = {xs(rng), ys(rng)};
+            query.target = {xs(rng), ys(rng)};
+            if (grid.isObstacle(query.start) || grid.isObstacle(query.target)
+                    || !components.connected(grid, query.start, query.target)) {
+                continue;
+            }
+            q++;
+
+            SearchResult r = astar_engine.search(grid, query);
+            astar.solved++;
+            astar.cost += search::pathCost(grid, r.path) / STEP_COST;
+            astar.waypoints += r.path.size();
+            astar.ms += r.elapsed_ms;
+            astar.expanded += r.expanded;
+
+            auto t0 = search::Clock::now();
+            smoothed.line_checks += search::smoothPath(grid, r.path);
+            smoothed.solved++;
+            smoothed.cost += search::pathCost(grid, r.path) / STEP_COST;
+            smoothed.waypoints += r.path.size();
+            smoothed.ms += r.elapsed_ms + search::millisSince(t0);
+            smoothed.expanded += r.expanded;
+
+            for (auto [engine, m] : {std::make_pair(&theta_engine, &theta), std::make_pair(&lazy_engine, &lazy)}) {
+                SearchResult a = engine->search(grid, query);
+                m->solved++;
+                m->cost += search::pathCost(grid, a.path) / STEP_COST;
+                m->waypoints += a.path.size();
+                m->ms += a.elapsed_ms;
+                m->expanded += a.expanded;
+                m->line_checks += engine->getLineChecks();
+            }
+        }
+
+        printf("%dx%d, density %.2f, %u queries (means per query)\n", width, height, density, queries);
+        printf("  %-18s %10s %10s %10s %12s %12s\n", "method", "length", "waypoints", "ms", "expanded", "LOS checks");
+        for (const Method* m : {&astar, &smoothed, &theta, &lazy}) {
+            report(*m);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
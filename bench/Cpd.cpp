@@ -0,0 +1,96 @@
+// Path database benchmark: on each kind of generated map, builds the
+// compressed path database with one thread and with all of them, saves it and
+// maps it back, then times single first-move lookups and whole paths read
+// from it against A*. Path costs are checked against Dijkstra.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "Engines.hpp"
+#include "Maps.hpp"
+#include "PathDatabase.hpp"
+
+int main(int argc, char** argv)
+{
+    u32 queries = argc > 1 ? (u32)std::stoul(argv[1]) : 1000;
+    i32 size = argc > 2 ? std::stoi(argv[2]) : 96;
+    std::string file = argc > 3 ? argv[3] : "bench-cpd.cpd";
+
+    printf("%dx%d, %u queries per map (lookup and query times are means)\n", size, size, queries);
+    printf("  %-7s %8s %10s %10s %10s %9s %9s %9s %9s %10s %10s %9s %10s\n",
+            "map", "cells", "runs", "build ms", "1 thread", "file KB", "B/cell", "map ms",
+            "move ns", "A* us", "path us", "speedup", "mismatch");
+
+    for (const auto& map : mapList()) {
+        std::mt19937 rng(1);
+        Grid grid;
+        std::pair<i32, i32> start, target;
+        generateMap(map.kind, {size, size}, 0.2, rng, grid, start, target);
+
+        // Preprocessing: parallel and serial builds, then the file
+        PathDatabase single;
+        single.build(grid, 1);
+
+        PathDatabase database;
+        database.build(grid);
+        database.save(file);
+
+        PathDatabase mapped;
+        if (!mapped.open(file, grid)) {
+            printf("  %-7s could not map %s back\n", map.name, file.c_str());
+            return 1;
+        }
+
+        // Queries between random connected free cells
+        Components components;
+        std::uniform_int_distribution<i32> coord(0, size - 1);
+        std::vector<SearchQuery> batch;
+        while (batch.size() < queries) {
+            SearchQuery query;
+            query.start  = {coord(rng), coord(rng)};
+            query.target = {coord(rng), coord(rng)};
+            if (grid.isObstacle(query.start) || grid.isObstacle(query.target)) continue;
+            if (!components.connected(grid, query.start, query.target)) continue;
+            batch.push_back(query);
+        }
+
+        // Single first-move lookups on the mapped file
+        const u32 rounds = 100;
+        u32 moves = 0;
+        auto t0 = search::Clock::now();
+        for (u32 k = 0; k < rounds; k++) {
+            for (const auto& query : batch) moves += mapped.firstMove(query.start, query.target);
+        }
+        double move_ns = search::millisSince(t0) * 1e6 / ((double)rounds * queries);
+        volatile u32 sink = moves;
+        (void)sink;
+
+        auto astar = createEngine("astar");
+        auto dijkstra = createEngine("dijkstra");
+        PathDatabaseSearch engine(file);
+        engine.prepare(grid);
+
+        double astar_ms = 0.0, path_ms = 0.0;
+        u32 mismatches = 0;
+        for (const auto& query : batch) {
+            SearchResult expected = dijkstra->search(grid, query);
+            SearchResult result = engine.search(grid, query);
+
+            astar_ms += astar->search(grid, query).elapsed_ms;
+            path_ms += result.elapsed_ms;
+            mismatches += result.found != expected.found || result.cost != expected.cost;
+        }
+
+        printf("  %-7s %8u %10llu %10.1f %10.1f %9.1f %9.2f %9.3f %9.1f %10.2f %10.2f %8.1fx %10u\n",
+                map.name, database.cellCount(), (unsigned long long)database.runCount(),
+                database.getBuildMs(), single.getBuildMs(), database.bytes() / 1024.0,
+                (double)database.bytes() / database.cellCount(), mapped.getBuildMs(), move_ns,
+                astar_ms * 1e3 / queries, path_ms * 1e3 / queries, astar_ms / path_ms, mismatches);
+    }
+
+    std::remove(file.c_str());
+
+    return 0;
+}
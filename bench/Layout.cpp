@@ -0,0 +1,108 @@
+// Layout benchmark: A* with its per-cell state in row-major, tiled and
+// Morton order on large random maps, and the cost of the coordinate to
+// index conversions on their own.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "Search.hpp"
+
+// Sum over all codes keeps the loops from being optimized away
+template<class F>
+static double nsPerCall(u32 n, F&& f)
+{
+    auto t0 = search::Clock::now();
+
+    u32 sum = 0;
+    for (u32 y = 0; y < n; y++) {
+        for (u32 x = 0; x < n; x++) {
+            sum += f(x, y);
+        }
+    }
+
+    double ms = search::millisSince(t0);
+    if (sum == 42) printf(" ");
+
+    return 1e6 * ms / ((double)n * n);
+}
+
+int main(int argc, char** argv)
+{
+    u32 queries = argc > 1 ? (u32)std::stoul(argv[1]) : 10;
+
+    std::vector<i32> sizes;
+    for (i32 i = 2; i < argc; i++) sizes.push_back(std::stoi(argv[i]));
+    if (sizes.empty()) sizes = {1024, 2048, 4096};
+
+#ifdef __BMI2__
+    const char* morton_impl = "pdep/pext";
+#else
+    const char* morton_impl = "portable";
+#endif
+
+    printf("Morton codes (%s), ns per call\n", morton_impl);
+    printf("  encode %.3f, portable encode %.3f\n",
+            nsPerCall(4096, [](u32 x, u32 y) { return morton::encode(x, y); }),
+            nsPerCall(4096, [](u32 x, u32 y) { return morton::encodePortable(x, y); }));
+    printf("  decode %.3f, portable decode %.3f\n\n",
+            nsPerCall(4096, [](u32 x, u32 y) { return morton::decode(x << 12 | y).first; }),
+            nsPerCall(4096, [](u32 x, u32 y) { return morton::decodePortable(x << 12 | y).first; }));
+
+    const std::pair<short, const char*> layouts[] = {
+        {LAYOUT_ROWS, "rows"}, {LAYOUT_TILES, "tiles"}, {LAYOUT_MORTON, "morton"}};
+
+    for (i32 size : sizes) {
+        std::mt19937 rng(1);
+        std::bernoulli_distribution blocked(0.2);
+
+        Grid grid(size, size);
+        for (i32 y = 0; y < size; y++) {
+            for (i32 x = 0; x < size; x++) {
+                if (blocked(rng)) grid.set({x, y});
+            }
+        }
+
+        // Far apart endpoints, so every query crosses much of the map
+        Components components;
+        std::uniform_int_distribution<i32> near(0, size / 8), far(size - 1 - size / 8, size - 1);
+
+        std::vector<SearchQuery> batch;
+        while (batch.size() < queries) {
+            SearchQuery query;
+            query.start  = {near(rng), near(rng)};
+            query.target = {far(rng), far(rng)};
+            if (grid.isObstacle(query.start) || grid.isObstacle(query.target)
+                    || !components.connected(grid, query.start, query.target)) {
+                continue;
+            }
+            batch.push_back(query);
+        }
+
+        printf("%dx%d, density 0.20, %u queries (means per query)\n", size, size, queries);
+        printf("  %-8s %12s %12s %14s %10s\n", "layout", "ms", "expanded", "ns/expansion", "cost");
+
+        for (auto [kind, name] : layouts) {
+            AStarSearch engine(1.0, PRIORITY_ASTAR, kind);
+
+            // Warm up the scratch, so allocation is not measured
+            engine.search(grid, batch[0]);
+
+            double ms = 0.0, cost = 0.0;
+            u64 expanded = 0;
+            for (const auto& query : batch) {
+                SearchResult r = engine.search(grid, query);
+                ms += r.elapsed_ms;
+                expanded += r.expanded;
+                cost += r.cost;
+            }
+
+            printf("  %-8s %12.3f %12.1f %14.1f %10.1f\n",
+                    name, ms / queries, (double)expanded / queries, 1e6 * ms / expanded, cost / queries);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Multi-target benchmark: the dispatch decision of sending a unit to the
+// nearest of K jobs, made with one A* search per job, with one nearest-target
+// search and with one shared expansion to all jobs. Reports the time and
+// expansions per decision and how far the chosen path is from the best one.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "Engines.hpp"
+#include "MultiTarget.hpp"
+
+int main(int argc, char** argv)
+{
+    u32 decisions = argc > 1 ? (u32)std::stoul(argv[1]) : 20;
+    i32 size = argc > 2 ? std::stoi(argv[2]) : 1024;
+    double density = argc > 3 ? std::stod(argv[3]) : 0.2;
+
+    std::vector<u32> counts;
+    for (i32 i = 4; i < argc; i++) counts.push_back((u32)std::stoul(argv[i]));
+    if (counts.empty()) counts = {4, 16, 64, 256};
+
+    std::mt19937 rng(1);
+    std::bernoulli_distribution blocked(density);
+
+    Grid grid(size, size);
+    for (i32 y = 0; y < size; y++) {
+        for (i32 x = 0; x < size; x++) {
+            if (blocked(rng)) grid.set({x, y});
+        }
+    }
+
+    // Units and jobs on free cells of the start's component, so every job
+    // can be reached
+    Components components;
+    std::uniform_int_distribution<i32> coord(0, size - 1);
+    auto freeCell = [&](const std::pair<i32, i32>& from) {
+        while (true) {
+            std::pair<i32, i32> cell = {coord(rng), coord(rng)};
+            if (!grid.isObstacle(cell) && (from.first < 0 || components.connected(grid, from, cell))) return cell;
+        }
+    };
+
+    auto engine = createEngine("astar");
+    MultiTargetSearch search;
+
+    printf("%dx%d, density %.2f, %u decisions (means per decision)\n", size, size, density, decisions);
+    printf("  %6s  %-10s %12s %14s %12s\n", "jobs", "method", "ms", "expanded", "cost");
+
+    for (u32 count : counts) {
+        std::vector<MultiTargetQuery> batch(decisions);
+        for (auto& query : batch) {
+            query.start = freeCell({-1, -1});
+            while (query.targets.size() < count) query.targets.push_back(freeCell(query.start));
+        }
+
+        // Warm up the scratch, so allocation is not measured
+        i32 reached;
+        search.nearest(grid, batch[0], reached);
+        search.all(grid, batch[0]);
+
+        double each_ms = 0.0, nearest_ms = 0.0, all_ms = 0.0;
+        u64 each_expanded = 0, nearest_expanded = 0, all_expanded = 0;
+        double each_cost = 0.0, nearest_cost = 0.0, all_cost = 0.0;
+
+        for (const auto& query : batch) {
+            i64 best = -1;
+            for (const auto& target : query.targets) {
+                SearchQuery single;
+                single.start  = query.start;
+                single.target = target;
+
+                SearchResult r = engine->search(grid, single);
+                each_ms += r.elapsed_ms;
+                each_expanded += r.expanded;
+                if (r.found && (best < 0 || r.cost < best)) best = r.cost;
+            }
+            each_cost += best;
+
+            SearchResult r = search.nearest(grid, query, reached);
+            nearest_ms += r.elapsed_ms;
+            nearest_expanded += r.expanded;
+            nearest_cost += r.cost;
+
+            // The shared expansion ends with the last job it closes
+            i64 all_best = -1;
+            u64 expanded = 0;
+            double ms = 0.0;
+            for (const auto& result : search.all(grid, query)) {
+                if (result.found && (all_best < 0 || result.cost < all_best)) all_best = result.cost;
+                expanded = std::max(expanded, result.expanded);
+                ms = std::max(ms, result.elapsed_ms);
+            }
+            all_ms += ms;
+            all_expanded += expanded;
+            all_cost += all_best;
+        }
+
+        auto row = [&](const char* method, double ms, u64 expanded, double cost) {
+            printf("  %6u  %-10s %12.3f %14.1f %12.1f   x%.1f\n",
+                    count, method, ms / decisions, (double)expanded / decisions, cost / decisions, each_ms / ms);
+        };
+        row("per job", each_ms, each_expanded, each_cost);
+        row("nearest", nearest_ms, nearest_expanded, nearest_cost);
+        row("all", all_ms, all_expanded, all_cost);
+    }
+
+    return 0;
+}
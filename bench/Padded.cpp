@@ -0,0 +1,176 @@
+// Padded grid benchmark: A* with bounds-checked neighbour generation against
+// the padded engine, 4- and 8-connected, on random maps. Reports expansion
+// throughput, the cost of building the padded copy of the map and neighbour
+// generation on its own, where the open list does not hide the difference.
+// The padded engines run once with each neighbour kernel the CPU supports.
+
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "Engines.hpp"
+#include "PaddedGrid.hpp"
+#include "PaddedSearch.hpp"
+
+int main(int argc, char** argv)
+{
+    u32 queries = argc > 1 ? (u32)std::stoul(argv[1]) : 10;
+    double density = argc > 2 ? std::stod(argv[2]) : 0.2;
+
+    std::vector<i32> sizes;
+    for (i32 i = 3; i < argc; i++) sizes.push_back(std::stoi(argv[i]));
+    if (sizes.empty()) sizes = {256, 1024, 4096};
+
+    // Kernels this CPU has, each only once
+    std::vector<KernelKind> kernels;
+    for (KernelKind kind : {KERNEL_SCALAR, KERNEL_SSE4, KERNEL_AVX2}) {
+        if (kernel::resolve(kind) == kind) kernels.push_back(kind);
+    }
+
+    struct Entry {
+        std::string name;
+        std::unique_ptr<SearchEngine> engine;
+    };
+    auto entries = [&]() {
+        std::vector<Entry> list;
+        list.push_back({"astar", createEngine("astar")});
+        for (i32 connectivity : {CONNECT_4, CONNECT_8}) {
+            for (KernelKind kind : kernels) {
+                list.push_back({std::string(connectivity == CONNECT_8 ? "padded8/" : "padded/") + kernel::name(kind),
+                        std::unique_ptr<SearchEngine>(new PaddedSearch(connectivity, 1.0, kind))});
+            }
+        }
+        return list;
+    };
+
+    for (i32 size : sizes) {
+        std::mt19937 rng(1);
+        std::bernoulli_distribution blocked(density);
+
+        Grid grid(size, size);
+        for (i32 y = 0; y < size; y++) {
+            for (i32 x = 0; x < size; x++) {
+                if (blocked(rng)) grid.set({x, y});
+            }
+        }
+
+        // Far apart endpoints, so every query crosses much of the map
+        Components components;
+        std::uniform_int_distribution<i32> near(0, size / 8), far(size - 1 - size / 8, size - 1);
+
+        std::vector<SearchQuery> batch;
+        while (batch.size() < queries) {
+            SearchQuery query;
+            query.start  = {near(rng), near(rng)};
+            query.target = {far(rng), far(rng)};
+            if (grid.isObstacle(query.start) || grid.isObstacle(query.target)
+                    || !components.connected(grid, query.start, query.target)) {
+                continue;
+            }
+            batch.push_back(query);
+        }
+
+        PaddedGrid padded;
+        padded.build(grid);
+        auto t0 = search::Clock::now();
+        for (i32 k = 0; k < 10; k++) padded.build(grid);
+        double build_ms = search::millisSince(t0) / 10;
+
+        // Free 4-neighbours of every cell, both ways
+        std::vector<std::pair<i32, i32>> adjacent;
+        u64 checked = 0, offset = 0;
+
+        t0 = search::Clock::now();
+        for (i32 y = 0; y < size; y++) {
+            for (i32 x = 0; x < size; x++) {
+                search::adjacentSquares(grid, {x, y}, adjacent);
+                checked += adjacent.size();
+            }
+        }
+        double checked_ns = 1e6 * search::millisSince(t0) / ((double)size * size);
+
+        const i32* offsets = padded.neighbourOffsets();
+        t0 = search::Clock::now();
+        for (i32 y = 0; y < size; y++) {
+            for (i32 i = padded.index({0, y}), end = i + size; i < end; i++) {
+                for (i32 d = 0; d < 4; d++) offset += !padded.blocked(i + offsets[d]);
+            }
+        }
+        double offset_ns = 1e6 * search::millisSince(t0) / ((double)size * size);
+
+        if (checked != offset) printf("neighbour counts differ: %llu, %llu\n",
+                (unsigned long long)checked, (unsigned long long)offset);
+
+        // The kernels alone, 8-connected, on every cell of an empty search
+        StampedArray<i64> nodes;
+        nodes.reset(padded.size());
+
+        NeighbourContext context;
+        context.done       = padded.getDone();
+        context.walls      = padded.getWalls();
+        context.costs      = padded.getCosts();
+        context.offsets    = offsets;
+        context.stamps     = nodes.stampData();
+        context.generation = nodes.getGeneration();
+        context.g_slots    = nodes.data();
+        context.g_stride   = 1;
+        context.target_x   = size - 1;
+        context.target_y   = size - 1;
+        context.h_scale    = 1.1;
+        context.directions = 8;
+
+        std::vector<double> kernel_ns;
+        for (KernelKind kind : kernels) {
+            NeighbourKernel evaluate = kernel::get(kind);
+            NeighbourBatch batch;
+            u64 selected = 0;
+
+            t0 = search::Clock::now();
+            for (i32 y = 0; y < size; y++) {
+                for (i32 x = 0, i = padded.index({0, y}); x < size; x++, i++) {
+                    u32 mask = evaluate(context, i, x, y, 0, batch);
+                    selected += __builtin_popcount(mask);
+                }
+            }
+            kernel_ns.push_back(1e6 * search::millisSince(t0) / ((double)size * size));
+            if (selected == 0) printf("kernel %s selected nothing\n", kernel::name(kind));
+        }
+
+        printf("%dx%d, density %.2f, %u queries (means per query), padded copy built in %.3f ms\n",
+                size, size, density, queries, build_ms);
+        printf("  neighbours per cell: bounds-checked %.2f ns, offsets %.2f ns (x%.1f)\n",
+                checked_ns, offset_ns, checked_ns / offset_ns);
+        printf("  8 neighbours and scores per cell:");
+        for (size_t k = 0; k < kernels.size(); k++) {
+            printf(" %s %.2f ns (x%.2f)", kernel::name(kernels[k]), kernel_ns[k], kernel_ns[0] / kernel_ns[k]);
+        }
+        printf("\n");
+        printf("  %-14s %12s %12s %14s %12s %10s\n", "engine", "ms", "expanded", "ns/expansion", "Mexp/s", "cost");
+
+        double base_ns = 0.0;
+        for (auto& [name, engine] : entries()) {
+
+            // Warm up the scratch, so allocation is not measured
+            engine->search(grid, batch[0]);
+
+            double ms = 0.0, cost = 0.0;
+            u64 expanded = 0;
+            for (const auto& query : batch) {
+                SearchResult r = engine->search(grid, query);
+                ms += r.elapsed_ms;
+                expanded += r.expanded;
+                cost += r.cost;
+            }
+
+            double ns = 1e6 * ms / expanded;
+            if (base_ns == 0.0) base_ns = ns;
+
+            printf("  %-14s %12.3f %12.1f %14.1f %12.2f %10.1f   x%.2f\n",
+                    name.c_str(), ms / queries, (double)expanded / queries, ns, 1e3 / ns, cost / queries, base_ns / ns);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
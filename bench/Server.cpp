@@ -0,0 +1,306 @@
+// Load generator of the query daemon (A-Star --serve SOCKET). Every
+// connection keeps a number of queries between random cells in flight and
+// sends the next one as soon as a reply comes back. Prints the throughput
+// and latencies seen by the clients, then the statistics of the server.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Engines.hpp"
+#include "Protocol.hpp"
+#include "Search.hpp"
+
+using namespace protocol;
+
+struct Settings {
+    std::string socket_path;
+    std::string scene;          // Loaded first and queried instead of map 0
+    std::string engine = "astar";
+    std::pair<i32, i32> size = {16, 9};
+
+    u32 queries = 100000;
+    u32 connections = 4;
+    u32 depth = 16;             // Queries in flight per connection
+    u32 budget_us = 0;
+    u32 seed = 1;
+};
+
+struct Tally {
+    u64 found = 0;
+    u64 no_path = 0;
+    u64 timed_out = 0;
+    u64 invalid = 0;
+    u64 errors = 0;
+    std::vector<u32> latencies_us;
+};
+
+static Settings parseSettings(i32 argc, char** argv)
+{
+    Settings settings;
+
+    for (i32 i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printf("Usage: bench-server --socket PATH [--scene FILE] [--size WxH] [--engine NAME]\n"
+                   "                    [--queries N] [--connections N] [--depth N]\n"
+                   "                    [--budget US] [--seed S]\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for '" + arg + "'!");
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--socket") {
+            settings.socket_path = value;
+        } else if (arg == "--scene") {
+            settings.scene = value;
+        } else if (arg == "--size") {
+            char x;
+            std::istringstream in(value);
+            if (!(in >> settings.size.first >> x >> settings.size.second) || x != 'x'
+                    || settings.size.first <= 0 || settings.size.second <= 0) {
+                throw std::runtime_error("Malformed size '" + value + "'!");
+            }
+        } else if (arg == "--engine") {
+            settings.engine = value;
+        } else if (arg == "--queries") {
+            settings.queries = (u32)std::stoul(value);
+        } else if (arg == "--connections") {
+            settings.connections = std::max(1, std::stoi(value));
+        } else if (arg == "--depth") {
+            settings.depth = std::max(1, std::stoi(value));
+        } else if (arg == "--budget") {
+            settings.budget_us = (u32)std::stoul(value);
+        } else if (arg == "--seed") {
+            settings.seed = (u32)std::stoul(value);
+        } else {
+            throw std::runtime_error("Unknown option '" + arg + "'!");
+        }
+    }
+
+    if (settings.socket_path.empty()) {
+        throw std::runtime_error("--socket is required!");
+    }
+
+    return settings;
+}
+
+static int connectTo(const std::string& path)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        throw std::runtime_error("Cannot connect to " + path + ": " + strerror(errno));
+    }
+    return fd;
+}
+
+static void writeAll(int fd, const std::vector<u8>& bytes)
+{
+    size_t done = 0;
+    while (done < bytes.size()) {
+        ssize_t n = send(fd, bytes.data() + done, bytes.size() - done, MSG_NOSIGNAL);
+        if (n <= 0) throw std::runtime_error("Connection lost while sending");
+        done += n;
+    }
+}
+
+// Reads one frame, returns its type and fills 'id' and 'payload'
+static u8 readFrame(int fd, u32& id, std::vector<u8>& payload)
+{
+    auto readAll = [fd](u8* p, size_t size) {
+        while (size > 0) {
+            ssize_t n = recv(fd, p, size, 0);
+            if (n <= 0) throw std::runtime_error("Connection lost while receiving");
+            p += n;
+            size -= n;
+        }
+    };
+
+    u8 header[HEADER_SIZE];
+    readAll(header, HEADER_SIZE);
+    u32 size = get32(header);
+    if (size < HEADER_SIZE - 4 || size > MAX_FRAME) {
+        throw std::runtime_error("Malformed frame from the server");
+    }
+
+    id = get32(header + 8);
+    payload.resize(size - (HEADER_SIZE - 4));
+    readAll(payload.data(), payload.size());
+    return header[4];
+}
+
+// Sends a request without a batch of others and waits for its reply
+static std::vector<u8> request(int fd, u8 type, const std::string& payload)
+{
+    std::vector<u8> out;
+    size_t frame = beginFrame(out, type, 0);
+    out.insert(out.end(), payload.begin(), payload.end());
+    endFrame(out, frame);
+    writeAll(fd, out);
+
+    u32 id;
+    std::vector<u8> reply;
+    if (readFrame(fd, id, reply) == MSG_ERROR) {
+        throw std::runtime_error("Server: " + std::string(reply.begin(), reply.end()));
+    }
+    return reply;
+}
+
+static void runConnection(const Settings& settings, u32 map, u8 engine, u32 queries, u32 seed, Tally& tally)
+{
+    int fd = connectTo(settings.socket_path);
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<i32> x(0, settings.size.first - 1);
+    std::uniform_int_distribution<i32> y(0, settings.size.second - 1);
+
+    std::vector<search::Clock::time_point> sent(queries);
+    std::vector<u8> out;
+    u32 next = 0;
+
+    auto queue = [&](u32 count) {
+        out.clear();
+        for (; count > 0 && next < queries; count--, next++) {
+            size_t frame = beginFrame(out, MSG_QUERY, next);
+            put32(out, map);
+            put8(out, engine);
+            put8(out, 0);
+            put8(out, 0);
+            put8(out, 0);
+            put32(out, (u32)x(rng));
+            put32(out, (u32)y(rng));
+            put32(out, (u32)x(rng));
+            put32(out, (u32)y(rng));
+            put32(out, settings.budget_us);
+            endFrame(out, frame);
+            sent[next] = search::Clock::now();
+        }
+        writeAll(fd, out);
+    };
+
+    queue(settings.depth);
+
+    std::vector<u8> payload;
+    for (u32 answered = 0; answered < queries; answered++) {
+        u32 id;
+        u8 type = readFrame(fd, id, payload);
+        auto now = search::Clock::now();
+
+        if (type == MSG_ERROR || id >= queries) {
+            tally.errors++;
+        } else {
+            switch (payload[0]) {
+                case STATUS_FOUND:     tally.found++; break;
+                case STATUS_NO_PATH:   tally.no_path++; break;
+                case STATUS_TIMED_OUT: tally.timed_out++; break;
+                default:               tally.invalid++;
+            }
+            tally.latencies_us.push_back(
+                    (u32)std::chrono::duration_cast<std::chrono::microseconds>(now - sent[id]).count());
+        }
+
+        if (next < queries) queue(1);
+    }
+
+    close(fd);
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        Settings settings = parseSettings(argc, argv);
+
+        const auto& engines = engineList();
+        auto engine = std::find_if(engines.begin(), engines.end(),
+                [&](const EngineInfo& e) { return e.name == settings.engine; });
+        if (engine == engines.end()) {
+            throw std::runtime_error("Unknown engine '" + settings.engine + "'!");
+        }
+
+        int control = connectTo(settings.socket_path);
+
+        u32 map = 0;
+        if (!settings.scene.empty()) {
+            std::vector<u8> reply = request(control, MSG_LOAD, settings.scene);
+            map = get32(&reply[0]);
+            settings.size = {(i32)get32(&reply[4]), (i32)get32(&reply[8])};
+            printf("Loaded %s as map %u (%dx%d)\n", settings.scene.c_str(), map,
+                    settings.size.first, settings.size.second);
+        }
+
+        std::vector<Tally> tallies(settings.connections);
+        std::vector<std::thread> clients;
+
+        auto begin = search::Clock::now();
+        for (u32 c = 0; c < settings.connections; c++) {
+            u32 share = settings.queries / settings.connections + (c < settings.queries % settings.connections);
+            clients.emplace_back(runConnection, std::cref(settings), map, (u8)(engine - engines.begin()),
+                    share, settings.seed + c, std::ref(tallies[c]));
+        }
+        for (auto& c : clients) c.join();
+        double seconds = std::chrono::duration<double>(search::Clock::now() - begin).count();
+
+        Tally total;
+        for (const auto& t : tallies) {
+            total.found     += t.found;
+            total.no_path   += t.no_path;
+            total.timed_out += t.timed_out;
+            total.invalid   += t.invalid;
+            total.errors    += t.errors;
+            total.latencies_us.insert(total.latencies_us.end(), t.latencies_us.begin(), t.latencies_us.end());
+        }
+        std::sort(total.latencies_us.begin(), total.latencies_us.end());
+
+        auto percentile = [&](double p) -> u32 {
+            if (total.latencies_us.empty()) return 0;
+            return total.latencies_us[std::min(total.latencies_us.size() - 1, (size_t)(p * total.latencies_us.size()))];
+        };
+
+        printf("Client: %u queries over %u connections, %u in flight each\n",
+                settings.queries, settings.connections, settings.depth);
+        printf("  %.0f queries/s, found %llu, no path %llu, timed out %llu, invalid %llu, errors %llu\n",
+                settings.queries / seconds,
+                (unsigned long long)total.found, (unsigned long long)total.no_path,
+                (unsigned long long)total.timed_out, (unsigned long long)total.invalid,
+                (unsigned long long)total.errors);
+        printf("  latency us: p50 %u, p90 %u, p99 %u, p999 %u, max %u\n",
+                percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999),
+                total.latencies_us.empty() ? 0 : total.latencies_us.back());
+
+        std::vector<u8> stats = request(control, MSG_STATS, "");
+        printf("Server: %llu queries in %llu batches (%.1f per batch), %llu errors, %u workers, %u maps\n",
+                (unsigned long long)get64(&stats[0]), (unsigned long long)get64(&stats[8]),
+                getDouble(&stats[40]), (unsigned long long)get64(&stats[16]),
+                get32(&stats[88]), get32(&stats[92]));
+        printf("  uptime %.1f s, %.0f queries/s overall\n", getDouble(&stats[24]), getDouble(&stats[32]));
+        printf("  latency us: p50 %.0f, p90 %.0f, p99 %.0f, p999 %.0f, max %.0f\n",
+                getDouble(&stats[48]), getDouble(&stats[56]), getDouble(&stats[64]),
+                getDouble(&stats[72]), getDouble(&stats[80]));
+
+        close(control);
+
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
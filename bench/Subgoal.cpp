@@ -0,0 +1,91 @@
+// Subgoal graph benchmark: on each kind of generated map, builds the subgoal
+// graph with one thread and with all of them, saves and loads it, then
+// answers random queries with it and with A*. Preprocessing is reported
+// apart from the queries, whose costs are checked against Dijkstra.
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "Components.hpp"
+#include "Engines.hpp"
+#include "Maps.hpp"
+#include "SubgoalGraph.hpp"
+
+int main(int argc, char** argv)
+{
+    u32 queries = argc > 1 ? (u32)std::stoul(argv[1]) : 100;
+    i32 size = argc > 2 ? std::stoi(argv[2]) : 1024;
+    std::string file = argc > 3 ? argv[3] : "bench-subgoal.ssg";
+
+    printf("%dx%d, %u queries per map (query times are means)\n", size, size, queries);
+    printf("  %-7s %10s %10s %10s %10s %9s %9s %9s %11s %11s %9s %10s\n",
+            "map", "subgoals", "edges", "build ms", "1 thread", "file KB", "save ms", "load ms",
+            "A* ms", "graph ms", "speedup", "mismatch");
+
+    for (const auto& map : mapList()) {
+        std::mt19937 rng(1);
+        Grid grid;
+        std::pair<i32, i32> start, target;
+        generateMap(map.kind, {size, size}, 0.2, rng, grid, start, target);
+
+        // Preprocessing: parallel and serial builds, then the file
+        SubgoalGraph single;
+        single.build(grid, 1);
+
+        SubgoalGraph graph;
+        graph.build(grid);
+
+        auto t0 = search::Clock::now();
+        graph.save(file);
+        double save_ms = search::millisSince(t0);
+
+        std::ifstream stored(file, std::ios::binary | std::ios::ate);
+        double file_kb = stored.tellg() / 1024.0;
+
+        SubgoalGraph loaded;
+        if (!loaded.load(file, grid)) {
+            printf("  %-7s could not load %s back\n", map.name, file.c_str());
+            return 1;
+        }
+
+        // Queries between random connected free cells, against a warm engine
+        Components components;
+        std::uniform_int_distribution<i32> coord(0, size - 1);
+        std::vector<SearchQuery> batch;
+        while (batch.size() < queries) {
+            SearchQuery query;
+            query.start  = {coord(rng), coord(rng)};
+            query.target = {coord(rng), coord(rng)};
+            if (grid.isObstacle(query.start) || grid.isObstacle(query.target)) continue;
+            if (!components.connected(grid, query.start, query.target)) continue;
+            batch.push_back(query);
+        }
+
+        auto astar = createEngine("astar");
+        auto dijkstra = createEngine("dijkstra");
+        SubgoalSearch subgoals(file);
+        subgoals.prepare(grid);
+
+        double astar_ms = 0.0, graph_ms = 0.0;
+        u32 mismatches = 0;
+        for (const auto& query : batch) {
+            SearchResult expected = dijkstra->search(grid, query);
+            SearchResult result = subgoals.search(grid, query);
+
+            astar_ms += astar->search(grid, query).elapsed_ms;
+            graph_ms += result.elapsed_ms;
+            mismatches += result.found != expected.found || result.cost != expected.cost;
+        }
+
+        printf("  %-7s %10zu %10zu %10.1f %10.1f %9.1f %9.2f %9.2f %11.3f %11.3f %8.1fx %10u\n",
+                map.name, graph.size(), graph.edgeCount(), graph.getBuildMs(), single.getBuildMs(),
+                file_kb, save_ms, loaded.getBuildMs(), astar_ms / queries, graph_ms / queries,
+                astar_ms / graph_ms, mismatches);
+    }
+
+    std::remove(file.c_str());
+
+    return 0;
+}
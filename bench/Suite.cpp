@@ -0,0 +1,432 @@
+// Benchmark suite: every engine on seeded random, maze, rooms and open maps
+// from 160x90 up to 8192x8192. Each engine runs in a child process of its
+// own, so the peak RSS reported is its own (the map included). Results are
+// printed as a table, can be written as JSON and compared against a JSON
+// file written earlier, the baseline.
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Engines.hpp"
+#include "Maps.hpp"
+
+struct MapCase {
+    const char* name;
+    short kind;
+    double density;
+};
+
+static const MapCase MAP_CASES[] = {
+    {"random-10", MAP_RANDOM, 0.10},
+    {"random-20", MAP_RANDOM, 0.20},
+    {"random-30", MAP_RANDOM, 0.30},
+    {"maze",      MAP_MAZE,   0.00},
+    {"rooms",     MAP_ROOMS,  0.00},
+    {"open",      MAP_OPEN,   0.05},
+};
+
+// Short searches are repeated until this much time was spent on them, and
+// the median is reported
+static constexpr double MIN_SAMPLE_MS = 200.0;
+static constexpr u32 MAX_RUNS = 1000;
+
+struct Settings {
+    std::vector<std::pair<i32, i32>> sizes = {
+        {160, 90}, {640, 360}, {1280, 720}, {2048, 2048}, {4096, 4096}, {8192, 8192}};
+    std::vector<std::string> maps;
+    std::vector<std::string> engines;
+
+    u32 runs = 3;
+    double budget_ms = 5000.0;
+    u32 seed = 1;
+
+    std::string json;
+    std::string baseline;
+    double threshold = 0.10;
+};
+
+// Sent from the child process that ran the engine
+struct Sample {
+    bool ok = false;
+    bool found = false;
+    bool timed_out = false;
+    i64 cost = 0;
+    u64 expanded = 0;
+    u32 runs = 0;
+    double ms = 0.0;        // Median over the runs
+    u64 peak_rss_kb = 0;
+};
+
+struct Result {
+    std::string map;
+    std::string size;
+    std::string engine;
+    Sample sample;
+
+    inline double nodesPerSec() const
+        { return sample.ms > 0 ? sample.expanded / (sample.ms / 1000.0) : 0.0; }
+    inline double nsPerExpansion() const
+        { return sample.expanded ? sample.ms * 1e6 / sample.expanded : 0.0; }
+    inline std::string key() const { return map + " " + size + " " + engine; }
+};
+
+static std::vector<std::string> split(const std::string& list)
+{
+    std::vector<std::string> items;
+    std::istringstream in(list);
+    for (std::string item; std::getline(in, item, ','); ) {
+        if (!item.empty()) items.push_back(item);
+    }
+
+    return items;
+}
+
+static Settings parseSettings(i32 argc, char** argv)
+{
+    Settings settings;
+    for (const auto& c : MAP_CASES) settings.maps.push_back(c.name);
+    for (const auto& e : engineList()) settings.engines.push_back(e.name);
+
+    for (i32 i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            printf("Usage: bench-suite [--sizes WxH,...] [--maps NAME,...] [--engines NAME,...]\n"
+                   "                   [--runs N] [--budget MS] [--seed S]\n"
+                   "                   [--json FILE] [--baseline FILE] [--threshold F]\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        if (i + 1 >= argc) {
+            throw std::runtime_error("Missing value for '" + arg + "'!");
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--sizes") {
+            settings.sizes.clear();
+            for (const auto& s : split(value)) {
+                i32 w, h;
+                char x;
+                std::istringstream in(s);
+                if (!(in >> w >> x >> h) || x != 'x' || w <= 0 || h <= 0) {
+                    throw std::runtime_error("Malformed size '" + s + "'!");
+                }
+                settings.sizes.push_back({w, h});
+            }
+        } else if (arg == "--maps") {
+            settings.maps = split(value);
+        } else if (arg == "--engines") {
+            settings.engines = split(value);
+        } else if (arg == "--runs") {
+            settings.runs = std::max(1, std::stoi(value));
+        } else if (arg == "--budget") {
+            settings.budget_ms = std::stod(value);
+        } else if (arg == "--seed") {
+            settings.seed = (u32)std::stoul(value);
+        } else if (arg == "--json") {
+            settings.json = value;
+        } else if (arg == "--baseline") {
+            settings.baseline = value;
+        } else if (arg == "--threshold") {
+            settings.threshold = std::stod(value);
+        } else {
+            throw std::runtime_error("Unknown option '" + arg + "'!");
+        }
+    }
+
+    for (const auto& name : settings.engines) createEngine(name);
+
+    return settings;
+}
+
+static const MapCase& mapCase(const std::string& name)
+{
+    for (const auto& c : MAP_CASES) {
+        if (name == c.name) return c;
+    }
+
+    throw std::runtime_error("Unknown map '" + name + "'!");
+}
+
+static u64 peakRssKb()
+{
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line); ) {
+        if (line.rfind("VmHWM:", 0) == 0) return std::stoull(line.substr(6));
+    }
+
+    return 0;
+}
+
+static Sample measure(const std::string& name, const Grid& grid, const SearchQuery& query, u32 runs)
+{
+    Sample sample;
+
+    auto engine = createEngine(name);
+    std::vector<double> times;
+    double total = 0.0;
+
+    // A search that ran out of budget is not repeated
+    while (times.size() < runs || (total < MIN_SAMPLE_MS && times.size() < MAX_RUNS)) {
+        SearchResult result = engine->search(grid, query);
+
+        times.push_back(result.elapsed_ms);
+        total += result.elapsed_ms;
+
+        sample.found     = result.found;
+        sample.timed_out = result.timed_out;
+        sample.cost      = result.cost;
+        sample.expanded  = result.expanded;
+
+        if (result.timed_out) break;
+    }
+
+    std::sort(times.begin(), times.end());
+    sample.ms   = times[times.size() / 2];
+    sample.runs = (u32)times.size();
+    sample.peak_rss_kb = peakRssKb();
+    sample.ok = true;
+
+    return sample;
+}
+
+// Runs the engine in a child process, which starts out with the map
+static Sample measureIsolated(const std::string& name, const Grid& grid, const SearchQuery& query, u32 runs)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        throw std::runtime_error("Could not create a pipe");
+    }
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("Could not fork");
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+
+        Sample sample;
+        try {
+            sample = measure(name, grid, query, runs);
+        } catch (const std::exception& e) {
+            fprintf(stderr, "%s: %s\n", name.c_str(), e.what());
+        }
+
+        ssize_t written = write(fds[1], &sample, sizeof(sample));
+        _exit(written == (ssize_t)sizeof(sample) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+
+    Sample sample;
+    if (read(fds[0], &sample, sizeof(sample)) != (ssize_t)sizeof(sample)) {
+        sample.ok = false;
+    }
+    close(fds[0]);
+    waitpid(pid, nullptr, 0);
+
+    return sample;
+}
+
+static void writeJson(const std::string& path, const Settings& settings, const std::vector<Result>& results)
+{
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not open " + path + " for writing");
+    }
+
+    // One result per line, which is all readBaseline() relies on
+    out << "{\n"
+        << "  \"seed\": " << settings.seed << ",\n"
+        << "  \"budget_ms\": " << settings.budget_ms << ",\n"
+        << "  \"results\": [\n";
+
+    for (size_t k = 0; k < results.size(); k++) {
+        const Result& r = results[k];
+        const Sample& s = r.sample;
+
+        char line[512];
+        snprintf(line, sizeof(line),
+                "    {\"map\": \"%s\", \"size\": \"%s\", \"engine\": \"%s\", \"ok\": %s, "
+                "\"found\": %s, \"timed_out\": %s, \"cost\": %lld, \"expanded\": %llu, "
+                "\"runs\": %u, \"ms\": %.6f, \"nodes_per_sec\": %.1f, \"ns_per_expansion\": %.3f, "
+                "\"peak_rss_kb\": %llu}%s\n",
+                r.map.c_str(), r.size.c_str(), r.engine.c_str(), s.ok ? "true" : "false",
+                s.found ? "true" : "false", s.timed_out ? "true" : "false",
+                (long long)s.cost, (unsigned long long)s.expanded, s.runs, s.ms,
+                r.nodesPerSec(), r.nsPerExpansion(), (unsigned long long)s.peak_rss_kb,
+                k + 1 < results.size() ? "," : "");
+        out << line;
+    }
+
+    out << "  ]\n"
+        << "}\n";
+}
+
+// Value of "key" in a line written by writeJson()
+static std::string field(const std::string& line, const char* key)
+{
+    std::string pattern = std::string("\"") + key + "\": ";
+    size_t p = line.find(pattern);
+    if (p == std::string::npos) return "";
+    p += pattern.size();
+
+    if (line[p] == '"') {
+        return line.substr(p + 1, line.find('"', p + 1) - p - 1);
+    }
+    return line.substr(p, line.find_first_of(",}", p) - p);
+}
+
+static std::map<std::string, Result> readBaseline(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    std::map<std::string, Result> baseline;
+    for (std::string line; std::getline(in, line); ) {
+        if (field(line, "map").empty()) continue;
+
+        Result r;
+        r.map    = field(line, "map");
+        r.size   = field(line, "size");
+        r.engine = field(line, "engine");
+
+        r.sample.ok          = field(line, "ok") == "true";
+        r.sample.found       = field(line, "found") == "true";
+        r.sample.timed_out   = field(line, "timed_out") == "true";
+        r.sample.cost        = std::stoll(field(line, "cost"));
+        r.sample.expanded    = std::stoull(field(line, "expanded"));
+        r.sample.ms          = std::stod(field(line, "ms"));
+        r.sample.peak_rss_kb = std::stoull(field(line, "peak_rss_kb"));
+
+        baseline[r.key()] = r;
+    }
+
+    return baseline;
+}
+
+// Prints every case that got slower, used more memory or found a path of
+// another cost. Returns the number of regressions.
+static u32 compare(const std::vector<Result>& results, const std::map<std::string, Result>& baseline, double threshold)
+{
+    u32 regressions = 0;
+    u32 compared = 0;
+
+    printf("\nAgainst the baseline (threshold %.0f%%):\n", threshold * 100);
+
+    for (const auto& r : results) {
+        auto it = baseline.find(r.key());
+        if (it == baseline.end() || !it->second.sample.ok || !r.sample.ok) continue;
+
+        const Result& b = it->second;
+        compared++;
+
+        std::vector<std::string> issues;
+        char text[96];
+
+        if (r.sample.found != b.sample.found || r.sample.cost != b.sample.cost) {
+            if (!r.sample.timed_out && !b.sample.timed_out) {
+                snprintf(text, sizeof(text), "cost %lld -> %lld",
+                        (long long)b.sample.cost, (long long)r.sample.cost);
+                issues.push_back(text);
+            }
+        }
+
+        if (b.nsPerExpansion() > 0 && r.nsPerExpansion() > b.nsPerExpansion() * (1 + threshold)) {
+            snprintf(text, sizeof(text), "ns/expansion %.1f -> %.1f (%+.0f%%)",
+                    b.nsPerExpansion(), r.nsPerExpansion(),
+                    100 * (r.nsPerExpansion() / b.nsPerExpansion() - 1));
+            issues.push_back(text);
+        }
+
+        if (b.sample.peak_rss_kb > 0 && r.sample.peak_rss_kb > b.sample.peak_rss_kb * (1 + threshold)) {
+            snprintf(text, sizeof(text), "peak RSS %.1f -> %.1f MB",
+                    b.sample.peak_rss_kb / 1024.0, r.sample.peak_rss_kb / 1024.0);
+            issues.push_back(text);
+        }
+
+        if (issues.empty()) continue;
+
+        regressions++;
+        printf("  REGRESSION %-30s", r.key().c_str());
+        for (size_t k = 0; k < issues.size(); k++) {
+            printf("%s%s", k ? ", " : " ", issues[k].c_str());
+        }
+        printf("\n");
+    }
+
+    printf("  %u of %u cases regressed\n", regressions, compared);
+
+    return regressions;
+}
+
+int main(int argc, char** argv)
+{
+    try {
+        Settings settings = parseSettings(argc, argv);
+        std::vector<Result> results;
+
+        printf("%-10s %-10s %-10s %5s %12s %12s %10s %10s %10s %9s\n",
+                "map", "size", "engine", "found", "cost", "expanded", "ms", "Mnodes/s", "ns/exp", "RSS MB");
+
+        for (const auto& size : settings.sizes) {
+            for (const auto& name : settings.maps) {
+                const MapCase& c = mapCase(name);
+
+                Grid grid;
+                SearchQuery query;
+                std::mt19937 rng(settings.seed);
+                generateMap(c.kind, size, c.density, rng, grid, query.start, query.target);
+                query.budget_ms = settings.budget_ms;
+
+                for (const auto& engine : settings.engines) {
+                    Result r;
+                    r.map    = name;
+                    r.size   = std::to_string(size.first) + "x" + std::to_string(size.second);
+                    r.engine = engine;
+                    r.sample = measureIsolated(engine, grid, query, settings.runs);
+
+                    const Sample& s = r.sample;
+                    if (!s.ok) {
+                        printf("%-10s %-10s %-10s failed\n", r.map.c_str(), r.size.c_str(), engine.c_str());
+                    } else {
+                        printf("%-10s %-10s %-10s %5s %12lld %12llu %10.3f %10.2f %10.1f %9.1f\n",
+                                r.map.c_str(), r.size.c_str(), engine.c_str(),
+                                s.timed_out ? "time" : s.found ? "yes" : "no",
+                                (long long)s.cost, (unsigned long long)s.expanded, s.ms,
+                                r.nodesPerSec() / 1e6, r.nsPerExpansion(), s.peak_rss_kb / 1024.0);
+                    }
+
+                    results.push_back(r);
+                }
+            }
+        }
+
+        if (!settings.json.empty()) {
+            writeJson(settings.json, settings, results);
+        }
+
+        if (!settings.baseline.empty()) {
+            if (compare(results, readBaseline(settings.baseline), settings.threshold) > 0) {
+                return EXIT_FAILURE;
+            }
+        }
+
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -14,7 +14,6 @@ AStar::AStar()
 
     state = EDITING;
     scalar = 1;
-    sim_thread = nullptr;
 }
 
 AStar::AStar(
@@ -36,94 +35,117 @@ AStar::AStar(
 
     state = EDITING;
     scalar = 1;
-    sim_thread = nullptr;
 }
 
 AStar::~AStar()
 {
-    delete sim_thread;
-    sim_thread = nullptr;
+    // The worker joins on destruction, the search must not wait that long
+    run_token.cancel();
 }
 
-void AStar::aStarPathfinding()
+void AStar::aStarPathfinding(
+        const CancelToken& token, 
+        const GridVersions::Snapshot& snapshot, 
+        const SearchQuery& query, 
+        const std::vector<std::pair<i32, i32>>& targets,
+        bool reachable)
 {
-    std::unordered_map<std::pair<i32, i32>, i32, pair_hash> gScore;
+    searched_version = snapshot.number();
 
-    std::unordered_map<std::pair<i32, i32>, std::pair<i32, i32>, pair_hash> parents;
+    // Start and target in different components, nothing to search
+    if (!reachable) {
+        finishRun(token);
+        return;
+    }
 
-    fScore[start] = gScore[start] = heuristic(start, target); 
+    Trace trace(this, token);
+    SearchResult result;
+    if (targets.empty()) {
+        result = engine->search(snapshot.grid(), query, &trace);
+    } else {
+        MultiTargetQuery multi_query;
+        multi_query.start   = query.start;
+        multi_query.targets = targets;
+        multi_query.budget_ms = query.budget_ms;
 
-    openSet.insert(std::pair<i32, std::pair<i32, i32>>(fScore[start], start));
+        i32 reached;
+        result = multi_search.nearest(snapshot.grid(), multi_query, reached, &trace);
+    }
 
-    while (!openSet.empty() && state == SIMULATING) {
-        std::pair<i32, i32> current = openSet.begin()->second;
+    {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        final_path = result.path;
+        epsilon_bound = result.epsilon;
+        last_result = result;
+        last_result.path.clear();
+    }
 
-        if (current == target) {
-            retracePath(current, parents);
-            state = FINISHED;
-        }
+    finishRun(token);
+}
 
-        openSet.erase(openSet.begin());
-        closedSet.insert(current);
-
-        std::vector<std::pair<i32, i32>> adjacentSquares = getAdjacentSquares(current);
-        for (const std::pair<i32, i32> &square : adjacentSquares) {
-            if (obstacle_tiles.find(square) != obstacle_tiles.end() || closedSet.find(square) != closedSet.end()) {
-                continue;
-            } else if (fScore.find(square) == fScore.end()) {
-                gScore[square] = gScore[current] + heuristic(current, square);
-                fScore[square] = gScore[square]  + heuristic(square, target) * (1.0f + TIE_BREAKER);
-                parents[square] = current;
-
-                openSet.insert(std::pair<i32, std::pair<i32, i32>>(fScore[square], square));
-            } else {
-                i32 new_gScore = gScore[current] + heuristic(current, square);
-                if (new_gScore < gScore[square]) {
-                    openSet.erase(std::pair<i32, std::pair<i32, i32>>(fScore[square], square)); 
-
-                    gScore[square] = new_gScore;
-                    fScore[square] = gScore[square] + heuristic(square, target) * (1.0f * TIE_BREAKER);
-                    parents[square] = current;
-
-                    openSet.insert(std::pair<i32, std::pair<i32, i32>>(fScore[square], square)); 
-                }
-            }
+void AStar::finishRun(const CancelToken& token)
+{
+    // A cancelled run leaves the state to whoever cancelled it. Only
+    // SIMULATING is replaced, so a stop that lands after the check is kept,
+    // and one stored later wins anyway.
+    short simulating = SIMULATING;
+    if (!token.cancelled()) {
+        state.compare_exchange_strong(simulating, (short)FINISHED);
+    }
+}
 
-            SDL_Delay(delay);
-        }
+void AStar::traceCell(const std::pair<i32, i32>& cell, u8 state, i64 f)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    i32 i = cell.second * trace_width + cell.first;
+    if (!(trace_cells[i] & TRACE_LISTED)) {
+        touched.push_back(i);
     }
 
-    state = FINISHED;
+    trace_cells[i] = state | TRACE_LISTED;
+    if (state == CELL_OPEN) {
+        trace_f[i] = f;
+    }
+
+    changes++;
+}
+
+void AStar::Trace::onOpen(const std::pair<i32, i32>& cell, i64 f)
+{
+    owner->traceCell(cell, CELL_OPEN, f);
 }
 
-void AStar::retracePath(
-        const std::pair<i32, i32> &current, 
-        const std::unordered_map<std::pair<i32, i32>, 
-            std::pair<i32, i32>, pair_hash> &parents) 
+void AStar::Trace::onClose(const std::pair<i32, i32>& cell)
 {
-    final_path = {current};
+    owner->traceCell(cell, CELL_CLOSED, 0);
 
-    auto parent = current;
-    do {
-        parent = parents.find(parent)->second; 
-        final_path.push_back(parent);
-    } while (parents.find(parent) != parents.end());
+    if (owner->frame_hook) {
+        if (++owner->frame_steps % owner->frame_interval == 0) {
+            owner->frame_hook();
+        }
+    } else {
+        SDL_Delay(owner->delay);
+    }
 }
 
-std::vector<std::pair<i32, i32>> AStar::getAdjacentSquares(
-        const std::pair<i32, i32> &current)
+void AStar::Trace::onDrop(const std::pair<i32, i32>& cell)
 {
-    std::vector<std::pair<i32, i32>> adjacentSquares;
+    owner->traceCell(cell, CELL_FREE, 0);
+}
 
-    i32 f = current.first;
-    i32 s = current.second;
+void AStar::Trace::onImprove(const SearchResult& result)
+{
+    std::lock_guard<std::mutex> lock(owner->trace_mutex);
 
-    if (f > 0) adjacentSquares.push_back(std::pair<i32, i32>(f - 1, s));
-    if (s > 0) adjacentSquares.push_back(std::pair<i32, i32>(f, s - 1));
-    if (f < dimensions.first - 1) adjacentSquares.push_back(std::pair<i32, i32>(f + 1, s));
-    if (s < dimensions.second - 1) adjacentSquares.push_back(std::pair<i32, i32>(f, s + 1));
+    owner->final_path = result.path;
+    owner->epsilon_bound = result.epsilon;
+    owner->changes++;
+}
 
-    return adjacentSquares; 
+bool AStar::Trace::cancelled() const
+{
+    return token.cancelled();
 }
 
 i32 AStar::heuristic(const std::pair<i32, i32> &a, const std::pair<i32, i32> &b) const {
@@ -133,40 +155,405 @@ i32 AStar::heuristic(const std::pair<i32, i32> &a, const std::pair<i32, i32> &b)
     return 10 * (dx + dy);
 }
 
+bool AStar::isTarget(const std::pair<i32, i32>& cell) const
+{
+    return cell == target 
+        || std::find(extra_targets.begin(), extra_targets.end(), cell) != extra_targets.end();
+}
+
+bool AStar::isEndpoint(const std::pair<i32, i32>& cell) const
+{
+    return cell == start || isTarget(cell);
+}
+
+std::vector<std::pair<i32, i32>> AStar::searchTargets() const
+{
+    if (extra_targets.empty()) {
+        return {};
+    }
+
+    std::vector<std::pair<i32, i32>> targets = {target};
+    targets.insert(targets.end(), extra_targets.begin(), extra_targets.end());
+    return targets;
+}
+
+bool AStar::anyReachable(const std::vector<std::pair<i32, i32>>& targets)
+{
+    if (targets.empty()) {
+        return components.connected(grid, start, target);
+    }
+
+    for (const auto& cell : targets) {
+        if (components.connected(grid, start, cell)) return true;
+    }
+    return false;
+}
+
+void AStar::toggleTarget(const std::pair<i32, i32>& cell)
+{
+    auto it = std::find(extra_targets.begin(), extra_targets.end(), cell);
+    if (it != extra_targets.end()) {
+        extra_targets.erase(it);
+    } else if (grid.inBounds(cell) && !grid.isObstacle(cell) && cell != start && cell != target) {
+        extra_targets.push_back(cell);
+    } else {
+        return;
+    }
+
+    changes++;
+}
+
+void AStar::dropOutsideTargets()
+{
+    auto gone = [&](const std::pair<i32, i32>& cell) {
+        return !grid.inBounds(cell) || grid.isObstacle(cell) || cell == start || cell == target;
+    };
+    extra_targets.erase(std::remove_if(extra_targets.begin(), extra_targets.end(), gone), extra_targets.end());
+}
+
+void AStar::clearTargets()
+{
+    extra_targets.clear();
+    changes++;
+}
+
+void AStar::edited()
+{
+    grid_dirty = true;
+    changes++;
+}
+
+void AStar::recordFlowChange(const std::pair<i32, i32>& cell)
+{
+    // Nobody looks at a hidden field, rebuild it once it is shown again
+    if (show_flow && !flow_stale) {
+        flow_changes.push_back(cell);
+    } else {
+        flow_stale = true;
+    }
+}
+
+const FlowField& AStar::getFlowField()
+{
+    if (flow_stale || !flow_field.isBuilt() || flow_field.getTarget() != target) {
+        flow_field.build(grid, target);
+        flow_stale = false;
+        flow_version++;
+    } else {
+        // Resizing marks the field stale, so only edits change it here
+        if (!flow_changes.empty()) flow_version++;
+        flow_field.update(grid, flow_changes);
+    }
+
+    flow_changes.clear();
+
+    return flow_field;
+}
+
+void AStar::paintCost(const std::pair<i32, i32>& center, i32 radius, u8 cost)
+{
+    if (!show_flow) {
+        grid.paintCost(center, radius, cost);
+        edited();
+        flow_stale = true;
+        return;
+    }
+
+    // Only cells whose cost really changed have to be repaired
+    std::vector<u8> before;
+    for (i32 y = center.second - radius; y <= center.second + radius; y++) {
+        for (i32 x = center.first - radius; x <= center.first + radius; x++) {
+            before.push_back(grid.inBounds({x, y}) ? grid.getCost({x, y}) : 0);
+        }
+    }
+
+    grid.paintCost(center, radius, cost);
+    edited();
+
+    size_t k = 0;
+    for (i32 y = center.second - radius; y <= center.second + radius; y++) {
+        for (i32 x = center.first - radius; x <= center.first + radius; x++, k++) {
+            if (grid.inBounds({x, y}) && grid.getCost({x, y}) != before[k]) {
+                recordFlowChange({x, y});
+            }
+        }
+    }
+}
+
+void AStar::clearCosts()
+{
+    grid.clearCosts();
+    edited();
+    flow_stale = true;
+}
+
 void AStar::addObstacle(const std::pair<i32, i32>& new_obst)
 {
-    obstacle_tiles.insert(new_obst);
+    if (grid.inBounds(new_obst) && !grid.isObstacle(new_obst)) {
+        grid.set(new_obst);
+        edited();
+        components.onObstacleAdded(grid, new_obst);
+        recordFlowChange(new_obst);
+    }
 }
 
 void AStar::addObstacle(const std::vector<std::pair<i32, i32>>& obst)
 {
-    obstacle_tiles.insert(obst.begin(), obst.end());
+    for (const auto& o : obst) {
+        grid.set(o);
+    }
+
+    edited();
+    components.invalidate();
+    flow_stale = true;
 }
 
 void AStar::removeObstacle(const std::pair<i32, i32>& obst)
 {
-    obstacle_tiles.erase(obst);
+    if (grid.inBounds(obst) && grid.isObstacle(obst)) {
+        grid.reset(obst);
+        edited();
+        components.onObstacleRemoved(grid, obst);
+        recordFlowChange(obst);
+    }
 }
 
 void AStar::clearObstacles()
 {
-    obstacle_tiles.clear();
+    grid.clear();
+    edited();
+    components.invalidate();
+    flow_stale = true;
 }
 
-void AStar::startSimulation()
+void AStar::fillObstacles(
+        const std::pair<i32, i32>& a, 
+        const std::pair<i32, i32>& b, 
+        bool value, 
+        const std::function<void(const std::pair<i32, i32>&)>& visit)
 {
-    state = SIMULATING;
+    grid.fillRect(a, b, value, [&](const std::pair<i32, i32>& cell) {
+        if (isEndpoint(cell)) {
+            grid.flip(cell);
+        } else {
+            visit(cell);
+            recordFlowChange(cell);
+        }
+    });
+
+    edited();
+    components.invalidate();
+}
+
+void AStar::lineObstacles(
+        const std::pair<i32, i32>& a, 
+        const std::pair<i32, i32>& b, 
+        bool value, 
+        const std::function<void(const std::pair<i32, i32>&)>& visit)
+{
+    grid.drawLine(a, b, value, [&](const std::pair<i32, i32>& cell) {
+        if (isEndpoint(cell)) {
+            grid.flip(cell);
+        } else {
+            visit(cell);
+            recordFlowChange(cell);
+        }
+    });
+
+    edited();
+    components.invalidate();
+}
+
+void AStar::floodObstacles(
+        const std::pair<i32, i32>& seed, 
+        bool value, 
+        const std::function<void(const std::pair<i32, i32>&)>& visit)
+{
+    // The fill spreads through start and targets like any free cell, they are
+    // left out of the record and cleared again afterwards
+    grid.floodFill(seed, value, [&](const std::pair<i32, i32>& cell) {
+        if (!isEndpoint(cell)) {
+            visit(cell);
+            recordFlowChange(cell);
+        }
+    });
+
+    if (value) {
+        grid.reset(start);
+        grid.reset(target);
+        for (const auto& cell : extra_targets) grid.reset(cell);
+    }
+
+    edited();
+    components.invalidate();
+}
+
+void AStar::invertObstacles(
+        const std::pair<i32, i32>& a, 
+        const std::pair<i32, i32>& b)
+{
+    grid.invertRect(a, b, [&](const std::pair<i32, i32>& cell) {
+        if (isEndpoint(cell)) {
+            grid.flip(cell);
+        } else {
+            recordFlowChange(cell);
+        }
+    });
+
+    edited();
+    components.invalidate();
+}
+
+void AStar::resetTrace()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+
+    // Only the cells reached last time need clearing, unless the size changed
+    auto [width, height] = grid.getDimensions();
+    if (width != trace_width || trace_cells.size() != (size_t)width * height) {
+        trace_width = width;
+        trace_cells.assign((size_t)width * height, CELL_FREE);
+        trace_f.resize((size_t)width * height);
+    } else {
+        for (i32 i : touched) trace_cells[i] = CELL_FREE;
+    }
+    touched.clear();
 
-    openSet.clear();
-    closedSet.clear();
-    fScore.clear();
     final_path.clear();
+    epsilon_bound = 1.0;
+    last_result = SearchResult();
+    changes++;
+}
+
+u8 AStar::cellState(const std::pair<i32, i32>& cell) const
+{
+    if (cell == start) return CELL_START;
+    if (isTarget(cell)) return CELL_TARGET;
+    if (grid.isObstacle(cell)) return CELL_OBSTACLE;
+
+    return view().state(cell);
+}
+
+void AStar::prepareRun()
+{
+    // The previous run must be gone before its containers are reset
+    run_token.cancel();
+    worker.cancelAll();
+    worker.wait();
+
+    if (engine_stale || !engine) {
+        engine = createEngine(engine_name, engine_config);
+        engine_stale = false;
+    }
+
+    publishGrid();
+
+    state = SIMULATING;
+    resetTrace();
+}
+
+void AStar::publishGrid()
+{
+    if (grid_dirty) {
+        versions.publish(grid);
+        grid_dirty = false;
+    }
+}
+
+void AStar::startSimulation()
+{
+    prepareRun();
+
+    // Everything the search needs is taken here, on the thread that edits
+    SearchQuery query;
+    query.start  = start;
+    query.target = target;
+    query.budget_ms = budget_ms;
+
+    auto targets = searchTargets();
+    bool reachable = anyReachable(targets);
+    auto snapshot = std::make_shared<GridVersions::Snapshot>(versions.pin());
+
+    run_token = worker.submit([this, snapshot, query, targets, reachable](const CancelToken& token) {
+        aStarPathfinding(token, *snapshot, query, targets, reachable);
+    });
+}
+
+void AStar::runSimulation(u64 frame_interval, const std::function<void()>& frame)
+{
+    prepareRun();
+
+    this->frame_interval = std::max<u64>(frame_interval, 1);
+    frame_steps = 0;
+    frame_hook = frame;
+
+    SearchQuery query;
+    query.start  = start;
+    query.target = target;
+    query.budget_ms = budget_ms;
+
+    auto targets = searchTargets();
+    run_token = CancelToken();
+    aStarPathfinding(run_token, versions.pin(), query, targets, anyReachable(targets));
+
+    frame_hook = nullptr;
+}
+
+static inline ImVec4 toImVec4(const std::array<float, 4>& c)
+{
+    return {c[0], c[1], c[2], c[3]};
+}
+
+static inline std::array<float, 4> fromImVec4(const ImVec4& c)
+{
+    return {c.x, c.y, c.z, c.w};
+}
 
-    sim_thread = new std::thread( [this] { aStarPathfinding(); } );
-    sim_thread->detach();
+void AStar::applyScene(Scene& scene)
+{
+    // The running search reads the grid that is replaced
+    run_token.cancel();
+    worker.cancelAll();
+    worker.wait();
+
+    state = EDITING;
+    resetTrace();
 
-    delete sim_thread;
-    sim_thread = nullptr;
+    // Scenes hold one target
+    extra_targets.clear();
+
+    // setGrid() derives the scalar from the grid, the stored one may be
+    // that of another window
+    setGrid(std::move(scene.grid));
+    start  = scene.start;
+    target = scene.target;
+    delay  = scene.delay;
+
+    start_color    = toImVec4(scene.colors[COLOR_START]);
+    target_color   = toImVec4(scene.colors[COLOR_TARGET]);
+    obstacle_color = toImVec4(scene.colors[COLOR_OBSTACLE]);
+    grid_color     = toImVec4(scene.colors[COLOR_GRID]);
+    open_color     = toImVec4(scene.colors[COLOR_OPEN]);
+    closed_color   = toImVec4(scene.colors[COLOR_CLOSED]);
+}
+
+Scene AStar::toScene() const
+{
+    Scene scene;
+    scene.grid   = grid;
+    scene.start  = start;
+    scene.target = target;
+    scene.scalar = scalar;
+    scene.delay  = delay;
+
+    scene.colors[COLOR_START]    = fromImVec4(start_color);
+    scene.colors[COLOR_TARGET]   = fromImVec4(target_color);
+    scene.colors[COLOR_OBSTACLE] = fromImVec4(obstacle_color);
+    scene.colors[COLOR_GRID]     = fromImVec4(grid_color);
+    scene.colors[COLOR_OPEN]     = fromImVec4(open_color);
+    scene.colors[COLOR_CLOSED]   = fromImVec4(closed_color);
+
+    return scene;
 }
 
 bool AStar::stateEditing() const 
@@ -230,24 +617,27 @@ bool AStar::mouseOutOfBounds(std::pair<i32, i32> mouse_pos) const
 
 bool AStar::mouseOnOtherTile(std::pair<i32, i32> mouse_pos, short selected) const
 {
-    bool mouse_obst = obstacle_tiles.find(mouse_pos) != obstacle_tiles.end();
+    bool mouse_obst = grid.isObstacle(mouse_pos);
 
     switch (selected) {
         case START:
-            if (mouse_pos == target || mouse_obst) {
+            if (isTarget(mouse_pos) || mouse_obst) {
                 return true;
             }
             break;
 
         case TARGET:
-            if (mouse_pos == start || mouse_obst) {
+            if (mouse_pos != target && isEndpoint(mouse_pos)) {
+                return true;
+            }
+            if (mouse_obst) {
                 return true;
             }
             break;
 
         case OBSTACLE:
         case BLANCK:
-            if (mouse_pos == start || mouse_pos == target) {
+            if (isEndpoint(mouse_pos)) {
                 return true;
             }
             break;
@@ -261,6 +651,11 @@ bool AStar::mouseOnOtherTile(std::pair<i32, i32> mouse_pos, short selected) cons
 
 void AStar::setState(short state)
 {
+    // Leaving SIMULATING aborts the running search
+    if (state != SIMULATING) {
+        run_token.cancel();
+    }
+
     this->state = state; 
 }
 
@@ -271,9 +666,18 @@ void AStar::setSelected(short selected)
 
 void AStar::setScalar(i32 scalar) 
 {
+    // Resizing invalidates the flow field and everything else derived
+    if (scalar == this->scalar && dimensions == std::make_pair(BASE_WIDTH * scalar, BASE_HEIGHT * scalar)) {
+        return;
+    }
+
     this->scalar = scalar;
 
     dimensions = {BASE_WIDTH * scalar, BASE_HEIGHT * scalar};
+    grid.resize(dimensions.first, dimensions.second);
+    edited();
+    components.invalidate();
+    flow_stale = true;
 
     if (start.first >= dimensions.first || start.second >= dimensions.second) {
         start.first  = 0;
@@ -284,6 +688,8 @@ void AStar::setScalar(i32 scalar)
         target.first  = dimensions.first  - 1;
         target.second = dimensions.second - 1;
     }
+
+    dropOutsideTargets();
 }
 
 void AStar::setDelay(i32 delay)
@@ -294,6 +700,11 @@ void AStar::setDelay(i32 delay)
 void AStar::setDimensions(std::pair<i32, i32> dimensions)
 {
     this->dimensions = dimensions;
+    grid.resize(dimensions.first, dimensions.second);
+    dropOutsideTargets();
+    edited();
+    components.invalidate();
+    flow_stale = true;
 
     i32 dx = dimensions.first  / BASE_WIDTH;
     i32 dy = dimensions.second / BASE_HEIGHT;
@@ -305,19 +716,52 @@ void AStar::setDimensions(std::pair<i32, i32> dimensions)
     scalar = dx;
 }
 
+void AStar::setGridSize(std::pair<i32, i32> dimensions)
+{
+    // Any size, the window keeps to 16:9 but offscreen surfaces need not
+    this->dimensions = dimensions;
+    grid.resize(dimensions.first, dimensions.second);
+    dropOutsideTargets();
+    edited();
+    components.invalidate();
+    flow_stale = true;
+
+    scalar = std::max(1, dimensions.first / BASE_WIDTH);
+}
+
+void AStar::setGrid(Grid grid)
+{
+    this->grid = std::move(grid);
+    dropOutsideTargets();
+    edited();
+    dimensions = this->grid.getDimensions();
+    components.invalidate();
+    flow_stale = true;
+
+    scalar = std::max(1, dimensions.first / BASE_WIDTH);
+}
+
+void AStar::setDeltaLength(i32 delta_length)
+{
+    this->delta_length = delta_length;
+}
+
 void AStar::setStart(const std::pair<i32, i32>& start)
 {
     this->start = start;
+    changes++;
 }
 
 void AStar::setTarget(const std::pair<i32, i32>& target)
 {
     this->target = target;
+    changes++;
 }
 
 void AStar::setObstacles(const std::vector<std::pair<i32, i32>>& obstacle_tiles)
 {
-    this->obstacle_tiles = std::unordered_set<std::pair<i32, i32>, pair_hash>(obstacle_tiles.begin(), obstacle_tiles.end());
+    grid.clear();
+    addObstacle(obstacle_tiles);
 }
 
 void AStar::setStartColor(ImVec4 start_color)
@@ -354,3 +798,34 @@ void AStar::setClosedColorStatic(bool isStatic)
 {
     this->static_closedColor = isStatic;
 }
+
+void AStar::setCostsShown(bool shown)
+{
+    this->show_costs = shown;
+}
+
+void AStar::setFlowShown(bool shown)
+{
+    this->show_flow = shown;
+}
+
+void AStar::setEngine(const std::string& engine_name)
+{
+    if (engine_name != this->engine_name) {
+        this->engine_name = engine_name;
+        engine_stale = true;
+    }
+}
+
+void AStar::setEngineConfig(const EngineConfig& engine_config)
+{
+    if (engine_config != this->engine_config) {
+        this->engine_config = engine_config;
+        engine_stale = true;
+    }
+}
+
+void AStar::setBudget(double budget_ms)
+{
+    this->budget_ms = budget_ms;
+}
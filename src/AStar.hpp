@@ -1,11 +1,23 @@
-#ifndef GRID_HPP
-#define GRID_HPP
+#ifndef ASTAR_HPP
+#define ASTAR_HPP
+
+#include <mutex>
+#include <string>
 
 #include <SDL2/SDL.h>
 
 #include "../imgui/imgui.h"
 
 #include "Util.hpp"
+#include "Grid.hpp"
+#include "GridVersions.hpp"
+#include "Components.hpp"
+#include "FlowField.hpp"
+#include "Engines.hpp"
+#include "MultiTarget.hpp"
+#include "Worker.hpp"
+#include "Scene.hpp"
+#include "Span.hpp"
 
 #define BASE_WIDTH 16
 #define BASE_HEIGHT 9
@@ -24,17 +36,43 @@ enum Tiles {
     START
 };
 
+// What a cell shows, see AStar::cellState()
+enum CellStates {
+    CELL_FREE,
+    CELL_OPEN,
+    CELL_CLOSED,
+    CELL_OBSTACLE,
+    CELL_START,
+    CELL_TARGET
+};
+
 class AStar {
 
     private:
-        // Tie braker: 
-        // https://theory.stanford.edu/~amitp/GameProgramming/Heuristics.html#breaking-ties
-        static constexpr float TIE_BREAKER = 0.1f;
+        // Mirrors the progress of the running engine into the sets drawn by
+        // the visualization, and slows it down by 'delay' or hands every
+        // 'frame_interval'-th expansion to the frame hook
+        class Trace : public SearchObserver {
+
+            private:
+                AStar* owner;
+                CancelToken token;
+
+            public:
+                Trace(AStar* owner, const CancelToken& token) : owner(owner), token(token) {}
+
+                void onOpen(const std::pair<i32, i32>& cell, i64 f) override;
+                void onClose(const std::pair<i32, i32>& cell) override;
+                void onDrop(const std::pair<i32, i32>& cell) override;
+                void onImprove(const SearchResult& result) override;
+                bool cancelled() const override;
+
+        };
 
         // Attributes
         bool show_grid = true;
         
-        short state;
+        std::atomic<short> state;
         short selected;
 
         i32 delta_length;
@@ -46,14 +84,55 @@ class AStar {
         std::pair<i32, i32> start;
         std::pair<i32, i32> target;
 
-        std::unordered_set<std::pair<i32, i32>, pair_hash> obstacle_tiles;
+        // More targets, with any the search ends at whichever is nearest
+        std::vector<std::pair<i32, i32>> extra_targets;
+
+        // Draft edited on the UI thread, searches read the version published
+        // when they started and never touch it
+        Grid grid;
+        GridVersions versions;
+        bool grid_dirty = true;     // Edited since the last publish
+        std::atomic<u64> searched_version{0};
+
+        // Bumped by every change of what is drawn: edits, moves, search steps
+        std::atomic<u64> changes{0};
 
-        std::set<std::pair<i32, std::pair<i32, i32>>> openSet;
-        std::unordered_set<std::pair<i32, i32>, pair_hash> closedSet;
+        Components components;
 
-        std::unordered_map<std::pair<i32, i32>, i32, pair_hash> fScore;
+        std::string engine_name = "astar";
+        EngineConfig engine_config;
+        double budget_ms = 0.0;
+
+        // Kept between runs so the engine's scratch memory stays warm, only
+        // rebuilt by the next run after the engine or its config changed
+        std::unique_ptr<SearchEngine> engine;
+        bool engine_stale = true;
+
+        // Replaces the engine while there are extra targets
+        MultiTargetSearch multi_search;
+
+        // Search state shown while simulating, guarded by 'trace_mutex'. One
+        // entry per cell; a cell is listed in 'touched' the first time the
+        // search reaches it, so drawing and resetting skip the rest.
+        static constexpr u8 TRACE_LISTED = 0x80;
+
+        mutable std::mutex trace_mutex;
+
+        i32 trace_width = 0;
+        std::vector<u8> trace_cells;    // CELL_FREE, CELL_OPEN or CELL_CLOSED, | TRACE_LISTED
+        std::vector<i64> trace_f;
+        std::vector<i32> touched;
 
         std::vector<std::pair<i32, i32>> final_path;
+        double epsilon_bound = 1.0;
+        SearchResult last_result;   // Statistics of the finished search
+
+        // Flow field to the target, repaired lazily from the cells edited
+        // since it was last drawn
+        FlowField flow_field;
+        std::vector<std::pair<i32, i32>> flow_changes;
+        bool flow_stale = true;
+        u64 flow_version = 0;       // Bumped whenever the field changes
 
         ImVec4 start_color;
         ImVec4 target_color;
@@ -63,28 +142,92 @@ class AStar {
         ImVec4 closed_color;
 
         bool static_closedColor = false;
+        bool show_costs = true;
+        bool show_flow = false;
 
-        std::thread* sim_thread;
+        // Called from the search instead of the delay while recording
+        std::function<void()> frame_hook;
+        u64 frame_interval = 1;
+        u64 frame_steps = 0;
 
-        // A* Algorithm
-        void aStarPathfinding();
-        void retracePath(
-                const std::pair<i32, i32> &current, 
-                const std::unordered_map<std::pair<i32, i32>, 
-                    std::pair<i32, i32>, pair_hash> &parents);
-        std::vector<std::pair<i32, i32>> getAdjacentSquares(
-                const std::pair<i32, i32> &current);
+        // Runs the searches, declared last so it is joined before anything
+        // a running search touches is destroyed
+        CancelToken run_token;
+        Worker worker;
+
+        // A* Algorithm, to the nearest of 'targets' unless it is empty
+        void aStarPathfinding(
+                const CancelToken& token, 
+                const GridVersions::Snapshot& snapshot, 
+                const SearchQuery& query, 
+                const std::vector<std::pair<i32, i32>>& targets,
+                bool reachable);
+        void finishRun(const CancelToken& token);
         i32 heuristic(
                 const std::pair<i32, i32> &a, 
                 const std::pair<i32, i32> &b) const;
 
+        // Start, target or an extra target, none of which become obstacles
+        bool isEndpoint(const std::pair<i32, i32>& cell) const;
+        // All targets if there are extra ones, none otherwise
+        std::vector<std::pair<i32, i32>> searchTargets() const;
+        bool anyReachable(const std::vector<std::pair<i32, i32>>& targets);
+        // Forgets extra targets the grid no longer has room for
+        void dropOutsideTargets();
+
+        void recordFlowChange(const std::pair<i32, i32>& cell);
+        void edited();
+        void resetTrace();
+        void traceCell(const std::pair<i32, i32>& cell, u8 state, i64 f);
+        void prepareRun();
+        void publishGrid();
+
     public:
+        // Read-only access to the search state without copying it. Holds the
+        // trace lock while it lives, the search waits for it at its next step,
+        // so it should not outlive a frame.
+        class TraceView {
+
+            private:
+                std::unique_lock<std::mutex> lock;
+                const AStar* owner;
+
+            public:
+                TraceView(const AStar* owner) : lock(owner->trace_mutex), owner(owner) {}
+
+                // Cells the search reached, in that order; dropped cells are
+                // still listed, with CELL_FREE as state
+                inline CellSpan cells() const 
+                    { return CellSpan(owner->touched, owner->trace_width); }
+
+                // CELL_FREE, CELL_OPEN or CELL_CLOSED
+                inline u8 state(const std::pair<i32, i32>& cell) const
+                {
+                    if (cell.first < 0 || cell.first >= owner->trace_width || cell.second < 0) return CELL_FREE;
+                    size_t i = (size_t)cell.second * owner->trace_width + cell.first;
+                    return i < owner->trace_cells.size() ? owner->trace_cells[i] & ~TRACE_LISTED : CELL_FREE;
+                }
+
+                // f value the cell was last opened with, only for cells reached
+                inline i64 fScore(const std::pair<i32, i32>& cell) const
+                    { return owner->trace_f[(size_t)cell.second * owner->trace_width + cell.first]; }
+
+                // Final path, or the best one so far of an anytime engine
+                inline Span<std::pair<i32, i32>> path() const { return owner->final_path; }
+
+        };
+
         AStar();
         AStar(const std::pair<i32, i32>& start, const std::pair<i32, i32>& target);
         ~AStar();
 
-        // A* Algorithm
+        // A* Algorithm, cancels a search still running before it starts. The
+        // search runs on the grid as it is now, later edits do not reach it.
         void startSimulation();
+
+        // Searches on the calling thread and calls 'frame' after every
+        // 'frame_interval' expansions, while the search is paused
+        void runSimulation(u64 frame_interval, const std::function<void()>& frame);
         
         // State
         bool stateEditing() const;
@@ -98,6 +241,42 @@ class AStar {
         void removeObstacle(const std::pair<i32, i32>& obst);
         void clearObstacles();
 
+        // Region tools, 'visit' receives every cell that changed. Start and
+        // target are never turned into obstacles.
+        void fillObstacles(
+                const std::pair<i32, i32>& a, 
+                const std::pair<i32, i32>& b, 
+                bool value, 
+                const std::function<void(const std::pair<i32, i32>&)>& visit);
+        void lineObstacles(
+                const std::pair<i32, i32>& a, 
+                const std::pair<i32, i32>& b, 
+                bool value, 
+                const std::function<void(const std::pair<i32, i32>&)>& visit);
+        void floodObstacles(
+                const std::pair<i32, i32>& seed, 
+                bool value, 
+                const std::function<void(const std::pair<i32, i32>&)>& visit);
+        void invertObstacles(
+                const std::pair<i32, i32>& a, 
+                const std::pair<i32, i32>& b);
+
+        // Extra targets, placed on free cells other than start and target
+        void toggleTarget(const std::pair<i32, i32>& cell);
+        void clearTargets();
+
+        // Terrain costs
+        void paintCost(const std::pair<i32, i32>& center, i32 radius, u8 cost);
+        void clearCosts();
+
+        // Flow field to the target, brought up to date with the edits first
+        const FlowField& getFlowField();
+
+        // Scenes, the background color is left to the caller. Applying one
+        // moves its grid in and cancels a running search.
+        void applyScene(Scene& scene);
+        Scene toScene() const;
+
         // Mouse
         std::pair<i32, i32> mouseGetOver(i32 x_mouse, i32 y_mouse) const;
         bool mouseOutOfBounds(std::pair<i32, i32> mouse_pos) const;
@@ -112,6 +291,9 @@ class AStar {
         void setScalar(i32 scalar);
         void setDelay(i32 delay);
         void setDimensions(std::pair<i32, i32> dimensions);
+        void setGridSize(std::pair<i32, i32> dimensions);
+        void setGrid(Grid grid);
+        void setDeltaLength(i32 delta_length);
         void setStart(const std::pair<i32, i32>& start);
         void setTarget(const std::pair<i32, i32>& target);
         void setObstacles(const std::vector<std::pair<i32, i32>>& obstacle_tiles);
@@ -122,6 +304,11 @@ class AStar {
         void setOpenColor(ImVec4 open_color);
         void setClosedColor(ImVec4 closed_color);
         void setClosedColorStatic(bool isStatic);
+        void setCostsShown(bool shown);
+        void setFlowShown(bool shown);
+        void setEngine(const std::string& engine_name);
+        void setEngineConfig(const EngineConfig& engine_config);
+        void setBudget(double budget_ms);
 
         // Getters
         inline short
@@ -142,10 +329,34 @@ class AStar {
             getStart() const { return start; }
         inline std::pair<i32, i32> 
             getTarget() const { return target; }
-        inline std::unordered_set<std::pair<i32, i32>, pair_hash> 
-            getObstacles() const { return obstacle_tiles; }
-        inline std::vector<std::pair<i32, i32>> 
-            getFinalPath() const { return final_path; }
+        inline const std::vector<std::pair<i32, i32>>&
+            getExtraTargets() const { return extra_targets; }
+        bool isTarget(const std::pair<i32, i32>& cell) const;
+        inline const Grid&
+            getGrid() const { return grid; }
+        inline bool
+            isObstacle(const std::pair<i32, i32>& cell) const { return grid.isObstacle(cell); }
+        // O(1), locks the trace for a moment
+        u8 cellState(const std::pair<i32, i32>& cell) const;
+        inline TraceView
+            view() const { return TraceView(this); }
+        inline u64
+            getVersion() const { return changes; }
+        // Of the field getFlowField() returned last, the trace leaves it be
+        inline u64
+            getFlowVersion() const { return flow_version; }
+        inline bool
+            editedSinceSearch() const { return grid_dirty || versions.version() != searched_version; }
+        inline double
+            getEpsilonBound() const { std::lock_guard<std::mutex> lock(trace_mutex); return epsilon_bound; }
+        inline SearchResult
+            getLastResult() const { std::lock_guard<std::mutex> lock(trace_mutex); return last_result; }
+        inline const std::string&
+            getEngine() const { return engine_name; }
+        inline const EngineConfig&
+            getEngineConfig() const { return engine_config; }
+        inline double
+            getBudget() const { return budget_ms; }
         inline ImVec4 
             getStartColor() const { return start_color; }
         inline ImVec4 
@@ -158,14 +369,12 @@ class AStar {
             getClosedColor() const { return closed_color; }
         inline bool 
             closedColorIsStatic() const { return static_closedColor; }
+        inline bool 
+            costsAreShown() const { return show_costs; }
+        inline bool 
+            flowIsShown() const { return show_flow; }
         inline ImVec4 
             getGridColor() const { return grid_color; }
-        inline std::set<std::pair<i32, std::pair<i32, i32>>>
-            getOpenSet() const { return openSet; }
-        inline std::unordered_set<std::pair<i32, i32>, pair_hash> 
-            getClosedSet() const { return closedSet; }
-        inline std::unordered_map<std::pair<i32, i32>, i32, pair_hash> 
-            getFScore() const { return fScore; }
 
         inline i32 
             getHeuristic(const std::pair<i32, i32> &a, 
@@ -174,4 +383,4 @@ class AStar {
 
 };
 
-#endif //GRID_HPP
+#endif //ASTAR_HPP
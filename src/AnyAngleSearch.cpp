@@ -0,0 +1,215 @@
+#include <cmath>
+#include <limits>
+#include <queue>
+
+#include "AnyAngleSearch.hpp"
+
+static inline double euclidean(const std::pair<i32, i32>& a, const std::pair<i32, i32>& b)
+{
+    return std::hypot((double)(a.first - b.first), (double)(a.second - b.second));
+}
+
+double search::segmentCost(const Grid& grid, const std::pair<i32, i32>& a, const std::pair<i32, i32>& b)
+{
+    u8 cost = grid.lineOfSight(a, b);
+    if (cost == 0) return -1.0;
+
+    return STEP_COST * cost * euclidean(a, b);
+}
+
+double search::pathCost(const Grid& grid, const std::vector<std::pair<i32, i32>>& path)
+{
+    double total = 0.0;
+    for (size_t k = 1; k < path.size(); k++) {
+        double c = segmentCost(grid, path[k - 1], path[k]);
+        if (c < 0) return -1.0;
+        total += c;
+    }
+
+    return total;
+}
+
+u64 search::smoothPath(const Grid& grid, std::vector<std::pair<i32, i32>>& path)
+{
+    if (path.size() < 3) return 0;
+
+    std::vector<std::pair<i32, i32>> smooth = {path[0]};
+    u64 checks = 0;
+
+    // Cost from the last kept waypoint to path[k] along the smoothed path
+    double reached = segmentCost(grid, path[0], path[1]);
+
+    for (size_t k = 1; k + 1 < path.size(); k++) {
+        double via    = reached + segmentCost(grid, path[k], path[k + 1]);
+        double direct = segmentCost(grid, smooth.back(), path[k + 1]);
+        checks++;
+
+        // Cutting the corner must not cross dearer terrain than the detour
+        if (direct >= 0 && direct <= via + 1e-9) {
+            reached = direct;
+        } else {
+            smooth.push_back(path[k]);
+            reached = segmentCost(grid, path[k], path[k + 1]);
+        }
+    }
+
+    smooth.push_back(path.back());
+    path.swap(smooth);
+
+    return checks;
+}
+
+SearchResult ThetaStarSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    SearchResult result;
+    line_checks = 0;
+
+    const i32 width = grid.getWidth();
+    const auto& target = query.target;
+
+    auto index  = [&](const std::pair<i32, i32>& c) { return c.second * width + c.first; };
+    auto cellOf = [&](i32 i) { return std::pair<i32, i32>(i % width, i / width); };
+
+    // Dense per-cell state, the grid is dense anyway. Cells not touched yet
+    // read as unreached.
+    const double INF = std::numeric_limits<double>::infinity();
+    nodes.reset((size_t)width * grid.getHeight());
+    auto node = [&](i32 i) -> Node& {
+        if (!nodes.has(i)) nodes.set(i, {INF, -1, false});
+        return nodes[i];
+    };
+
+    // Entries of cells whose g-value dropped later are skipped once popped
+    typedef std::pair<double, i32> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+
+    double h_scale = STEP_COST * grid.minCost();
+    auto h = [&](i32 i) { return h_scale * euclidean(cellOf(i), target); };
+
+    auto sight = [&](i32 a, i32 b) {
+        line_checks++;
+        return search::segmentCost(grid, cellOf(a), cellOf(b));
+    };
+    auto step = [&](i32 b) { return (double)search::stepCost(grid, cellOf(b)); };
+
+    static const std::pair<i32, i32> DIRS[4] = {{-1, 0}, {0, -1}, {1, 0}, {0, 1}};
+
+    i32 s = index(query.start);
+    i32 t = index(target);
+    node(s) = {0.0, s, false};
+    open.push({h(s), s});
+
+    size_t touched = 1;
+
+    while (!open.empty()) {
+        if (observer && observer->cancelled()) break;
+
+        if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+            result.timed_out = true;
+            break;
+        }
+
+        i32 i = open.top().second;
+        open.pop();
+
+        Node& expanded = node(i);
+        if (expanded.closed) continue;
+
+        auto current = cellOf(i);
+
+        // Lazy Theta* only now checks the parent it assumed to be visible,
+        // and falls back to the best expanded neighbour if it is not
+        if (lazy && expanded.parent != i) {
+            double c = sight(expanded.parent, i);
+            double via_parent = node(expanded.parent).g + c;
+            if (c < 0 || via_parent > expanded.g + 1e-9) {
+                double best = c < 0 ? INF : via_parent;
+                i32 best_parent = expanded.parent;
+
+                for (const auto& d : DIRS) {
+                    std::pair<i32, i32> n = {current.first + d.first, current.second + d.second};
+                    if (grid.isObstacle(n) || !node(index(n)).closed) continue;
+
+                    double v = node(index(n)).g + step(i);
+                    if (v < best) {
+                        best = v;
+                        best_parent = index(n);
+                    }
+                }
+
+                expanded.g = best;
+                expanded.parent = best_parent;
+            }
+        }
+
+        expanded.closed = true;
+        result.expanded++;
+
+        if (observer) observer->onClose(current);
+
+        if (i == t) {
+            result.found = true;
+            break;
+        }
+
+        i32 p = expanded.parent;
+        for (const auto& d : DIRS) {
+            std::pair<i32, i32> n = {current.first + d.first, current.second + d.second};
+            if (grid.isObstacle(n)) continue;
+
+            i32 j = index(n);
+            Node& successor = node(j);
+            if (successor.closed) continue;
+
+            if (successor.g == INF) touched++;
+
+            // Path 1 through the expanded cell, path 2 straight from its parent
+            double best = expanded.g + step(j);
+            i32 best_parent = i;
+
+            if (p != i) {
+                double c;
+                if (lazy) {
+                    // Optimistic: entering 'j' is the cheapest the segment can be
+                    c = step(j) * euclidean(cellOf(p), n);
+                } else {
+                    c = sight(p, j);
+                }
+
+                // Ties go to the straight line, no waypoint on it
+                if (c >= 0 && node(p).g + c <= best + 1e-9) {
+                    best = node(p).g + c;
+                    best_parent = p;
+                }
+            }
+
+            if (best < successor.g) {
+                successor.g = best;
+                successor.parent = best_parent;
+                open.push({best + h(j), j});
+                result.generated++;
+
+                if (observer) observer->onOpen(n, (i64)std::llround(best + h(j)));
+            }
+        }
+    }
+
+    if (result.found) {
+        result.cost = std::llround(node(t).g);
+        for (i32 i = t; ; i = node(i).parent) {
+            result.path.push_back(cellOf(i));
+            if (node(i).parent == i) break;
+        }
+        std::reverse(result.path.begin(), result.path.end());
+    }
+
+    result.peak_nodes = touched;
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
@@ -0,0 +1,61 @@
+#ifndef ANY_ANGLE_SEARCH_HPP
+#define ANY_ANGLE_SEARCH_HPP
+
+#include "Search.hpp"
+#include "Arena.hpp"
+
+// Any-angle paths are lists of waypoints joined by straight segments between
+// cell centers. A segment costs its Euclidean length times STEP_COST times
+// the highest terrain cost among the cells it enters, so a segment between
+// neighbours costs the same as a grid step.
+namespace search {
+
+    // Cost of the segment from 'a' to 'b', negative if it is blocked
+    double segmentCost(const Grid& grid, const std::pair<i32, i32>& a, const std::pair<i32, i32>& b);
+
+    // Sum of the segment costs along 'path'
+    double pathCost(const Grid& grid, const std::vector<std::pair<i32, i32>>& path);
+
+    // Post-smoothing: drops every waypoint that the previous kept waypoint
+    // can see past. Returns the number of line of sight checks made.
+    u64 smoothPath(const Grid& grid, std::vector<std::pair<i32, i32>>& path);
+
+}
+
+// Theta* (Nash, Daniel, Koenig, Felner 2007) and Lazy Theta* (Nash, Koenig,
+// Tovey 2010).
+//
+// A* on the 4-connected grid, except that a successor may take the parent of
+// the expanded cell as its own parent if it can see it. The path then only
+// holds the cells where it turns. Theta* checks line of sight for every
+// successor; Lazy Theta* assumes it and only checks once a cell is expanded,
+// which saves most of the checks. The returned path holds waypoints only.
+class ThetaStarSearch : public SearchEngine {
+
+    private:
+        struct Node {
+            double g;
+            i32 parent;     // Cell index, itself for the start
+            bool closed;
+        };
+
+        bool lazy;
+        u64 line_checks = 0;
+
+        StampedArray<Node> nodes;   // Scratch, kept between searches
+
+    public:
+        ThetaStarSearch(bool lazy = false) : lazy(lazy) {}
+
+        const char* getName() const override { return lazy ? "Lazy Theta*" : "Theta*"; }
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+        // Line of sight checks made by the last search
+        inline u64 getLineChecks() const { return line_checks; }
+
+};
+
+#endif //ANY_ANGLE_SEARCH_HPP
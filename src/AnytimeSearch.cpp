@@ -0,0 +1,162 @@
+#include <limits>
+
+#include "AnytimeSearch.hpp"
+
+SearchResult AnytimeSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    const auto& start  = query.start;
+    const auto& target = query.target;
+
+    const i64 INF = std::numeric_limits<i64>::max() / 2;
+
+    std::unordered_map<std::pair<i32, i32>, i64, pair_hash> gScore;
+    std::unordered_map<std::pair<i32, i32>, std::pair<i32, i32>, pair_hash> parents;
+
+    // Keys depend on epsilon, so the key an entry was inserted with is kept
+    // next to it to be able to erase it again
+    std::set<std::pair<double, std::pair<i32, i32>>> openSet;
+    std::unordered_map<std::pair<i32, i32>, double, pair_hash> openKey;
+    std::unordered_set<std::pair<i32, i32>, pair_hash> closedSet;
+    std::unordered_set<std::pair<i32, i32>, pair_hash> incons;
+
+    std::vector<std::pair<i32, i32>> adjacentSquares;
+
+    i64 h_scale = grid.minCost();
+    auto h = [&](const std::pair<i32, i32>& s) { return search::manhattan(s, target) * h_scale; };
+    auto g = [&](const std::pair<i32, i32>& s) {
+        auto it = gScore.find(s);
+        return it == gScore.end() ? INF : it->second;
+    };
+
+    double epsilon = std::max(initial_epsilon, 1.0);
+    auto key = [&](const std::pair<i32, i32>& s) { return g(s) + epsilon * h(s); };
+
+    auto push = [&](const std::pair<i32, i32>& s) {
+        auto it = openKey.find(s);
+        if (it != openKey.end()) {
+            openSet.erase({it->second, s});
+        }
+
+        double k = key(s);
+        openKey[s] = k;
+        openSet.insert({k, s});
+    };
+
+    SearchResult best;
+    bool stopped = false;
+
+    auto expired = [&]() {
+        if (observer && observer->cancelled()) return true;
+        if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+            best.timed_out = true;
+            return true;
+        }
+        return false;
+    };
+
+    // Expands states until the target's key is the smallest in OPEN
+    auto improvePath = [&]() {
+        while (!openSet.empty() && key(target) > openSet.begin()->first) {
+            if (expired()) {
+                stopped = true;
+                return;
+            }
+
+            auto current = openSet.begin()->second;
+            openSet.erase(openSet.begin());
+            openKey.erase(current);
+            closedSet.insert(current);
+            best.expanded++;
+
+            if (observer) observer->onClose(current);
+
+            search::adjacentSquares(grid, current, adjacentSquares);
+            for (const auto& square : adjacentSquares) {
+                i64 new_gScore = gScore[current] + search::stepCost(grid, square);
+                if (new_gScore >= g(square)) continue;
+
+                gScore[square]  = new_gScore;
+                parents[square] = current;
+                best.generated++;
+
+                if (closedSet.find(square) == closedSet.end()) {
+                    push(square);
+                    if (observer) observer->onOpen(square, (i64)openKey[square]);
+                } else {
+                    incons.insert(square);
+                }
+            }
+        }
+    };
+
+    // The optimum is at least the smallest unscaled f over OPEN and INCONS
+    auto bound = [&]() {
+        double lower = (double)g(target);
+        for (const auto& entry : openSet) {
+            lower = std::min(lower, (double)(g(entry.second) + h(entry.second)));
+        }
+        for (const auto& s : incons) {
+            lower = std::min(lower, (double)(g(s) + h(s)));
+        }
+
+        return lower > 0 ? std::min(epsilon, g(target) / lower) : 1.0;
+    };
+
+    gScore[start] = 0;
+    push(start);
+
+    while (true) {
+        improvePath();
+
+        // Only a pass that ran to the end proves a bound of its own, a path
+        // from an interrupted pass keeps the previous one
+        i64 cost = g(target);
+        if (cost < INF) {
+            double eps = !stopped ? bound()
+                : best.found ? best.epsilon : std::numeric_limits<double>::infinity();
+
+            if (!best.found || cost < best.cost || eps < best.epsilon) {
+                best.found   = true;
+                best.cost    = cost;
+                best.epsilon = eps;
+                search::retracePath(target, parents, best.path);
+                best.elapsed_ms = search::millisSince(t0);
+
+                if (observer) observer->onImprove(best);
+            }
+        }
+
+        if (stopped || !best.found || best.epsilon <= 1.0 || epsilon <= 1.0) {
+            break;
+        }
+
+        // Tighten epsilon below the proven bound and move the inconsistent
+        // states back into OPEN
+        epsilon = std::max(1.0, std::min(epsilon, best.epsilon) - epsilon_step);
+
+        for (const auto& s : incons) {
+            push(s);
+        }
+        incons.clear();
+
+        std::vector<std::pair<i32, i32>> open;
+        for (const auto& entry : openSet) {
+            open.push_back(entry.second);
+        }
+        for (const auto& s : open) {
+            push(s);
+        }
+
+        closedSet.clear();
+    }
+
+    best.elapsed_ms = search::millisSince(t0);
+    best.peak_nodes = gScore.size();
+
+    return best;
+}
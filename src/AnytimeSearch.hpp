@@ -0,0 +1,32 @@
+#ifndef ANYTIME_SEARCH_HPP
+#define ANYTIME_SEARCH_HPP
+
+#include "Search.hpp"
+
+// Anytime Repairing A* (Likhachev, Gordon, Thrun 2003).
+//
+// Starts with a heavily inflated heuristic, so the first path comes back
+// fast, then lowers epsilon step by step. Each pass reuses the g-values of
+// the previous one: only states whose g-value changed since they were last
+// expanded (open and "inconsistent" states) are searched again. Every path
+// found is reported through SearchObserver::onImprove() together with its
+// suboptimality bound. When the budget runs out the best path so far wins.
+class AnytimeSearch : public SearchEngine {
+
+    private:
+        double initial_epsilon;
+        double epsilon_step;
+
+    public:
+        AnytimeSearch(double initial_epsilon = 3.0, double epsilon_step = 0.5)
+            : initial_epsilon(initial_epsilon), epsilon_step(epsilon_step) {}
+
+        const char* getName() const override { return "ARA*"; }
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+#endif //ANYTIME_SEARCH_HPP
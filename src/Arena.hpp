@@ -0,0 +1,97 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <memory>
+
+#include "Util.hpp"
+
+// Scratch memory of the search engines. Both containers keep their storage
+// between searches and forget their contents in O(1), so back-to-back
+// queries on the same map allocate nothing once they are warmed up.
+
+// Bump allocator handing out records by index. Records live in fixed size
+// chunks, so references stay valid while the pool grows. reset() only
+// rewinds the cursor, records are not destroyed and must be trivial.
+template<class T>
+class Pool {
+
+    private:
+        static constexpr size_t CHUNK_BITS = 12;
+        static constexpr size_t CHUNK_SIZE = (size_t)1 << CHUNK_BITS;
+
+        std::vector<std::unique_ptr<T[]>> chunks;
+        size_t used = 0;
+
+    public:
+        Pool() {}
+
+        // Index of a new, uninitialized record
+        inline i32 allocate()
+        {
+            if (used == chunks.size() * CHUNK_SIZE) {
+                chunks.emplace_back(new T[CHUNK_SIZE]);
+            }
+
+            return (i32)used++;
+        }
+
+        inline void reset() { used = 0; }
+        inline size_t size() const { return used; }
+        inline size_t capacity() const { return chunks.size() * CHUNK_SIZE; }
+
+        inline T& operator[](i32 i) { return chunks[(size_t)i >> CHUNK_BITS][(size_t)i & (CHUNK_SIZE - 1)]; }
+        inline const T& operator[](i32 i) const { return chunks[(size_t)i >> CHUNK_BITS][(size_t)i & (CHUNK_SIZE - 1)]; }
+
+};
+
+// Dense array with one generation stamp per slot. A slot only holds a value
+// if its stamp matches the current generation, so clear() is a single
+// increment instead of a pass over the memory.
+template<class T>
+class StampedArray {
+
+    private:
+        std::vector<T> values;
+        std::vector<u32> stamps;
+        u32 generation = 1;
+
+    public:
+        StampedArray() {}
+
+        // Empties the array and makes room for 'size' slots, only allocates
+        // if it grows
+        void reset(size_t size)
+        {
+            if (size > values.size()) {
+                values.resize(size);
+                stamps.resize(size, 0);
+            }
+
+            // Once in 2^32 resets the stamps have to be cleared for real
+            if (++generation == 0) {
+                std::fill(stamps.begin(), stamps.end(), 0);
+                generation = 1;
+            }
+        }
+
+        inline bool has(size_t i) const { return stamps[i] == generation; }
+        inline T get(size_t i, const T& fallback) const { return has(i) ? values[i] : fallback; }
+
+        // Only valid for slots that were set in this generation
+        inline T& operator[](size_t i) { return values[i]; }
+        inline const T& operator[](size_t i) const { return values[i]; }
+
+        inline T& set(size_t i, const T& value)
+        {
+            stamps[i] = generation;
+            return values[i] = value;
+        }
+
+        // Raw storage, for kernels that test many slots at once
+        inline const T* data() const { return values.data(); }
+        inline const u32* stampData() const { return stamps.data(); }
+        inline u32 getGeneration() const { return generation; }
+
+};
+
+#endif //ARENA_HPP
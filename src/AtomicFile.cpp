@@ -0,0 +1,41 @@
+#include <atomic>
+#include <cstdio>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "AtomicFile.hpp"
+
+AtomicFile::AtomicFile(const std::string& path) : path(path)
+{
+    // Unique per process and file, so writers of the same path never share one
+    static std::atomic<u64> next{0};
+    temporary = path + ".tmp." + std::to_string(getpid()) + "." + std::to_string(next++);
+
+    file.open(temporary, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Could not open " + temporary + " for writing");
+    }
+}
+
+AtomicFile::~AtomicFile()
+{
+    if (!committed) {
+        file.close();
+        std::remove(temporary.c_str());
+    }
+}
+
+void AtomicFile::commit()
+{
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Could not write " + path);
+    }
+
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Could not replace " + path);
+    }
+
+    committed = true;
+}
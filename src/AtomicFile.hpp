@@ -0,0 +1,34 @@
+#ifndef ATOMIC_FILE_HPP
+#define ATOMIC_FILE_HPP
+
+#include <fstream>
+#include <string>
+
+#include "Util.hpp"
+
+// File that replaces 'path' in one step: it is written under a temporary
+// name next to it and renamed over it by commit(). Whoever still has the
+// old file open or mapped keeps reading it whole, and a failed write leaves
+// it untouched. Throws std::runtime_error.
+class AtomicFile {
+
+    private:
+        std::string path;
+        std::string temporary;
+        std::ofstream file;
+        bool committed = false;
+
+    public:
+        AtomicFile(const std::string& path);
+        ~AtomicFile();
+
+        AtomicFile(const AtomicFile&) = delete;
+        AtomicFile& operator=(const AtomicFile&) = delete;
+
+        inline void write(const void* data, size_t size) { file.write((const char*)data, size); }
+
+        void commit();
+
+};
+
+#endif //ATOMIC_FILE_HPP
@@ -0,0 +1,174 @@
+#include "Comparison.hpp"
+
+Comparison::~Comparison()
+{
+    cancel();
+}
+
+void Comparison::configure(const std::vector<LaneConfig>& configs)
+{
+    cancel();
+
+    size_t count = std::min(configs.size(), MAX_LANES);
+    lanes.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        if (lanes[i] && lanes[i]->config.engine == configs[i].engine
+                && lanes[i]->config.config == configs[i].config) {
+            continue;
+        }
+
+        if (!lanes[i]) lanes[i] = std::make_unique<Lane>();
+
+        lanes[i]->worker.wait();
+        lanes[i]->config = configs[i];
+        lanes[i]->engine = createEngine(configs[i].engine, configs[i].config);
+
+        std::lock_guard<std::mutex> lock(lanes[i]->mutex);
+        lanes[i]->stats = LaneStats();
+        lanes[i]->stats.name = lanes[i]->engine->getName();
+        lanes[i]->cells.clear();
+        lanes[i]->path.clear();
+    }
+}
+
+void Comparison::start(const Grid& grid, const SearchQuery& query, i32 delay_ms)
+{
+    cancel();
+
+    // Nothing reads the snapshot anymore
+    this->grid  = grid;
+    this->query = query;
+
+    for (auto& lane : lanes) {
+        {
+            std::lock_guard<std::mutex> lock(lane->mutex);
+            lane->cells.assign((size_t)grid.getWidth() * grid.getHeight(), LANE_UNSEEN);
+            lane->path.clear();
+            lane->stats = LaneStats();
+            lane->stats.name = lane->engine->getName();
+            lane->stats.running = true;
+        }
+
+        lane->width = grid.getWidth();
+        lane->delay_ms = delay_ms;
+
+        Lane* l = lane.get();
+        lane->run_token = lane->worker.submit([this, l](const CancelToken& token) {
+            l->run(this->grid, this->query, token);
+        });
+    }
+}
+
+void Comparison::cancel()
+{
+    for (auto& lane : lanes) {
+        lane->run_token.cancel();
+        lane->worker.cancelAll();
+    }
+
+    for (auto& lane : lanes) {
+        lane->worker.wait();
+
+        std::lock_guard<std::mutex> lock(lane->mutex);
+        lane->stats.running = false;
+    }
+}
+
+bool Comparison::running() const
+{
+    for (const auto& lane : lanes) {
+        std::lock_guard<std::mutex> lock(lane->mutex);
+        if (lane->stats.running) return true;
+    }
+
+    return false;
+}
+
+LaneStats Comparison::getStats(size_t lane) const
+{
+    std::lock_guard<std::mutex> lock(lanes[lane]->mutex);
+    return lanes[lane]->stats;
+}
+
+void Comparison::getCells(size_t lane, std::vector<u8>& out) const
+{
+    std::lock_guard<std::mutex> lock(lanes[lane]->mutex);
+    out = lanes[lane]->cells;
+}
+
+std::vector<std::pair<i32, i32>> Comparison::getPath(size_t lane) const
+{
+    std::lock_guard<std::mutex> lock(lanes[lane]->mutex);
+    return lanes[lane]->path;
+}
+
+void Comparison::Lane::run(const Grid& grid, const SearchQuery& query, const CancelToken& token)
+{
+    this->token = token;
+    slept_ms = 0.0;
+    t0 = search::Clock::now();
+
+    SearchResult result = engine->search(grid, query, this);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    stats.running    = false;
+    stats.found      = result.found;
+    stats.cost       = result.cost;
+    stats.expanded   = result.expanded;
+    stats.generated  = result.generated;
+    stats.elapsed_ms = search::millisSince(t0) - slept_ms;
+
+    if (result.found) {
+        path = result.path;
+        if (stats.solution_ms < 0) stats.solution_ms = stats.elapsed_ms;
+    }
+}
+
+void Comparison::Lane::onOpen(const std::pair<i32, i32>& cell, i64 f)
+{
+    (void)f;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    cells[(size_t)cell.second * width + cell.first] = LANE_OPEN;
+    stats.generated++;
+}
+
+void Comparison::Lane::onClose(const std::pair<i32, i32>& cell)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cells[(size_t)cell.second * width + cell.first] = LANE_CLOSED;
+        stats.expanded++;
+        stats.elapsed_ms = search::millisSince(t0) - slept_ms;
+    }
+
+    // Measured, so the time shown is the engine's alone
+    if (delay_ms > 0) {
+        auto before = search::Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        slept_ms += search::millisSince(before);
+    }
+}
+
+void Comparison::Lane::onDrop(const std::pair<i32, i32>& cell)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cells[(size_t)cell.second * width + cell.first] = LANE_UNSEEN;
+}
+
+void Comparison::Lane::onImprove(const SearchResult& result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    path = result.path;
+    stats.found = true;
+    stats.cost  = result.cost;
+    if (stats.solution_ms < 0) stats.solution_ms = search::millisSince(t0) - slept_ms;
+}
+
+bool Comparison::Lane::cancelled() const
+{
+    return token.cancelled();
+}
@@ -0,0 +1,104 @@
+#ifndef COMPARISON_HPP
+#define COMPARISON_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Search.hpp"
+#include "Engines.hpp"
+#include "Worker.hpp"
+
+// Per-cell state of a lane, as drawn
+enum LaneCells {
+    LANE_UNSEEN,
+    LANE_OPEN,
+    LANE_CLOSED
+};
+
+struct LaneConfig {
+    std::string engine = "astar";
+    EngineConfig config;
+};
+
+// Live figures of one lane, 'elapsed_ms' and 'solution_ms' leave out the delay
+struct LaneStats {
+    std::string name;
+    bool running = false;
+    bool found = false;
+    i64 cost = 0;
+    u64 expanded = 0;
+    u64 generated = 0;
+    double elapsed_ms = 0.0;
+    double solution_ms = -1.0;  // Until the first path, -1 before
+};
+
+// Runs up to MAX_LANES engines at once on the same grid and endpoints, each
+// on its own worker thread, so their tradeoffs can be watched side by side.
+// The lanes share one snapshot of the grid taken when the run starts.
+class Comparison {
+
+    public:
+        static constexpr size_t MAX_LANES = 4;
+
+    private:
+        class Lane : public SearchObserver {
+
+            public:
+                LaneConfig config;
+                std::unique_ptr<SearchEngine> engine;
+
+                // Written by the lane's thread, read by the renderer
+                mutable std::mutex mutex;
+                std::vector<u8> cells;
+                std::vector<std::pair<i32, i32>> path;
+                LaneStats stats;
+
+                i32 width = 0;
+                i32 delay_ms = 0;
+                double slept_ms = 0.0;
+                search::Clock::time_point t0;
+                CancelToken token;          // Of the run on the lane's thread
+                CancelToken run_token;      // Of the last run submitted
+
+                Worker worker;      // Last, joined before the rest goes
+
+                void run(const Grid& grid, const SearchQuery& query, const CancelToken& token);
+
+                void onOpen(const std::pair<i32, i32>& cell, i64 f) override;
+                void onClose(const std::pair<i32, i32>& cell) override;
+                void onDrop(const std::pair<i32, i32>& cell) override;
+                void onImprove(const SearchResult& result) override;
+                bool cancelled() const override;
+
+        };
+
+        Grid grid;
+        SearchQuery query;
+
+        std::vector<std::unique_ptr<Lane>> lanes;
+
+    public:
+        Comparison() {}
+        ~Comparison();
+
+        // Cancels a running comparison, keeps the engines whose config did not change
+        void configure(const std::vector<LaneConfig>& configs);
+
+        // Starts every lane on a copy of 'grid', slowed down by 'delay_ms' per expansion
+        void start(const Grid& grid, const SearchQuery& query, i32 delay_ms);
+        void cancel();
+
+        bool running() const;
+        inline size_t size() const { return lanes.size(); }
+        inline const Grid& getGrid() const { return grid; }
+
+        LaneStats getStats(size_t lane) const;
+        void getCells(size_t lane, std::vector<u8>& out) const;
+        std::vector<std::pair<i32, i32>> getPath(size_t lane) const;
+
+};
+
+#endif //COMPARISON_HPP
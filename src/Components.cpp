@@ -0,0 +1,197 @@
+#include "Components.hpp"
+
+// Below this many cells a single thread is faster than spawning workers
+static constexpr i32 PARALLEL_MIN_CELLS = 1 << 16;
+
+i32 Components::find(i32 i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
+
+void Components::unite(i32 a, i32 b)
+{
+    a = find(a);
+    b = find(b);
+
+    if (a == b) return;
+
+    // Lower index wins, which keeps every root inside the band that created it
+    if (a < b) parent[b] = a;
+    else parent[a] = b;
+}
+
+void Components::buildBand(const Grid& grid, i32 y0, i32 y1)
+{
+    // Only touches cells of rows [y0, y1), so bands can run concurrently
+    for (i32 y = y0; y < y1; y++) {
+        for (i32 x = 0; x < width; x++) {
+            i32 i = y * width + x;
+
+            if (grid.isObstacle({x, y})) {
+                parent[i] = -1;
+                continue;
+            }
+
+            parent[i] = i;
+            if (x > 0 && parent[i - 1] >= 0) unite(i - 1, i);
+            if (y > y0 && parent[i - width] >= 0) unite(i - width, i);
+        }
+    }
+}
+
+void Components::flattenBand(i32 y0, i32 y1)
+{
+    // Reads 'parent' only, writes the own rows of 'scratch'
+    for (i32 i = y0 * width; i < y1 * width; i++) {
+        i32 root = parent[i];
+        if (root >= 0) {
+            while (parent[root] != root) root = parent[root];
+        }
+
+        scratch[i] = root;
+    }
+}
+
+void Components::build(const Grid& grid)
+{
+    width  = grid.getWidth();
+    height = grid.getHeight();
+
+    parent.resize((size_t)width * height);
+    scratch.resize(parent.size());
+
+    i32 threads = 1;
+    if (width * height >= PARALLEL_MIN_CELLS) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, height);
+    }
+
+    std::vector<i32> bands = {0};
+    for (i32 t = 1; t <= threads; t++) {
+        bands.push_back(height * t / threads);
+    }
+
+    auto parallel = [&](auto&& work) {
+        std::vector<std::thread> workers;
+        for (i32 t = 1; t < threads; t++) {
+            workers.emplace_back(work, bands[t], bands[t + 1]);
+        }
+        work(bands[0], bands[1]);
+
+        for (auto& w : workers) w.join();
+    };
+
+    parallel([&](i32 y0, i32 y1) { buildBand(grid, y0, y1); });
+
+    // Stitch neighbouring bands together along their shared border
+    for (i32 t = 1; t < threads; t++) {
+        i32 y = bands[t];
+        for (i32 x = 0; x < width; x++) {
+            i32 i = y * width + x;
+            if (parent[i] >= 0 && parent[i - width] >= 0) {
+                unite(i - width, i);
+            }
+        }
+    }
+
+    parallel([&](i32 y0, i32 y1) { flattenBand(y0, y1); });
+    parent.swap(scratch);
+
+    dirty = false;
+}
+
+bool Components::maySplit(const Grid& grid, const std::pair<i32, i32>& cell) const
+{
+    // Walk the eight cells around 'cell' in order. Consecutive ring cells
+    // touch each other, so if all free side neighbours lie in one run of free
+    // ring cells they stay connected through that run.
+    static const std::pair<i32, i32> ring[8] = {
+        {0, -1}, {1, -1}, {1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}
+    };
+
+    bool free[8];
+    for (i32 k = 0; k < 8; k++) {
+        free[k] = !grid.isObstacle({cell.first + ring[k].first, cell.second + ring[k].second});
+    }
+
+    // Start counting at a blocked ring cell, if there is none nothing can split
+    i32 k0 = 0;
+    while (k0 < 8 && free[k0]) k0++;
+    if (k0 == 8) return false;
+
+    i32 runs_with_side = 0;
+    bool in_run = false, run_has_side = false;
+    for (i32 n = 1; n <= 8; n++) {
+        i32 k = (k0 + n) % 8;
+
+        if (free[k]) {
+            in_run = true;
+            run_has_side |= k % 2 == 0;
+        } else if (in_run) {
+            runs_with_side += run_has_side;
+            in_run = run_has_side = false;
+        }
+    }
+
+    return runs_with_side > 1;
+}
+
+void Components::onObstacleAdded(const Grid& grid, const std::pair<i32, i32>& cell)
+{
+    if (dirty || !grid.inBounds(cell)) return;
+
+    if (maySplit(grid, cell)) {
+        dirty = true;
+        return;
+    }
+
+    // The cell may still be the root of its component, so it keeps its
+    // parent entry; queries check the grid for obstacles first
+}
+
+void Components::onObstacleRemoved(const Grid& grid, const std::pair<i32, i32>& cell)
+{
+    if (dirty || !grid.inBounds(cell)) return;
+
+    i32 i = index(cell);
+    if (parent[i] < 0) {
+        parent[i] = i;
+    }
+
+    static const std::pair<i32, i32> sides[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+    for (const auto& d : sides) {
+        std::pair<i32, i32> n = {cell.first + d.first, cell.second + d.second};
+        if (!grid.isObstacle(n)) {
+            unite(index(n), i);
+        }
+    }
+}
+
+bool Components::sameComponent(const std::pair<i32, i32>& a, const std::pair<i32, i32>& b) const
+{
+    i32 i = index(a), j = index(b);
+    if (parent[i] < 0 || parent[j] < 0) return false;
+
+    while (parent[i] != i) i = parent[i];
+    while (parent[j] != j) j = parent[j];
+
+    return i == j;
+}
+
+bool Components::connected(const Grid& grid, const std::pair<i32, i32>& a, const std::pair<i32, i32>& b)
+{
+    if (grid.isObstacle(a) || grid.isObstacle(b)) {
+        return false;
+    }
+
+    if (dirty || grid.getWidth() != width || grid.getHeight() != height) {
+        build(grid);
+    }
+
+    return find(index(a)) == find(index(b));
+}
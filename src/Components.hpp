@@ -0,0 +1,53 @@
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include "Util.hpp"
+#include "Grid.hpp"
+
+// Connected components of the free cells of a Grid (4-connectivity), kept in
+// a union-find forest over cell indices. The forest is built in parallel,
+// with one band of rows per thread. After that, freed cells are merged in
+// incrementally. A new obstacle only forces a rebuild if it could have cut a
+// component in two.
+class Components {
+
+    private:
+        i32 width  = 0;
+        i32 height = 0;
+
+        std::vector<i32> parent;    // -1 for obstacles
+        std::vector<i32> scratch;
+        bool dirty = true;
+
+        inline i32 index(const std::pair<i32, i32>& cell) const
+            { return cell.second * width + cell.first; }
+
+        i32 find(i32 i);
+        void unite(i32 a, i32 b);
+
+        void buildBand(const Grid& grid, i32 y0, i32 y1);
+        void flattenBand(i32 y0, i32 y1);
+        bool maySplit(const Grid& grid, const std::pair<i32, i32>& cell) const;
+
+    public:
+        Components() {}
+
+        void build(const Grid& grid);
+
+        // Must be called after the cell changed in 'grid'
+        void onObstacleAdded(const Grid& grid, const std::pair<i32, i32>& cell);
+        void onObstacleRemoved(const Grid& grid, const std::pair<i32, i32>& cell);
+        inline void invalidate() { dirty = true; }
+
+        // Rebuilds first if an edit invalidated the forest
+        bool connected(const Grid& grid, const std::pair<i32, i32>& a, const std::pair<i32, i32>& b);
+
+        // Same on a forest built for 'grid' and not invalidated since. Paths
+        // are not compressed, so threads can ask at once.
+        bool sameComponent(const std::pair<i32, i32>& a, const std::pair<i32, i32>& b) const;
+
+        inline bool isDirty() const { return dirty; }
+
+};
+
+#endif //COMPONENTS_HPP
@@ -0,0 +1,451 @@
+#include <stdexcept>
+#include <unordered_set>
+
+#include "Cooperative.hpp"
+
+void ReservationTable::rehash(size_t capacity)
+{
+    std::vector<u64> old_keys = std::move(keys);
+    std::vector<u32> old_owners = std::move(owners);
+
+    keys.assign(capacity, EMPTY);
+    owners.assign(capacity, 0);
+    mask  = capacity - 1;
+    count = 0;
+
+    for (size_t i = 0; i < old_keys.size(); i++) {
+        if (old_keys[i] != EMPTY) {
+            reserve((u32)old_keys[i], (u32)(old_keys[i] >> 32), old_owners[i]);
+        }
+    }
+}
+
+void ReservationTable::clear()
+{
+    if (count > 0) std::fill(keys.begin(), keys.end(), EMPTY);
+    count = 0;
+}
+
+void ReservationTable::reserve(u32 cell, u32 time, u32 agent)
+{
+    if (2 * (count + 1) > keys.size()) rehash(2 * keys.size());
+
+    u64 k = key(cell, time);
+    size_t i = slot(k) & mask;
+    while (keys[i] != EMPTY && keys[i] != k) i = (i + 1) & mask;
+
+    if (keys[i] == EMPTY) count++;
+    keys[i] = k;
+    owners[i] = agent;
+}
+
+void ReservationTable::release(u32 cell, u32 time)
+{
+    u64 k = key(cell, time);
+    size_t i = slot(k) & mask;
+    while (keys[i] != k) {
+        if (keys[i] == EMPTY) return;
+        i = (i + 1) & mask;
+    }
+
+    // Moves every later key of the run whose home slot is not between the
+    // hole and itself into the hole
+    for (size_t j = (i + 1) & mask; keys[j] != EMPTY; j = (j + 1) & mask) {
+        size_t home = slot(keys[j]) & mask;
+        bool stays = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (stays) continue;
+
+        keys[i] = keys[j];
+        owners[i] = owners[j];
+        i = j;
+    }
+
+    keys[i] = EMPTY;
+    count--;
+}
+
+i32 ReservationTable::owner(u32 cell, u32 time) const
+{
+    u64 k = key(cell, time);
+    for (size_t i = slot(k) & mask; keys[i] != EMPTY; i = (i + 1) & mask) {
+        if (keys[i] == k) return (i32)owners[i];
+    }
+    return -1;
+}
+
+void TrueDistance::reset(const Grid& grid, const std::pair<i32, i32>& target, const std::pair<i32, i32>& start)
+{
+    this->grid   = &grid;
+    this->target = target;
+    this->start  = start;
+
+    entries.clear();
+    openHeap = {{search::manhattan(target, start) / STEP_COST, target}};
+    entries[target] = {0, false};
+}
+
+i32 TrueDistance::get(const std::pair<i32, i32>& cell)
+{
+    auto it = entries.find(cell);
+    if (it != entries.end() && it->second.closed) return it->second.g;
+
+    // Min-heap
+    auto later = std::greater<std::pair<i32, std::pair<i32, i32>>>();
+
+    // Resumes until 'cell' is closed, the manhattan estimate towards the
+    // start is consistent so every closed cell has its exact distance
+    while (!openHeap.empty()) {
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [f, current] = openHeap.back();
+        openHeap.pop_back();
+
+        Entry& entry = entries[current];
+        if (entry.closed || entry.g + search::manhattan(current, start) / STEP_COST != f) continue;
+        entry.closed = true;
+
+        i32 g = entry.g;
+        search::adjacentSquares(*grid, current, adjacentSquares);
+        for (const auto& square : adjacentSquares) {
+            auto [next, fresh] = entries.insert({square, {g + 1, false}});
+            if (!fresh) {
+                if (next->second.closed || g + 1 >= next->second.g) continue;
+                next->second.g = g + 1;
+            }
+
+            openHeap.push_back({g + 1 + (i32)(search::manhattan(square, start) / STEP_COST), square});
+            std::push_heap(openHeap.begin(), openHeap.end(), later);
+        }
+
+        if (current == cell) return g;
+    }
+
+    return UNREACHABLE;
+}
+
+bool CooperativePlanner::blocked(u32 agent, i32 from, i32 to, u32 time) const
+{
+    i32 holder = table.owner(to, time + 1);
+    if (holder >= 0 && (u32)holder != agent) return true;
+
+    if (!rest_from.empty() && rest_from[to] <= time + 1 && rest_agent[to] != agent) return true;
+
+    // Swapping cells with the agent that is in 'to' now
+    if (from != to) {
+        i32 other = table.owner(to, time);
+        if (other >= 0 && (u32)other != agent && table.owner(from, time + 1) == other) return true;
+    }
+
+    return false;
+}
+
+bool CooperativePlanner::searchAgent(
+        u32 agent,
+        const AgentTask& task,
+        i32 from,
+        u32 time,
+        std::vector<i32>& path,
+        u64& expanded)
+{
+    TrueDistance& distance = distances[agent];
+    i32 target = index(task.target);
+    bool windowed = window > 0;
+    u32 horizon = windowed ? time + window : limit;
+
+    i32 h0 = distance.get(cell(from));
+    if (!windowed && h0 == TrueDistance::UNREACHABLE) return false;
+
+    // A search that fails in full planning is given up after this many nodes
+    u64 cap = windowed ? UINT64_MAX : std::max<u64>(1 << 16, 64 * (u64)(h0 + 1));
+
+    nodes.clear();
+    node_at.clear();
+    openHeap.clear();
+
+    // Min-heap
+    auto later = std::greater<std::tuple<i32, i64, i32>>();
+
+    auto push = [&](i32 c, u32 t, i32 g, i32 parent) {
+        i32 f = g + distance.get(cell(c));
+        u64 k = (u64)t << 32 | (u32)c;
+
+        auto [it, fresh] = node_at.insert({k, (i32)nodes.size()});
+        if (fresh) {
+            nodes.push_back({c, t, g, f, parent, false});
+        } else {
+            Node& node = nodes[it->second];
+            if (node.closed || g >= node.g) return;
+            node.g = g;
+            node.f = f;
+            node.parent = parent;
+        }
+
+        openHeap.push_back({f, -(i64)t, it->second});
+        std::push_heap(openHeap.begin(), openHeap.end(), later);
+    };
+
+    push(from, time, 0, -1);
+
+    i32 goal = -1, deepest = 0;
+    u64 count = 0;
+
+    while (!openHeap.empty() && count < cap) {
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [f, minus_t, n] = openHeap.back();
+        openHeap.pop_back();
+
+        Node node = nodes[n];
+        if (node.closed || node.f != f) continue;
+        nodes[n].closed = true;
+        count++;
+
+        if (node.time > nodes[deepest].time || (node.time == nodes[deepest].time && node.f < nodes[deepest].f)) {
+            deepest = n;
+        }
+
+        if (windowed) {
+            if (node.time >= horizon) {
+                goal = n;
+                break;
+            }
+        } else if (node.cell == target
+                && (last_use[target] == NONE || last_use[target] <= node.time)
+                && (rest_from[target] == NONE || rest_agent[target] == agent)) {
+            goal = n;
+            break;
+        }
+
+        if (node.time >= horizon) continue;
+
+        // Waiting, free on the target within a window
+        if (!blocked(agent, node.cell, node.cell, node.time)) {
+            i32 step = windowed && node.cell == target ? 0 : 1;
+            push(node.cell, node.time + 1, node.g + step, n);
+        }
+
+        search::adjacentSquares(*grid, cell(node.cell), adjacentSquares);
+        for (const auto& square : adjacentSquares) {
+            i32 next = index(square);
+            if (!blocked(agent, node.cell, next, node.time)) {
+                push(next, node.time + 1, node.g + 1, n);
+            }
+        }
+    }
+
+    expanded += count;
+
+    if (goal < 0) {
+        if (!windowed || nodes[deepest].time == time) return false;
+        goal = deepest;
+    }
+
+    path.clear();
+    for (i32 n = goal; n >= 0; n = nodes[n].parent) path.push_back(nodes[n].cell);
+    std::reverse(path.begin(), path.end());
+
+    return true;
+}
+
+void CooperativePlanner::planWindowed(
+        const std::vector<AgentTask>& tasks,
+        AgentPlan& plan,
+        search::Clock::time_point t0,
+        double budget_ms)
+{
+    u32 n = (u32)tasks.size();
+
+    std::vector<i32> positions(n);
+    for (u32 a = 0; a < n; a++) positions[a] = index(tasks[a].start);
+
+    std::vector<std::vector<i32>> steps(n);
+    u32 execute = std::max<u32>(window / 2, 1);
+
+    for (u32 time = 0; time < limit; ) {
+        bool done = true;
+        for (u32 a = 0; a < n && done; a++) done = positions[a] == index(tasks[a].target);
+        if (done) break;
+
+        if (budget_ms > 0 && search::millisSince(t0) > budget_ms) {
+            plan.timed_out = true;
+            break;
+        }
+
+        // Everyone holds their cell for the next step, so nobody planned
+        // earlier can run into an agent that has not moved yet
+        table.clear();
+        for (u32 a = 0; a < n; a++) {
+            table.reserve(positions[a], time, a);
+            table.reserve(positions[a], time + 1, a);
+        }
+
+        u32 ahead = window;
+        for (u32 k = 0; k < n; k++) {
+            u32 a = (k + plan.replans) % n;
+
+            if (!searchAgent(a, tasks[a], positions[a], time, steps[a], plan.expanded)) {
+                steps[a] = {positions[a], positions[a]};
+            }
+
+            if (steps[a][1] != positions[a]) table.release(positions[a], time + 1);
+            for (u32 t = 0; t < steps[a].size(); t++) table.reserve(steps[a][t], time + t, a);
+
+            ahead = std::min(ahead, (u32)steps[a].size() - 1);
+        }
+
+        // Only the steps every agent has planned are safe to take
+        u32 taken = std::min({execute, ahead, limit - time});
+        for (u32 a = 0; a < n; a++) {
+            for (u32 t = 1; t <= taken; t++) plan.paths[a].push_back(cell(steps[a][t]));
+            positions[a] = steps[a][taken];
+        }
+
+        time += taken;
+        plan.replans++;
+    }
+}
+
+void CooperativePlanner::planFull(
+        const std::vector<AgentTask>& tasks,
+        AgentPlan& plan,
+        search::Clock::time_point t0,
+        double budget_ms)
+{
+    u32 n = (u32)tasks.size();
+    size_t cells = (size_t)width * grid->getHeight();
+
+    table.clear();
+    last_use.assign(cells, NONE);
+    rest_from.assign(cells, NONE);
+    rest_agent.assign(cells, NONE);
+
+    // Agents wait on their starts until they are planned
+    for (u32 a = 0; a < n; a++) {
+        i32 s = index(tasks[a].start);
+        rest_from[s] = 0;
+        rest_agent[s] = a;
+    }
+
+    std::vector<i32> steps;
+    for (u32 a = 0; a < n; a++) {
+        i32 s = index(tasks[a].start);
+        rest_from[s] = NONE;
+
+        bool found = !plan.timed_out && searchAgent(a, tasks[a], s, 0, steps, plan.expanded);
+        if (budget_ms > 0 && search::millisSince(t0) > budget_ms) plan.timed_out = true;
+
+        if (!found) {
+            rest_from[s] = 0;
+            rest_agent[s] = a;
+            continue;
+        }
+
+        for (u32 t = 0; t < steps.size(); t++) {
+            table.reserve(steps[t], t, a);
+            if (last_use[steps[t]] == NONE || last_use[steps[t]] < t) last_use[steps[t]] = t;
+        }
+
+        i32 end = steps.back();
+        rest_from[end] = (u32)steps.size() - 1;
+        rest_agent[end] = a;
+
+        for (u32 t = 1; t < steps.size(); t++) plan.paths[a].push_back(cell(steps[t]));
+    }
+
+    rest_from.clear();
+}
+
+AgentPlan CooperativePlanner::plan(const Grid& grid, const std::vector<AgentTask>& tasks, double budget_ms)
+{
+    auto t0 = search::Clock::now();
+
+    this->grid = &grid;
+    width = grid.getWidth();
+    limit = max_steps > 0 ? max_steps : 4 * (grid.getWidth() + grid.getHeight());
+
+    std::unordered_set<std::pair<i32, i32>, pair_hash> starts, targets;
+    for (const auto& task : tasks) {
+        if (!grid.inBounds(task.start) || !grid.inBounds(task.target)
+                || grid.isObstacle(task.start) || grid.isObstacle(task.target)) {
+            throw std::runtime_error("Agents must start and end on free cells of the grid!");
+        }
+        if (!starts.insert(task.start).second || !targets.insert(task.target).second) {
+            throw std::runtime_error("Agents must start and end on distinct cells!");
+        }
+    }
+
+    AgentPlan plan;
+    u32 n = (u32)tasks.size();
+
+    distances.resize(n);
+    for (u32 a = 0; a < n; a++) {
+        distances[a].reset(grid, tasks[a].target, tasks[a].start);
+        plan.paths.push_back({tasks[a].start});
+    }
+
+    if (window > 0) {
+        planWindowed(tasks, plan, t0, budget_ms);
+    } else {
+        planFull(tasks, plan, t0, budget_ms);
+    }
+
+    // Every agent waits on its last cell until the last one is done
+    for (const auto& path : plan.paths) plan.makespan = std::max(plan.makespan, (u32)path.size() - 1);
+    for (auto& path : plan.paths) path.resize(plan.makespan + 1, path.back());
+
+    // Windowed plans end on a replan, after everyone may have stood still
+    auto still = [&](u32 t) {
+        for (const auto& path : plan.paths) if (path[t] != path[t - 1]) return false;
+        return true;
+    };
+    while (plan.makespan > 0 && still(plan.makespan)) plan.makespan--;
+    for (auto& path : plan.paths) path.resize(plan.makespan + 1);
+
+    plan.arrival.assign(n, UINT32_MAX);
+    for (u32 a = 0; a < n; a++) {
+        const auto& path = plan.paths[a];
+        if (path.back() != tasks[a].target) continue;
+
+        u32 t = plan.makespan;
+        while (t > 0 && path[t - 1] == tasks[a].target) t--;
+
+        plan.arrival[a] = t;
+        plan.arrived++;
+        plan.sum_of_costs += t;
+    }
+
+    plan.elapsed_ms = search::millisSince(t0);
+
+    return plan;
+}
+
+u64 countConflicts(const std::vector<std::vector<std::pair<i32, i32>>>& paths)
+{
+    size_t length = 0;
+    for (const auto& path : paths) length = std::max(length, path.size());
+
+    auto at = [&](size_t a, size_t t) { return paths[a][std::min(t, paths[a].size() - 1)]; };
+
+    u64 conflicts = 0;
+    std::unordered_map<std::pair<i32, i32>, size_t, pair_hash> occupied;
+    for (size_t t = 0; t < length; t++) {
+        occupied.clear();
+        for (size_t a = 0; a < paths.size(); a++) {
+            if (paths[a].empty()) continue;
+
+            if (!occupied.insert({at(a, t), a}).second) conflicts++;
+        }
+
+        // Swaps: the agent now in the cell 'a' left was in the cell 'a' entered
+        if (t == 0) continue;
+        for (size_t a = 0; a < paths.size(); a++) {
+            if (paths[a].empty() || at(a, t) == at(a, t - 1)) continue;
+
+            auto it = occupied.find(at(a, t - 1));
+            if (it == occupied.end() || it->second == a) continue;
+
+            size_t b = it->second;
+            if (at(b, t - 1) == at(a, t) && a < b) conflicts++;
+        }
+    }
+
+    return conflicts;
+}
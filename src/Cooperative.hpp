@@ -0,0 +1,198 @@
+#ifndef COOPERATIVE_HPP
+#define COOPERATIVE_HPP
+
+#include <tuple>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Search.hpp"
+
+struct AgentTask {
+    std::pair<i32, i32> start;
+    std::pair<i32, i32> target;
+};
+
+// Timed paths of a group of agents, every step is a move to a 4-neighbour or
+// a wait and takes one timestep; terrain costs do not apply
+struct AgentPlan {
+    // Cell of every agent at timesteps 0 to 'makespan'
+    std::vector<std::vector<std::pair<i32, i32>>> paths;
+
+    // Timestep from which an agent stays on its target, UINT32_MAX if it
+    // is not on it at the end
+    std::vector<u32> arrival;
+
+    u32 makespan = 0;
+    u32 arrived = 0;
+    u64 sum_of_costs = 0;   // Arrival times of the agents that arrived
+    u64 expanded = 0;       // Space-time nodes, over all agents and replans
+    u32 replans = 0;
+    bool timed_out = false;
+    double elapsed_ms = 0.0;
+};
+
+// Which agent holds a cell at a timestep. Open addressing with linear
+// probing over one array of packed (time, cell) keys and one of owners, 12
+// bytes per slot at a load of at most one half; releases shift the rest of
+// the probe run back instead of leaving tombstones.
+class ReservationTable {
+
+    private:
+        static constexpr u64 EMPTY = ~0ULL;
+
+        std::vector<u64> keys;
+        std::vector<u32> owners;
+        size_t count = 0;
+        size_t mask  = 0;
+
+        static inline u64 key(u32 cell, u32 time) { return (u64)time << 32 | cell; }
+        static inline size_t slot(u64 key)
+        {
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdULL;
+            key ^= key >> 33;
+            return (size_t)key;
+        }
+
+        void rehash(size_t capacity);
+
+    public:
+        ReservationTable() { rehash(1024); }
+
+        // Forgets every reservation, keeps the memory
+        void clear();
+
+        // Takes over the slot if another agent held it
+        void reserve(u32 cell, u32 time, u32 agent);
+        void release(u32 cell, u32 time);
+
+        // -1 if free
+        i32 owner(u32 cell, u32 time) const;
+
+        inline size_t size() const { return count; }
+        inline size_t bytes() const { return keys.size() * (sizeof(u64) + sizeof(u32)); }
+
+};
+
+// Exact distance in steps from any cell to 'target', ignoring the other
+// agents. A backward A* from the target towards the agent's start, resumed
+// whenever a cell it has not closed yet is asked for (Reverse Resumable A*).
+class TrueDistance {
+
+    public:
+        static constexpr i32 UNREACHABLE = INT32_MAX / 4;
+
+    private:
+        const Grid* grid = nullptr;
+        std::pair<i32, i32> target;
+        std::pair<i32, i32> start;
+
+        struct Entry {
+            i32 g;
+            bool closed;
+        };
+
+        std::unordered_map<std::pair<i32, i32>, Entry, pair_hash> entries;
+        std::vector<std::pair<i32, std::pair<i32, i32>>> openHeap;
+
+        std::vector<std::pair<i32, i32>> adjacentSquares;
+
+    public:
+        TrueDistance() {}
+
+        void reset(const Grid& grid, const std::pair<i32, i32>& target, const std::pair<i32, i32>& start);
+
+        // UNREACHABLE if the cell is walled off from the target
+        i32 get(const std::pair<i32, i32>& cell);
+
+};
+
+// Plans agents one after another against a shared space-time reservation
+// table, so no two of them ever meet in a cell or swap places.
+//
+// With a window of W steps (Windowed Hierarchical Cooperative A*) every
+// agent plans W steps ahead, guided by its true distance to the target
+// beyond them, and all agents replan every W / 2 steps with the order of
+// priority rotated. Each agent first holds on to its cell for the next step,
+// so it can always wait; only the steps every agent has planned are
+// executed.
+//
+// With a window of 0 (Cooperative A*) every agent plans all the way to its
+// target once, and then stays there for good. Agents not planned yet wait on
+// their starts, an agent that finds no path keeps waiting there.
+class CooperativePlanner {
+
+    private:
+        u32 window;
+        u32 max_steps;
+        u32 limit = 0;      // 'max_steps' or its default for the grid being planned
+
+        const Grid* grid = nullptr;
+        i32 width = 0;
+
+        ReservationTable table;
+
+        // Cooperative A* only: last reserved timestep of each cell, and the
+        // agent staying on it from 'rest_from' on
+        static constexpr u32 NONE = UINT32_MAX;
+        std::vector<u32> last_use;
+        std::vector<u32> rest_from;
+        std::vector<u32> rest_agent;
+
+        std::vector<TrueDistance> distances;
+
+        struct Node {
+            i32 cell;
+            u32 time;
+            i32 g;
+            i32 f;
+            i32 parent;
+            bool closed;
+        };
+
+        // Scratch of the space-time search, nodes are keyed by (time, cell)
+        // and the heap orders them by f, later timesteps first on ties
+        std::vector<Node> nodes;
+        std::unordered_map<u64, i32> node_at;
+        std::vector<std::tuple<i32, i64, i32>> openHeap;
+        std::vector<std::pair<i32, i32>> adjacentSquares;
+
+        // Whether 'agent' may step from 'from' into 'to' between 'time' and 'time' + 1
+        bool blocked(u32 agent, i32 from, i32 to, u32 time) const;
+
+        // Space-time A* for 'agent' from 'from' at 'time'. Windowed, it stops
+        // at 'time' + 'window' or keeps the deepest plan it found; otherwise it
+        // stops once the agent can stay on its target. 'path' holds one cell
+        // per timestep from 'time' on. Returns false if nothing was found.
+        bool searchAgent(
+                u32 agent,
+                const AgentTask& task,
+                i32 from,
+                u32 time,
+                std::vector<i32>& path,
+                u64& expanded);
+
+        void planWindowed(const std::vector<AgentTask>& tasks, AgentPlan& plan, search::Clock::time_point t0, double budget_ms);
+        void planFull(const std::vector<AgentTask>& tasks, AgentPlan& plan, search::Clock::time_point t0, double budget_ms);
+
+        inline i32 index(const std::pair<i32, i32>& cell) const { return cell.second * width + cell.first; }
+        inline std::pair<i32, i32> cell(i32 i) const { return {i % width, i / width}; }
+
+    public:
+        // 'max_steps' bounds the timesteps of a plan, 0 picks four times the
+        // grid's width plus height
+        CooperativePlanner(u32 window = 16, u32 max_steps = 0) : window(window), max_steps(max_steps) {}
+
+        // Throws std::runtime_error unless starts and targets are distinct
+        // free cells of the grid
+        AgentPlan plan(const Grid& grid, const std::vector<AgentTask>& tasks, double budget_ms = 0.0);
+
+        inline size_t reservationBytes() const { return table.bytes(); }
+
+};
+
+// Timesteps at which two of the paths share a cell or two agents swap
+// cells; shorter paths are taken to wait on their last cell
+u64 countConflicts(const std::vector<std::vector<std::pair<i32, i32>>>& paths);
+
+#endif //COOPERATIVE_HPP
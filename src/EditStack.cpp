@@ -1,76 +1,252 @@
+#include <cassert>
+
 #include "EditStack.hpp"
 
-void EditStack::WriteStack(const std::vector<std::pair<i32, i32>> data, short op)
+static const std::pair<i32, i32> STEPS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+static inline u32 zigzag(i32 v) { return ((u32)v << 1) ^ (u32)(v >> 31); }
+static inline i32 unzigzag(u32 v) { return (i32)(v >> 1) ^ -(i32)(v & 1); }
+
+void EditStack::putVarint(u32 value)
+{
+    while (value >= 0x80) {
+        log.push_back((u8)(value | 0x80));
+        value >>= 7;
+    }
+    log.push_back((u8)value);
+}
+
+u32 EditStack::getVarint(const u8*& p) const
 {
-    std::stack<std::vector<std::pair<i32, i32>>> rev_data;
-    std::stack<short> rev_op;
+    u32 value = 0;
+    for (u32 shift = 0; ; shift += 7) {
+        u8 byte = *p++;
+        value |= (u32)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+
+    return value;
+}
+
+void EditStack::flushRun()
+{
+    u32 dir = 0;
+    if (run_length > 1) {
+        while (STEPS[dir] != run_step) dir++;
+    }
+
+    putVarint(zigzag(run_start.first  - prev_cell.first));
+    putVarint(zigzag(run_start.second - prev_cell.second));
+    putVarint(run_length << 2 | dir);
+
+    prev_cell = {
+        run_start.first  + STEPS[dir].first  * (i32)(run_length - 1),
+        run_start.second + STEPS[dir].second * (i32)(run_length - 1)
+    };
 
-    while (!redo_data.empty()) {
-        undo_data.push(redo_data.top());
-        undo_op.push(redo_op.top());
+    entries.back().count += run_length;
+    run_length = 0;
+}
 
-        rev_data.push(redo_data.top());
-        rev_op.push(redo_op.top());
+void EditStack::decode(const Entry& entry)
+{
+    scratch.clear();
+    scratch.reserve(entry.count);
+
+    const u8* p   = log.data() + (entry.offset - log_shift);
+    const u8* end = p + entry.length;
+
+    std::pair<i32, i32> prev = {0, 0};
+    while (p < end) {
+        i32 dx = unzigzag(getVarint(p));
+        i32 dy = unzigzag(getVarint(p));
+        u32 len_dir = getVarint(p);
+
+        auto step = STEPS[len_dir & 3];
+        std::pair<i32, i32> cell = {prev.first + dx, prev.second + dy};
+        for (u32 i = 0; i < len_dir >> 2; i++) {
+            scratch.push_back(cell);
+            prev = cell;
+            cell.first  += step.first;
+            cell.second += step.second;
+        }
+    }
+}
 
-        redo_data.pop();
-        redo_op.pop();
+void EditStack::truncateRedo()
+{
+    // The committed stroke was recorded after the redo entries, its cells
+    // are encoded relative to each other and move down in one piece
+    if (cursor + 1 < entries.size()) {
+        Entry stroke = entries.back();
+        size_t redo = entries[cursor].offset - log_shift;
+        log.erase(log.begin() + redo, log.begin() + (stroke.offset - log_shift));
+
+        stroke.offset = entries[cursor].offset;
+        entries.resize(cursor);
+        entries.push_back(stroke);
     }
+}
 
-    while (!rev_data.empty()) {
-        auto d = rev_data.top();
-        auto o = rev_op.top();
+void EditStack::evict()
+{
+    // Always keep the most recent entry, even if it alone exceeds the limit
+    while (getMemoryUsage() > memory_limit && cursor - first > 1) {
+        first++;
+    }
 
-        switch (o) {
-            case MOVE_START:
-            case MOVE_TARGET:
-                {
-                    auto helper = d[0];
-                    d[0] = d[1];
-                    d[1] = helper;
-                }
-                break;
+    // Compact once at least half of a buffer is dead, so eviction stays
+    // amortized O(1) per entry
+    size_t dead_bytes = first < entries.size()
+        ? entries[first].offset - log_shift
+        : log.size();
+    if (dead_bytes > 0 && dead_bytes >= log.size() / 2) {
+        log.erase(log.begin(), log.begin() + dead_bytes);
+        log_shift += dead_bytes;
+    }
 
-            case INSERT_OBST:
-                o = DELETE_OBST;
-                break;
+    if (first > 0 && first >= entries.size() / 2) {
+        entries.erase(entries.begin(), entries.begin() + first);
+        cursor -= first;
+        first = 0;
+    }
+}
 
-            case DELETE_OBST:
-                o = INSERT_OBST;
-                break;
+size_t EditStack::getMemoryUsage() const
+{
+    size_t dead_bytes = first < entries.size()
+        ? entries[first].offset - log_shift
+        : log.size();
+
+    return log.size() - dead_bytes + (entries.size() - first) * sizeof(Entry);
+}
 
+void EditStack::Begin(short op, bool coalesce)
+{
+    // Strokes do not nest, an open one must be committed first
+    assert(!recording);
+
+    auto now = std::chrono::steady_clock::now();
+
+    bool paint = op == INSERT_OBST || op == DELETE_OBST;
+    if (paint
+            && coalesce
+            && coalescable
+            && cursor == entries.size()
+            && entries.back().op == op
+            && now - last_commit < coalesce_window) {
+        // Reopen the previous stroke; its data is still at the end of the log
+        cursor--;
+    } else {
+        // The redo entries stay until the stroke turns out to change a cell
+        entries.push_back({log.size() + log_shift, 0, 0, op});
+        prev_cell = {0, 0};
+    }
+
+    recording = true;
+    coalescable = false;
+    stroke_coalesces = paint && coalesce;
+    run_length = 0;
+}
+
+void EditStack::Append(const std::pair<i32, i32>& cell)
+{
+    if (run_length == 1) {
+        std::pair<i32, i32> step = {cell.first - run_start.first, cell.second - run_start.second};
+        if (abs(step.first) + abs(step.second) == 1) {
+            run_step = step;
+            run_length++;
+            return;
         }
+    } else if (run_length > 1) {
+        std::pair<i32, i32> next = {
+            run_start.first  + run_step.first  * (i32)run_length,
+            run_start.second + run_step.second * (i32)run_length
+        };
+        if (cell == next) {
+            run_length++;
+            return;
+        }
+    }
 
-        undo_data.push(d);
-        undo_op.push(o);
+    if (run_length > 0) {
+        flushRun();
+    }
+
+    run_start = cell;
+    run_length = 1;
+}
 
-        rev_data.pop();
-        rev_op.pop();
+void EditStack::Commit()
+{
+    if (!recording) {
+        return;
     }
 
-    undo_data.push(data);
-    undo_op.push(op);
+    if (run_length > 0) {
+        flushRun();
+    }
+
+    recording = false;
+
+    Entry& entry = entries.back();
+    entry.length = (u32)(log.size() + log_shift - entry.offset);
+
+    if (entry.count == 0) {
+        entries.pop_back();
+        return;
+    }
+
+    truncateRedo();
+    cursor = entries.size();
+    last_commit = std::chrono::steady_clock::now();
+    coalescable = stroke_coalesces;
+
+    evict();
+}
+
+void EditStack::WriteStack(const std::vector<std::pair<i32, i32>>& data, short op)
+{
+    Begin(op, false);
+    for (const auto& cell : data) {
+        Append(cell);
+    }
+    Commit();
 }
 
-std::vector<std::pair<i32, i32>> EditStack::Undo(short* op)
+const std::vector<std::pair<i32, i32>>& EditStack::Undo(short* op)
 {
-    auto data = undo_data.top();    undo_data.pop();
-    *op       = undo_op.top();      undo_op.pop();
+    assert(!recording);
+
+    const Entry& entry = entries[--cursor];
 
-    redo_data.push(data);
-    redo_op.push(*op);
+    decode(entry);
+    *op = entry.op;
+    coalescable = false;
 
-    return data;
+    return scratch;
 }
 
-std::vector<std::pair<i32, i32>> EditStack::Redo(short* op)
+const std::vector<std::pair<i32, i32>>& EditStack::Redo(short* op)
 {
-    auto data = redo_data.top();    redo_data.pop();
-    *op       = redo_op.top();      redo_op.pop();
+    assert(!recording);
 
-    undo_data.push(data);
-    undo_op.push(*op);
+    const Entry& entry = entries[cursor++];
 
-    return data;
+    decode(entry);
+    *op = entry.op;
+    coalescable = false;
+
+    return scratch;
 }
 
+void EditStack::setMemoryLimit(size_t bytes)
+{
+    memory_limit = bytes;
+    evict();
+}
 
+void EditStack::setCoalesceWindow(i32 ms)
+{
+    coalesce_window = std::chrono::milliseconds(ms);
+}
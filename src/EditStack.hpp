@@ -1,6 +1,8 @@
 #ifndef EDIT_STACK_HPP
 #define EDIT_STACK_HPP
 
+#include <chrono>
+
 #include "Util.hpp"
 
 enum EditOperations {
@@ -8,27 +10,87 @@ enum EditOperations {
     MOVE_TARGET,
     INSERT_OBST,
     DELETE_OBST,
+    INVERT_REGION,
+    TOGGLE_TARGET,
 };
 
+// Linear undo/redo history stored as one contiguous operation log.
+//
+// Every entry owns a slice of 'log' in which its cells are encoded as runs:
+// the first cell of a run is stored as a zig-zag varint delta to the last
+// cell of the previous run, followed by a varint holding the run length and
+// its step direction. Strokes along a row or column therefore cost a few
+// bytes no matter how long they are.
 class EditStack {
-    
+
     private:
-        // Stacks
-        std::stack<std::vector<std::pair<i32, i32>>> undo_data;
-        std::stack<std::vector<std::pair<i32, i32>>> redo_data;
-        std::stack<short> undo_op;
-        std::stack<short> redo_op;
+        static constexpr size_t DEFAULT_MEMORY_LIMIT = 1 << 20;
+        static constexpr i32 DEFAULT_COALESCE_MS = 250;
+
+        struct Entry {
+            size_t offset;  // Absolute offset of the encoded cells
+            u32 length;     // Encoded size in bytes
+            u32 count;      // Number of cells
+            short op;
+        };
+
+        // Operation log
+        std::vector<u8> log;
+        std::vector<Entry> entries;
+
+        size_t log_shift = 0;   // Bytes dropped from the front of 'log'
+        size_t first = 0;       // Oldest entry that was not evicted
+        size_t cursor = 0;      // [first, cursor) undo, [cursor, size) redo
+
+        size_t memory_limit = DEFAULT_MEMORY_LIMIT;
+        std::chrono::milliseconds coalesce_window{DEFAULT_COALESCE_MS};
+        std::chrono::steady_clock::time_point last_commit;
+        bool coalescable = false;
+        bool stroke_coalesces = false;
+
+        // Stroke that is currently being recorded
+        bool recording = false;
+        std::pair<i32, i32> prev_cell;  // Last cell of the last flushed run
+        std::pair<i32, i32> run_start;
+        std::pair<i32, i32> run_step;
+        u32 run_length = 0;
+
+        std::vector<std::pair<i32, i32>> scratch;
+
+        // Encoding
+        void putVarint(u32 value);
+        u32 getVarint(const u8*& p) const;
+        void flushRun();
+        void decode(const Entry& entry);
+
+        void truncateRedo();
+        void evict();
 
     public:
         EditStack() {}
         ~EditStack() {}
 
-        void WriteStack(const std::vector<std::pair<i32, i32>> data, short op);
-        std::vector<std::pair<i32, i32>> Undo(short* op);
-        std::vector<std::pair<i32, i32>> Redo(short* op);
+        // Streaming interface: Begin() opens an entry, Append() adds cells to
+        // it while the user drags and Commit() closes it. Unless 'coalesce' is
+        // false, a stroke that starts shortly after a stroke of the same kind
+        // is merged into it.
+        void Begin(short op, bool coalesce = true);
+        void Append(const std::pair<i32, i32>& cell);
+        void Commit();
+
+        // None of these may be called while a stroke is being recorded
+        void WriteStack(const std::vector<std::pair<i32, i32>>& data, short op);
+        const std::vector<std::pair<i32, i32>>& Undo(short* op);
+        const std::vector<std::pair<i32, i32>>& Redo(short* op);
+
+        void setMemoryLimit(size_t bytes);
+        void setCoalesceWindow(i32 ms);
 
-        inline size_t getUndoSize() const { return undo_op.size(); }
-        inline size_t getRedoSize() const { return redo_op.size(); }
+        inline size_t getUndoSize() const { return cursor - first; }
+        inline size_t getRedoSize() const { return entries.size() - cursor; }
+        inline size_t getMemoryLimit() const { return memory_limit; }
+        size_t getMemoryUsage() const;
+        inline bool isRecording() const { return recording; }
 
 };
 
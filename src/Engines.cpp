@@ -0,0 +1,60 @@
+#include <stdexcept>
+
+#include "Engines.hpp"
+#include "AnytimeSearch.hpp"
+#include "MemoryBoundedSearch.hpp"
+#include "AnyAngleSearch.hpp"
+#include "PaddedSearch.hpp"
+#include "SubgoalGraph.hpp"
+#include "PathDatabase.hpp"
+
+const std::vector<EngineInfo>& engineList()
+{
+    static const std::vector<EngineInfo> engines = {
+        {"astar", "A*"},
+        {"dijkstra", "Dijkstra"},
+        {"greedy", "Greedy Best-First"},
+        {"ara",   "ARA* (anytime)"},
+        {"ida",   "IDA* (memory-bounded)"},
+        {"sma",   "SMA* (memory-bounded)"},
+        {"theta", "Theta* (any-angle)"},
+        {"lazytheta", "Lazy Theta* (any-angle)"},
+        {"padded", "A* (padded grid)"},
+        {"padded8", "A* (padded, 8-connected)"},
+        {"subgoal", "Subgoal graph (preprocessed)"},
+        {"cpd",   "Path database (preprocessed)"},
+    };
+
+    return engines;
+}
+
+std::unique_ptr<SearchEngine> createEngine(const std::string& name, const EngineConfig& config)
+{
+    if (name == "astar") {
+        return std::make_unique<AStarSearch>(config.weight, PRIORITY_ASTAR, config.layout);
+    } else if (name == "dijkstra") {
+        return std::make_unique<AStarSearch>(1.0, PRIORITY_DIJKSTRA, config.layout);
+    } else if (name == "greedy") {
+        return std::make_unique<AStarSearch>(1.0, PRIORITY_GREEDY, config.layout);
+    } else if (name == "ara") {
+        return std::make_unique<AnytimeSearch>(config.epsilon, config.epsilon_step);
+    } else if (name == "ida") {
+        return std::make_unique<IDAStarSearch>(config.table_size);
+    } else if (name == "sma") {
+        return std::make_unique<SMAStarSearch>(config.node_cap);
+    } else if (name == "theta") {
+        return std::make_unique<ThetaStarSearch>(false);
+    } else if (name == "lazytheta") {
+        return std::make_unique<ThetaStarSearch>(true);
+    } else if (name == "padded") {
+        return std::make_unique<PaddedSearch>(CONNECT_4, config.weight);
+    } else if (name == "padded8") {
+        return std::make_unique<PaddedSearch>(CONNECT_8, config.weight);
+    } else if (name == "subgoal") {
+        return std::make_unique<SubgoalSearch>(config.data_path.empty() ? "" : config.data_path + ".ssg");
+    } else if (name == "cpd") {
+        return std::make_unique<PathDatabaseSearch>(config.data_path.empty() ? "" : config.data_path + ".cpd");
+    }
+
+    throw std::runtime_error("Unknown search engine '" + name + "'!");
+}
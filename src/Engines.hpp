@@ -0,0 +1,39 @@
+#ifndef ENGINES_HPP
+#define ENGINES_HPP
+
+#include <memory>
+#include <string>
+
+#include "Search.hpp"
+
+// Tunables of all engines, each engine reads the ones it knows
+struct EngineConfig {
+    double weight = 1.0;            // Weighted A*
+    double epsilon = 3.0;           // ARA*, initial heuristic inflation
+    double epsilon_step = 0.5;      // ARA*, decrease per pass
+    size_t node_cap = 1 << 16;      // SMA*, most nodes kept in memory
+    size_t table_size = 1 << 16;    // IDA*, transposition table entries
+    short layout = LAYOUT_ROWS;     // A*, Dijkstra and greedy, order of the per-cell state
+    std::string data_path;          // Subgoal graph and path database, kept in this plus .ssg or .cpd, empty for none
+
+    inline bool operator==(const EngineConfig& other) const
+    {
+        return weight == other.weight && epsilon == other.epsilon && epsilon_step == other.epsilon_step
+            && node_cap == other.node_cap && table_size == other.table_size && layout == other.layout
+            && data_path == other.data_path;
+    }
+    inline bool operator!=(const EngineConfig& other) const { return !(*this == other); }
+};
+
+struct EngineInfo {
+    const char* name;   // Accepted by createEngine()
+    const char* label;  // Shown in menus and reports
+};
+
+// All engines, in menu order
+const std::vector<EngineInfo>& engineList();
+
+// Throws std::runtime_error for unknown names
+std::unique_ptr<SearchEngine> createEngine(const std::string& name, const EngineConfig& config = {});
+
+#endif //ENGINES_HPP
@@ -0,0 +1,299 @@
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "FlowField.hpp"
+#include "Search.hpp"
+
+// Below this many cells a single thread is faster than spawning workers
+static constexpr i32 PARALLEL_MIN_CELLS = 1 << 16;
+
+// Left, up, right, down: the order ties are broken in
+const std::pair<i32, i32> FlowField::DIRECTIONS[4] = {{-1, 0}, {0, -1}, {1, 0}, {0, 1}};
+
+void FlowField::build(const Grid& grid, const std::pair<i32, i32>& target)
+{
+    width  = grid.getWidth();
+    height = grid.getHeight();
+    pitch  = width + 2;
+
+    this->target = target;
+
+    field.assign((size_t)pitch * (height + 2), UNREACHED);
+    through.assign(field.size(), UNREACHED);
+    flow.assign((size_t)width * height, NO_FLOW);
+    buckets.resize(LEVELS);
+
+    seeds.clear();
+    if (!grid.isObstacle(target)) {
+        seeds.push_back({0, index(target)});
+    }
+
+    propagate(grid);
+    derive(0, height);
+}
+
+void FlowField::update(const Grid& grid, const std::vector<std::pair<i32, i32>>& changed)
+{
+    if (grid.getWidth() != width || grid.getHeight() != height) {
+        build(grid, target);
+        return;
+    }
+
+    if (changed.empty()) {
+        return;
+    }
+
+    // Reset every cell whose path ran through an edited cell. A neighbour
+    // depends on a cell if its arrow points at it: the left neighbour if it
+    // points right, the upper one if it points down and so on.
+    static const i32 TOWARDS[4] = {2, 3, 0, 1};
+    const i32 offsets[4] = {-1, -pitch, 1, pitch};
+
+    pending.clear();
+    for (const auto& cell : changed) {
+        if (!grid.inBounds(cell)) continue;
+
+        u32 i = index(cell);
+        field[i] = through[i] = UNREACHED;
+        pending.push_back(i);
+    }
+
+    std::vector<u32> reset;
+    while (!pending.empty()) {
+        u32 i = pending.back();
+        pending.pop_back();
+        reset.push_back(i);
+
+        auto [x, y] = cellOf(i);
+        for (i32 d = 0; d < 4; d++) {
+            auto n = std::make_pair(x + DIRECTIONS[d].first, y + DIRECTIONS[d].second);
+            u32 j = i + offsets[d];
+            if (field[j] == UNREACHED || flow[n.second * width + n.first] != TOWARDS[d]) continue;
+
+            field[j] = through[j] = UNREACHED;
+            pending.push_back(j);
+        }
+    }
+
+    // Restart the wavefront from the border of the reset region
+    seeds.clear();
+    for (u32 i : reset) {
+        auto cell = cellOf(i);
+        if (grid.isObstacle(cell)) continue;
+
+        if (cell == target) {
+            seeds.push_back({0, i});
+            continue;
+        }
+
+        u32 best = UNREACHED;
+        for (i32 d = 0; d < 4; d++) {
+            best = std::min(best, through[i + offsets[d]]);
+        }
+
+        if (best != UNREACHED) {
+            seeds.push_back({best, i});
+        }
+    }
+
+    touched_min = height;
+    touched_max = -1;
+    for (u32 i : reset) {
+        touched_min = std::min(touched_min, cellOf(i).second);
+        touched_max = std::max(touched_max, cellOf(i).second);
+    }
+
+    propagate(grid);
+
+    // Arrows next to a changed cell may have to turn as well
+    if (touched_max >= touched_min) {
+        derive(std::max(touched_min - 1, 0), std::min(touched_max + 2, height));
+    }
+}
+
+void FlowField::propagate(const Grid& grid)
+{
+    // Dial's algorithm: terrain costs are 1 to 255, so every cell queued
+    // while expanding 'level' lands in one of the next 255 buckets of the ring
+    std::sort(seeds.begin(), seeds.end());
+
+    size_t next_seed = 0;
+    size_t queued = 0;
+    u32 level = 0;
+
+    const i32 offsets[4] = {-1, -pitch, 1, pitch};
+
+    while (queued > 0 || next_seed < seeds.size()) {
+        if (queued == 0) {
+            level = std::max(level, seeds[next_seed].first);
+        }
+
+        auto& bucket = buckets[level % LEVELS];
+
+        while (next_seed < seeds.size() && seeds[next_seed].first == level) {
+            u32 i = seeds[next_seed++].second;
+            if (level < field[i]) {
+                field[i] = level;
+                bucket.push_back(i);
+                queued++;
+            }
+        }
+
+        for (size_t k = 0; k < bucket.size(); k++) {
+            u32 i = bucket[k];
+            queued--;
+
+            // Superseded by a cheaper entry
+            if (field[i] != level) continue;
+
+            auto cell = cellOf(i);
+            touched_min = std::min(touched_min, cell.second);
+            touched_max = std::max(touched_max, cell.second);
+
+            // Paths this long would overflow, treat them as unreachable
+            u32 cost = grid.getCost(cell);
+            if (level > UNREACHED - 2 * LEVELS) continue;
+
+            u32 entering = level + cost;
+            through[i] = entering;
+
+            for (i32 d = 0; d < 4; d++) {
+                u32 j = i + offsets[d];
+                if (entering >= field[j]) continue;
+                if (grid.isObstacle({cell.first + DIRECTIONS[d].first, cell.second + DIRECTIONS[d].second})) continue;
+
+                field[j] = entering;
+                buckets[entering % LEVELS].push_back(j);
+                queued++;
+            }
+        }
+
+        bucket.clear();
+        level++;
+    }
+}
+
+#ifdef __SSE2__
+// Lanes of 'mask' from 'a', the others from 'b'
+static inline __m128i select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+void FlowField::deriveBand(i32 y0, i32 y1)
+{
+    for (i32 y = y0; y < y1; y++) {
+        const u32* row  = &through[index({0, y})];
+        const u32* up   = row - pitch;
+        const u32* down = row + pitch;
+        const u32* own  = &field[index({0, y})];
+        u8* out = &flow[(size_t)y * width];
+
+        i32 x = 0;
+
+#ifdef __SSE2__
+        // SSE2 only compares signed lanes, flipping the sign bit maps the
+        // unsigned order onto the signed one
+        const __m128i bias      = _mm_set1_epi32((i32)0x80000000);
+        const __m128i unreached = _mm_set1_epi32((i32)UNREACHED);
+        const __m128i none      = _mm_set1_epi32(NO_FLOW);
+
+        for (; x + 4 <= width; x += 4) {
+            __m128i best = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(row + x - 1)), bias);
+            __m128i dir  = _mm_setzero_si128();
+
+            const u32* candidates[3] = {up + x, row + x + 1, down + x};
+            for (i32 d = 1; d < 4; d++) {
+                __m128i v  = _mm_xor_si128(_mm_loadu_si128((const __m128i*)candidates[d - 1]), bias);
+                __m128i lt = _mm_cmplt_epi32(v, best);
+                best = select(lt, v, best);
+                dir  = select(lt, _mm_set1_epi32(d), dir);
+            }
+
+            __m128i stuck = _mm_or_si128(
+                    _mm_cmpeq_epi32(_mm_xor_si128(best, bias), unreached),
+                    _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(own + x)), unreached));
+            dir = select(stuck, none, dir);
+
+            __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(dir, dir), dir);
+            i32 packed = _mm_cvtsi128_si32(bytes);
+            memcpy(out + x, &packed, 4);
+        }
+#endif
+
+        for (; x < width; x++) {
+            const u32 candidates[4] = {row[x - 1], up[x], row[x + 1], down[x]};
+
+            u32 best = candidates[0];
+            u8 dir = 0;
+            for (u8 d = 1; d < 4; d++) {
+                if (candidates[d] < best) {
+                    best = candidates[d];
+                    dir  = d;
+                }
+            }
+
+            out[x] = best == UNREACHED || own[x] == UNREACHED ? NO_FLOW : dir;
+        }
+    }
+
+    if (target.second >= y0 && target.second < y1) {
+        flow[target.second * width + target.first] = NO_FLOW;
+    }
+}
+
+void FlowField::derive(i32 y0, i32 y1)
+{
+    i32 threads = 1;
+    if ((y1 - y0) * width >= PARALLEL_MIN_CELLS) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, y1 - y0);
+    }
+
+    // Bands only write their own rows of 'flow'
+    std::vector<std::thread> workers;
+    for (i32 t = 1; t < threads; t++) {
+        workers.emplace_back([this, y0, y1, t, threads] {
+            deriveBand(y0 + (y1 - y0) * t / threads, y0 + (y1 - y0) * (t + 1) / threads);
+        });
+    }
+    deriveBand(y0, y0 + (y1 - y0) / threads);
+
+    for (auto& w : workers) w.join();
+}
+
+bool FlowField::pathFrom(const std::pair<i32, i32>& from, std::vector<std::pair<i32, i32>>& path) const
+{
+    path.clear();
+
+    if (from.first < 0 || from.second < 0 || from.first >= width || from.second >= height
+            || field[index(from)] == UNREACHED) {
+        return false;
+    }
+
+    // Every step lowers the field value, so this ends at the target
+    auto cell = from;
+    path.push_back(cell);
+    while (cell != target) {
+        u8 dir = getFlow(cell);
+        if (dir == NO_FLOW) {
+            return false;
+        }
+
+        cell.first  += DIRECTIONS[dir].first;
+        cell.second += DIRECTIONS[dir].second;
+        path.push_back(cell);
+    }
+
+    return true;
+}
+
+i64 FlowField::getDistance(const std::pair<i32, i32>& cell) const
+{
+    u32 value = field[index(cell)];
+    return value == UNREACHED ? -1 : (i64)STEP_COST * value;
+}
@@ -0,0 +1,87 @@
+#ifndef FLOW_FIELD_HPP
+#define FLOW_FIELD_HPP
+
+#include "Util.hpp"
+#include "Grid.hpp"
+
+// Flow field (Dijkstra map) towards a single target.
+//
+// The integration field holds the cost of the cheapest path from every cell
+// to the target, in terrain cost units. A wavefront spreads it out from the
+// target over a bucket queue, one bucket per cost level, so it is exact for
+// any terrain costs. Each cell then points to the neighbour its cheapest
+// path continues with. That pass is independent per cell, it runs in bands
+// of rows on all cores and handles four cells per SSE2 step. Any number of
+// agents heading for the target just follow the arrows, O(path length) each.
+//
+// After edits only the cells whose paths ran through an edited cell are
+// reset, the wavefront is restarted from their border and the directions
+// are derived again for the rows it reached.
+class FlowField {
+
+    public:
+        static constexpr u32 UNREACHED = 0xffffffff;
+        static constexpr u8 NO_FLOW = 4;    // Target, obstacles and unreachable cells
+
+    private:
+        // Largest terrain cost, the wavefront never looks further ahead
+        static constexpr u32 LEVELS = 256;
+
+        i32 width  = 0;
+        i32 height = 0;
+        i32 pitch  = 0;     // Row length of the padded arrays
+
+        std::pair<i32, i32> target = {-1, -1};
+
+        // Padded by a border of UNREACHED cells, so every grid cell has four
+        // valid neighbours. 'through' is the cost of a path entering a cell,
+        // its field value plus its own terrain cost.
+        std::vector<u32> field;
+        std::vector<u32> through;
+
+        std::vector<u8> flow;   // Row-major without border, one direction per cell
+
+        std::vector<std::vector<u32>> buckets;
+        std::vector<std::pair<u32, u32>> seeds;     // Cost level, padded index
+        std::vector<u32> pending;
+
+        // Rows reached by the last wavefront
+        i32 touched_min = 0;
+        i32 touched_max = -1;
+
+        inline u32 index(const std::pair<i32, i32>& cell) const
+            { return (u32)(cell.second + 1) * pitch + cell.first + 1; }
+        inline std::pair<i32, i32> cellOf(u32 i) const
+            { return {(i32)(i % pitch) - 1, (i32)(i / pitch) - 1}; }
+
+        void propagate(const Grid& grid);
+        void deriveBand(i32 y0, i32 y1);
+        void derive(i32 y0, i32 y1);
+
+    public:
+        FlowField() {}
+
+        void build(const Grid& grid, const std::pair<i32, i32>& target);
+
+        // Must be called after the obstacles or costs of 'changed' were edited
+        // in 'grid'. Falls back to build() if the grid was resized.
+        void update(const Grid& grid, const std::vector<std::pair<i32, i32>>& changed);
+
+        // Follows the arrows from 'from', the path ends at the target.
+        // Returns false if the target cannot be reached.
+        bool pathFrom(const std::pair<i32, i32>& from, std::vector<std::pair<i32, i32>>& path) const;
+
+        // Cost to the target in the units of SearchResult::cost, -1 if unreachable
+        i64 getDistance(const std::pair<i32, i32>& cell) const;
+
+        inline u32 getField(const std::pair<i32, i32>& cell) const { return field[index(cell)]; }
+        inline u8 getFlow(const std::pair<i32, i32>& cell) const { return flow[cell.second * width + cell.first]; }
+        inline std::pair<i32, i32> getTarget() const { return target; }
+        inline bool isBuilt() const { return width > 0; }
+
+        // Direction codes returned by getFlow()
+        static const std::pair<i32, i32> DIRECTIONS[4];
+
+};
+
+#endif //FLOW_FIELD_HPP
@@ -0,0 +1,325 @@
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+#include "Grid.hpp"
+
+u64 Grid::nextId()
+{
+    static std::atomic<u64> next{1};
+    return next++;
+}
+
+Grid::Grid(i32 width, i32 height)
+{
+    resize(width, height);
+}
+
+Grid::Grid(i32 width, i32 height, u64* buffer)
+{
+    this->width  = width;
+    this->height = height;
+    stride  = (width + 63) / 64;
+    bits    = buffer;
+    wrapped = true;
+
+    for (i32 y = 0; y < height; y++) {
+        row(y)[stride - 1] &= validMask(stride - 1);
+    }
+
+    cost_stride = (width + COST_ALIGN - 1) / COST_ALIGN * COST_ALIGN;
+    costs.assign((size_t)cost_stride * height, 255);
+    for (i32 y = 0; y < height; y++) {
+        std::fill_n(costs.data() + (size_t)y * cost_stride, width, 1);
+    }
+}
+
+Grid::Grid(const Grid& other)
+{
+    *this = other;
+}
+
+Grid::Grid(Grid&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+Grid& Grid::operator=(const Grid& other)
+{
+    if (this == &other) return *this;
+
+    width  = other.width;
+    height = other.height;
+    stride = other.stride;
+    cost_stride = other.cost_stride;
+    costs = other.costs;
+
+    storage.assign(other.bits, other.bits + (size_t)other.stride * other.height);
+    bits = storage.data();
+    wrapped = false;
+
+    id = nextId();
+    edits = 0;
+
+    return *this;
+}
+
+Grid& Grid::operator=(Grid&& other) noexcept
+{
+    if (this == &other) return *this;
+
+    width  = other.width;
+    height = other.height;
+    stride = other.stride;
+    cost_stride = other.cost_stride;
+    costs = std::move(other.costs);
+
+    // Moving the vector keeps its buffer where it is
+    storage = std::move(other.storage);
+    bits = other.bits;
+    wrapped = other.wrapped;
+
+    other.width = other.height = other.stride = other.cost_stride = 0;
+    other.bits = nullptr;
+    other.wrapped = false;
+
+    // The contents move along with their identity
+    id = other.id;
+    edits = other.edits;
+    other.id = nextId();
+    other.edits = 0;
+
+    return *this;
+}
+
+void Grid::resize(i32 width, i32 height)
+{
+    if (width == this->width && height == this->height) {
+        return;
+    }
+
+    i32 stride = (width + 63) / 64;
+    std::vector<u64> bits((size_t)stride * height, 0);
+
+    i32 keep_words = std::min(stride, this->stride);
+    for (i32 y = 0; y < std::min(height, this->height); y++) {
+        for (i32 i = 0; i < keep_words; i++) {
+            bits[(size_t)y * stride + i] = this->bits[(size_t)y * this->stride + i];
+        }
+
+        // Drop cells that fell off the right edge
+        if (width < this->width) {
+            bits[(size_t)y * stride + stride - 1] &= width % 64 ? (1ULL << (width % 64)) - 1 : ~0ULL;
+        }
+    }
+
+    i32 cost_stride = (width + COST_ALIGN - 1) / COST_ALIGN * COST_ALIGN;
+    std::vector<u8> costs((size_t)cost_stride * height, 255);
+    for (i32 y = 0; y < height; y++) {
+        u8* r = costs.data() + (size_t)y * cost_stride;
+        std::fill(r, r + width, 1);
+
+        if (y < this->height) {
+            i32 keep = std::min(width, this->width);
+            std::copy_n(this->costs.data() + (size_t)y * this->cost_stride, keep, r);
+        }
+    }
+
+    this->width  = width;
+    this->height = height;
+    this->stride = stride;
+    this->storage = std::move(bits);
+    this->bits    = this->storage.data();
+    this->wrapped = false;
+
+    this->cost_stride = cost_stride;
+    this->costs       = std::move(costs);
+
+    edits++;
+}
+
+void Grid::clear()
+{
+    edits++;
+    std::fill(bits, bits + (size_t)stride * height, 0);
+}
+
+void Grid::setRow(i32 y, const u64* words)
+{
+    edits++;
+    u64* r = row(y);
+    for (i32 i = 0; i < stride; i++) {
+        r[i] = words[i] & validMask(i);
+    }
+}
+
+size_t Grid::count() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < (size_t)stride * height; i++) {
+        n += __builtin_popcountll(bits[i]);
+    }
+
+    return n;
+}
+
+void Grid::clampRect(std::pair<i32, i32>& a, std::pair<i32, i32>& b) const
+{
+    a.first  = std::max(a.first,  0);
+    a.second = std::max(a.second, 0);
+    b.first  = std::min(b.first,  width  - 1);
+    b.second = std::min(b.second, height - 1);
+}
+
+void Grid::paintCost(const std::pair<i32, i32>& center, i32 radius, u8 cost)
+{
+    cost = std::max<u8>(cost, 1);
+    edits++;
+
+    for (i32 dy = -radius; dy <= radius; dy++) {
+        i32 y = center.second + dy;
+        if (y < 0 || y >= height) continue;
+
+        i32 half = (i32)std::sqrt((double)(radius * radius - dy * dy));
+        i32 x0 = std::max(center.first - half, 0);
+        i32 x1 = std::min(center.first + half, width - 1);
+        if (x0 > x1) continue;
+
+        u8* r = costs.data() + (size_t)y * cost_stride;
+        std::fill(r + x0, r + x1 + 1, cost);
+    }
+}
+
+void Grid::clearCosts()
+{
+    edits++;
+    for (i32 y = 0; y < height; y++) {
+        u8* r = costs.data() + (size_t)y * cost_stride;
+        std::fill(r, r + width, 1);
+    }
+}
+
+u8 Grid::minCost() const
+{
+    // Padding holds 255, so the whole buffer can be scanned in one go
+    u8 m = 255;
+    for (u8 c : costs) {
+        m = std::min(m, c);
+    }
+
+    return m;
+}
+
+u8 Grid::maxCost() const
+{
+    u8 m = 1;
+    for (i32 y = 0; y < height; y++) {
+        const u8* r = getCostRow(y);
+        for (i32 x = 0; x < width; x++) {
+            m = std::max(m, r[x]);
+        }
+    }
+
+    return m;
+}
+
+u64 Grid::fingerprint() const
+{
+    // Four independent lanes, so the multiplies overlap
+    u64 lanes[4] = {
+        0x9e3779b97f4a7c15ULL ^ (u64)width,
+        0xbf58476d1ce4e5b9ULL ^ (u64)height,
+        0x94d049bb133111ebULL,
+        0x2545f4914f6cdd1dULL
+    };
+    auto mix = [](u64 h, u64 w) {
+        h = (h ^ w) * 0xff51afd7ed558ccdULL;
+        return h ^ (h >> 29);
+    };
+
+    for (i32 y = 0; y < height; y++) {
+        const u64* row = getRow(y);
+        i32 k = 0;
+        for (; k + 4 <= stride; k += 4) {
+            for (i32 l = 0; l < 4; l++) lanes[l] = mix(lanes[l], row[k + l]);
+        }
+        for (; k < stride; k++) lanes[0] = mix(lanes[0], row[k]);
+
+        const u8* costs = getCostRow(y);
+        i32 x = 0;
+        for (; x + 32 <= width; x += 32) {
+            for (i32 l = 0; l < 4; l++) {
+                u64 w;
+                memcpy(&w, costs + x + 8 * l, 8);
+                lanes[l] = mix(lanes[l], w);
+            }
+        }
+        for (; x < width; x++) lanes[1] = mix(lanes[1], costs[x]);
+    }
+
+    return mix(mix(mix(lanes[0], lanes[1]), lanes[2]), lanes[3]);
+}
+
+u8 Grid::lineOfSight(const std::pair<i32, i32>& a, const std::pair<i32, i32>& b) const
+{
+    // Both ends lie inside the grid, so does every cell in between and the
+    // bitmap can be read without bounds checks
+    auto blocked = [&](i32 x, i32 y) {
+        return bits[(size_t)y * stride + (x >> 6)] >> (x & 63) & 1;
+    };
+
+    // Rows are the common case for open maps, test them a word at a time
+    if (a.second == b.second) {
+        i32 x0 = std::min(a.first, b.first);
+        i32 x1 = std::max(a.first, b.first);
+
+        const u64* r = getRow(a.second);
+        for (i32 i = x0 >> 6; i <= x1 >> 6; i++) {
+            if (r[i] & spanMask(i, x0, x1)) return 0;
+        }
+
+        const u8* c = getCostRow(a.second);
+        u8 m = 1;
+        for (i32 x = x0; x <= x1; x++) {
+            if (x != a.first) m = std::max(m, c[x]);
+        }
+
+        return m;
+    }
+
+    i32 nx = abs(b.first  - a.first);
+    i32 ny = abs(b.second - a.second);
+    i32 sx = b.first  > a.first  ? 1 : -1;
+    i32 sy = b.second > a.second ? 1 : -1;
+
+    i32 x = a.first;
+    i32 y = a.second;
+    u8 m = 1;
+
+    // Same stepping as walkLine(), but a step through a corner moves
+    // diagonally and needs both cells beside the corner to be free
+    for (i32 ix = 0, iy = 0; ix < nx || iy < ny; ) {
+        i64 decision = (i64)(1 + 2 * ix) * ny - (i64)(1 + 2 * iy) * nx;
+
+        if (decision == 0) {
+            if (blocked(x + sx, y) || blocked(x, y + sy)) return 0;
+            m = std::max({m, getCost({x + sx, y}), getCost({x, y + sy})});
+
+            x += sx;
+            y += sy;
+            ix++;
+            iy++;
+        } else if (decision < 0) {
+            x += sx;
+            ix++;
+        } else {
+            y += sy;
+            iy++;
+        }
+
+        if (blocked(x, y)) return 0;
+        m = std::max(m, getCost({x, y}));
+    }
+
+    return m;
+}
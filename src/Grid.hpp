@@ -0,0 +1,351 @@
+#ifndef GRID_HPP
+#define GRID_HPP
+
+#include "Util.hpp"
+
+// Obstacle bitmap. Every row starts on a fresh 64 bit word, bit 'x % 64' of
+// word 'x / 64' is set if the cell is blocked. Region operations work on
+// whole words and report every cell they change to a visitor, in row-major
+// order, so callers can record them without taking a snapshot first.
+//
+// The bitmap is either owned by the grid or a buffer of the caller that the
+// grid works on in place, see the wrapping constructor.
+//
+// Next to the bitmap lives the traversal cost layer: one byte per cell, rows
+// padded to 32 bytes so scans over it vectorize. Entering a cell costs its
+// value (1 to 255) times the base step cost.
+class Grid {
+
+    private:
+        static constexpr i32 COST_ALIGN = 32;
+
+        i32 width  = 0;
+        i32 height = 0;
+        i32 stride = 0;         // Words per row
+        i32 cost_stride = 0;    // Bytes per row
+
+        std::vector<u64> storage;
+        u64* bits = nullptr;    // 'storage' or the caller's buffer
+        bool wrapped = false;
+
+        std::vector<u8> costs;  // Padding bytes hold 255
+
+        // Contents identity, see getId()
+        u64 id = nextId();
+        u64 edits = 0;
+
+        static u64 nextId();
+
+        inline u64* row(i32 y) { return bits + (size_t)y * stride; }
+
+        // Bits of word 'i' that lie inside the grid
+        inline u64 validMask(i32 i) const
+        {
+            i32 rem = width - i * 64;
+            return rem >= 64 ? ~0ULL : (1ULL << rem) - 1;
+        }
+
+        // Bits of word 'i' that lie inside the column range [x0, x1]
+        static inline u64 spanMask(i32 i, i32 x0, i32 x1)
+        {
+            i32 lo = std::max(x0 - i * 64, 0);
+            i32 hi = std::min(x1 - i * 64, 63);
+            if (lo > hi) return 0;
+
+            u64 upper = hi == 63 ? ~0ULL : (1ULL << (hi + 1)) - 1;
+            return upper & (~0ULL << lo);
+        }
+
+        // Cells of row 'y' in word 'i' that hold '!value', i.e. that a fill
+        // with 'value' would change
+        inline u64 fillable(i32 y, i32 i, bool value) const
+        {
+            u64 w = bits[(size_t)y * stride + i];
+            return (value ? ~w : w) & validMask(i);
+        }
+
+        template<class F>
+        static inline void visitBits(u64 diff, i32 x_base, i32 y, F& visit)
+        {
+            while (diff) {
+                i32 b = __builtin_ctzll(diff);
+                visit(std::pair<i32, i32>(x_base + b, y));
+                diff &= diff - 1;
+            }
+        }
+
+        static inline void order(std::pair<i32, i32>& a, std::pair<i32, i32>& b)
+        {
+            if (a.first  > b.first)  std::swap(a.first,  b.first);
+            if (a.second > b.second) std::swap(a.second, b.second);
+        }
+
+        void clampRect(std::pair<i32, i32>& a, std::pair<i32, i32>& b) const;
+
+    public:
+        Grid() {}
+        Grid(i32 width, i32 height);
+
+        // Works on 'buffer' in place: 'height' rows of (width + 63) / 64
+        // words each, laid out like getRow(). The buffer must outlive the
+        // grid. Bits past the width are cleared.
+        Grid(i32 width, i32 height, u64* buffer);
+
+        // Copies always own their bitmap
+        Grid(const Grid& other);
+        Grid(Grid&& other) noexcept;
+        Grid& operator=(const Grid& other);
+        Grid& operator=(Grid&& other) noexcept;
+
+        // Keeps the cells of the overlapping area. A wrapped grid switches to
+        // a bitmap of its own.
+        void resize(i32 width, i32 height);
+
+        inline bool inBounds(const std::pair<i32, i32>& cell) const
+        {
+            return cell.first >= 0 && cell.second >= 0
+                && cell.first < width && cell.second < height;
+        }
+
+        // Cells outside of the grid count as blocked
+        inline bool isObstacle(const std::pair<i32, i32>& cell) const
+        {
+            if (!inBounds(cell)) return true;
+            return bits[(size_t)cell.second * stride + (cell.first >> 6)] >> (cell.first & 63) & 1;
+        }
+
+        inline void set(const std::pair<i32, i32>& cell)
+        {
+            if (!inBounds(cell)) return;
+            edits++;
+            bits[(size_t)cell.second * stride + (cell.first >> 6)] |= 1ULL << (cell.first & 63);
+        }
+
+        inline void reset(const std::pair<i32, i32>& cell)
+        {
+            if (!inBounds(cell)) return;
+            edits++;
+            bits[(size_t)cell.second * stride + (cell.first >> 6)] &= ~(1ULL << (cell.first & 63));
+        }
+
+        inline void flip(const std::pair<i32, i32>& cell)
+        {
+            if (!inBounds(cell)) return;
+            edits++;
+            bits[(size_t)cell.second * stride + (cell.first >> 6)] ^= 1ULL << (cell.first & 63);
+        }
+
+        void clear();
+        size_t count() const;
+
+        // Replaces row 'y' by 'getStride()' words in the layout of getRow()
+        void setRow(i32 y, const u64* words);
+
+        // Cost layer
+        inline u8 getCost(const std::pair<i32, i32>& cell) const
+            { return costs[(size_t)cell.second * cost_stride + cell.first]; }
+        inline void setCost(const std::pair<i32, i32>& cell, u8 cost)
+        {
+            if (!inBounds(cell)) return;
+            edits++;
+            costs[(size_t)cell.second * cost_stride + cell.first] = std::max<u8>(cost, 1);
+        }
+
+        void paintCost(const std::pair<i32, i32>& center, i32 radius, u8 cost);
+        void clearCosts();
+        u8 minCost() const;
+        u8 maxCost() const;
+
+        // Hash of the dimensions, obstacles and costs, for data derived
+        // from the grid to tell whether it still matches
+        u64 fingerprint() const;
+
+        // Cheaper than the fingerprint: the id is unique to this grid object
+        // (copies get their own) and the edits count its changes, so an
+        // unchanged pair means unchanged contents. A wrapped bitmap that is
+        // written from outside must be touched afterwards.
+        inline u64 getId() const { return id; }
+        inline u64 getEdits() const { return edits; }
+        inline void touch() { edits++; }
+
+        // Region operations
+        template<class F> void fillRect(std::pair<i32, i32> a, std::pair<i32, i32> b, bool value, F&& visit);
+        template<class F> void invertRect(std::pair<i32, i32> a, std::pair<i32, i32> b, F&& visit);
+        template<class F> void drawLine(std::pair<i32, i32> a, std::pair<i32, i32> b, bool value, F&& visit);
+        template<class F> void floodFill(std::pair<i32, i32> seed, bool value, F&& visit);
+
+        template<class F> void forEachObstacle(F&& visit) const;
+
+        // Supercover line of sight between the centers of 'a' and 'b', both
+        // inside the grid: every cell the segment passes through, and both
+        // cells beside a corner it crosses exactly, must be free. Returns the
+        // highest cost of the cells entered after 'a', 0 if the line is blocked.
+        u8 lineOfSight(const std::pair<i32, i32>& a, const std::pair<i32, i32>& b) const;
+
+        // Walks a 4-connected line from 'a' to 'b', calling 'step' for every
+        // cell until it returns false. Returns true if the whole line was walked.
+        template<class F> static bool walkLine(std::pair<i32, i32> a, std::pair<i32, i32> b, F&& step);
+
+        inline i32 getWidth()  const { return width; }
+        inline i32 getHeight() const { return height; }
+        inline i32 getStride() const { return stride; }
+        inline std::pair<i32, i32> getDimensions() const { return {width, height}; }
+        inline const u64* getRow(i32 y) const { return bits + (size_t)y * stride; }
+        inline bool isWrapped() const { return wrapped; }
+        inline const u8* getCostRow(i32 y) const { return costs.data() + (size_t)y * cost_stride; }
+
+};
+
+template<class F>
+void Grid::fillRect(std::pair<i32, i32> a, std::pair<i32, i32> b, bool value, F&& visit)
+{
+    order(a, b);
+    clampRect(a, b);
+    edits++;
+
+    for (i32 y = a.second; y <= b.second; y++) {
+        u64* r = row(y);
+        for (i32 i = a.first >> 6; i <= b.first >> 6; i++) {
+            u64 diff = fillable(y, i, value) & spanMask(i, a.first, b.first);
+            r[i] ^= diff;
+            visitBits(diff, i * 64, y, visit);
+        }
+    }
+}
+
+template<class F>
+void Grid::invertRect(std::pair<i32, i32> a, std::pair<i32, i32> b, F&& visit)
+{
+    order(a, b);
+    clampRect(a, b);
+    edits++;
+
+    for (i32 y = a.second; y <= b.second; y++) {
+        u64* r = row(y);
+        for (i32 i = a.first >> 6; i <= b.first >> 6; i++) {
+            u64 diff = spanMask(i, a.first, b.first);
+            r[i] ^= diff;
+            visitBits(diff, i * 64, y, visit);
+        }
+    }
+}
+
+template<class F>
+void Grid::drawLine(std::pair<i32, i32> a, std::pair<i32, i32> b, bool value, F&& visit)
+{
+    walkLine(a, b, [&](const std::pair<i32, i32>& cell) {
+        if (inBounds(cell) && isObstacle(cell) != value) {
+            flip(cell);
+            visit(cell);
+        }
+        return true;
+    });
+}
+
+template<class F>
+void Grid::floodFill(std::pair<i32, i32> seed, bool value, F&& visit)
+{
+    if (!inBounds(seed) || isObstacle(seed) == value) {
+        return;
+    }
+    edits++;
+
+    // Scanline fill: every popped seed grows into a maximal span of fillable
+    // cells, found with one bit scan per word, and queues one seed per run of
+    // fillable cells in the rows above and below the span.
+    std::vector<std::pair<i32, i32>> seeds = {seed};
+    while (!seeds.empty()) {
+        auto [x, y] = seeds.back();
+        seeds.pop_back();
+
+        i32 i = x >> 6;
+        if (!(fillable(y, i, value) >> (x & 63) & 1)) {
+            continue;
+        }
+
+        // Right end of the span
+        i32 x1 = width - 1;
+        for (i32 j = i; j < stride; j++) {
+            u64 blocked = ~fillable(y, j, value);
+            if (j == i) blocked &= ~0ULL << (x & 63);
+            if (blocked) {
+                x1 = j * 64 + __builtin_ctzll(blocked) - 1;
+                break;
+            }
+        }
+
+        // Left end of the span
+        i32 x0 = 0;
+        for (i32 j = i; j >= 0; j--) {
+            u64 blocked = ~fillable(y, j, value);
+            if (j == i && (x & 63) != 63) blocked &= (1ULL << ((x & 63) + 1)) - 1;
+            if (blocked) {
+                x0 = j * 64 + 63 - __builtin_clzll(blocked) + 1;
+                break;
+            }
+        }
+
+        u64* r = row(y);
+        for (i32 j = x0 >> 6; j <= x1 >> 6; j++) {
+            u64 diff = spanMask(j, x0, x1);
+            r[j] ^= diff;
+            visitBits(diff, j * 64, y, visit);
+        }
+
+        for (i32 ny : {y - 1, y + 1}) {
+            if (ny < 0 || ny >= height) continue;
+
+            for (i32 j = x0 >> 6; j <= x1 >> 6; j++) {
+                u64 f = fillable(ny, j, value) & spanMask(j, x0, x1);
+                while (f) {
+                    i32 s = __builtin_ctzll(f);
+                    seeds.push_back({j * 64 + s, ny});
+
+                    // Skip the rest of this run
+                    u64 rest = ~f & (~0ULL << s);
+                    f = rest ? f & (~0ULL << __builtin_ctzll(rest)) : 0;
+                }
+            }
+        }
+    }
+}
+
+template<class F>
+void Grid::forEachObstacle(F&& visit) const
+{
+    for (i32 y = 0; y < height; y++) {
+        const u64* r = getRow(y);
+        for (i32 i = 0; i < stride; i++) {
+            visitBits(r[i], i * 64, y, visit);
+        }
+    }
+}
+
+template<class F>
+bool Grid::walkLine(std::pair<i32, i32> a, std::pair<i32, i32> b, F&& step)
+{
+    i32 nx = abs(b.first  - a.first);
+    i32 ny = abs(b.second - a.second);
+    i32 sx = b.first  > a.first  ? 1 : -1;
+    i32 sy = b.second > a.second ? 1 : -1;
+
+    auto cell = a;
+    if (!step(cell)) return false;
+
+    // Step along the axis whose next cell border is closer to the line
+    for (i32 ix = 0, iy = 0; ix < nx || iy < ny; ) {
+        if ((i64)(1 + 2 * ix) * ny < (i64)(1 + 2 * iy) * nx) {
+            cell.first += sx;
+            ix++;
+        } else {
+            cell.second += sy;
+            iy++;
+        }
+
+        if (!step(cell)) return false;
+    }
+
+    return true;
+}
+
+#endif //GRID_HPP
@@ -0,0 +1,125 @@
+#include <thread>
+
+#include "GridVersions.hpp"
+
+// All atomics below are sequentially consistent. A reader announces its
+// epoch before it loads the current version, a publisher swaps the version
+// before it advances the epoch, so a reader that announced an epoch later
+// than the swap cannot load the replaced version, and one that announced
+// after the publisher looked at its slot loads the new one.
+
+GridVersions::~GridVersions()
+{
+    delete current.load();
+    for (auto& r : retired) delete r.version;
+    for (auto* v : recycled) delete v;
+}
+
+u64 GridVersions::publish(const Grid& draft)
+{
+    std::lock_guard<std::mutex> lock(publish_mutex);
+
+    Version* next;
+    if (!recycled.empty()) {
+        next = recycled.back();
+        recycled.pop_back();
+    } else {
+        next = new Version;
+    }
+
+    // Copy assignment keeps the storage of a recycled version
+    next->grid = draft;
+    next->number = ++latest;
+
+    Version* old = current.exchange(next);
+    u64 retired_in = epoch.fetch_add(1) + 1;
+    if (old) retired.push_back({old, retired_in});
+
+    reclaim();
+
+    return next->number;
+}
+
+void GridVersions::reclaim()
+{
+    u64 oldest = UINT64_MAX;
+    for (const auto& s : slots) {
+        u64 e = s.epoch.load();
+        if (e != 0) oldest = std::min(oldest, e);
+    }
+
+    size_t kept = 0;
+    for (auto& r : retired) {
+        if (r.epoch > oldest) {
+            retired[kept++] = r;
+        } else if (recycled.size() < MAX_RECYCLED) {
+            recycled.push_back(r.version);
+        } else {
+            delete r.version;
+        }
+    }
+    retired.resize(kept);
+}
+
+size_t GridVersions::pending()
+{
+    std::lock_guard<std::mutex> lock(publish_mutex);
+    reclaim();
+    return retired.size();
+}
+
+GridVersions::Snapshot GridVersions::pin()
+{
+    // Spread the readers over the slots, they rarely collide
+    static std::atomic<size_t> next_slot{0};
+    size_t k = next_slot++ % MAX_READERS;
+
+    while (true) {
+        for (size_t n = 0; n < MAX_READERS; n++, k = (k + 1) % MAX_READERS) {
+            u64 expected = 0;
+            if (!slots[k].epoch.compare_exchange_strong(expected, epoch.load())) continue;
+
+            Snapshot snapshot;
+            snapshot.owner = this;
+            snapshot.slot = k;
+            snapshot.version = current.load();
+            return snapshot;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+GridVersions::Snapshot::~Snapshot()
+{
+    release();
+}
+
+GridVersions::Snapshot::Snapshot(Snapshot&& other) noexcept
+    : owner(other.owner), slot(other.slot), version(other.version)
+{
+    other.owner = nullptr;
+    other.version = nullptr;
+}
+
+GridVersions::Snapshot& GridVersions::Snapshot::operator=(Snapshot&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        owner   = other.owner;
+        slot    = other.slot;
+        version = other.version;
+        other.owner = nullptr;
+        other.version = nullptr;
+    }
+    return *this;
+}
+
+void GridVersions::Snapshot::release()
+{
+    if (owner) {
+        owner->slots[slot].epoch.store(0);
+        owner = nullptr;
+        version = nullptr;
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef GRID_VERSIONS_HPP
+#define GRID_VERSIONS_HPP
+
+#include <atomic>
+#include <mutex>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+
+// Published, immutable versions of a grid that is edited elsewhere, so
+// searches on other threads can run while the map changes.
+//
+// The editor keeps its own draft and publishes a copy of it, which replaces
+// the current version atomically. A reader pins the current version and
+// reads it without taking a lock for as long as it likes. Replaced versions
+// are reclaimed RCU-style: a reader announces the epoch it started in, and a
+// version retired in a later epoch than every announced one can no longer be
+// seen by anybody. Reclaimed versions are recycled as the next copies, so a
+// publish on a warmed up map allocates nothing.
+class GridVersions {
+
+    private:
+        struct Version {
+            Grid grid;
+            u64 number = 0;
+        };
+
+        struct Retired {
+            Version* version;
+            u64 epoch;      // First epoch in which it was not current anymore
+        };
+
+        // One per concurrent reader, 0 while free, else the epoch it pinned in
+        struct alignas(64) Slot {
+            std::atomic<u64> epoch{0};
+        };
+
+        static constexpr size_t MAX_READERS = 64;
+        static constexpr size_t MAX_RECYCLED = 2;
+
+        std::atomic<Version*> current{nullptr};
+        std::atomic<u64> epoch{1};
+        Slot slots[MAX_READERS];
+
+        // Publishers only
+        std::mutex publish_mutex;
+        std::vector<Retired> retired;
+        std::vector<Version*> recycled;
+        u64 latest = 0;
+
+        void reclaim();
+
+    public:
+        // A pinned version, readable until it is destroyed
+        class Snapshot {
+
+            private:
+                GridVersions* owner = nullptr;
+                size_t slot = 0;
+                const Version* version = nullptr;
+
+                friend class GridVersions;
+
+            public:
+                Snapshot() {}
+                ~Snapshot();
+
+                Snapshot(Snapshot&& other) noexcept;
+                Snapshot& operator=(Snapshot&& other) noexcept;
+                Snapshot(const Snapshot&) = delete;
+                Snapshot& operator=(const Snapshot&) = delete;
+
+                void release();
+
+                inline bool valid() const { return version != nullptr; }
+                inline const Grid& grid() const { return version->grid; }
+                inline u64 number() const { return version->number; }
+
+        };
+
+        GridVersions() {}
+        ~GridVersions();    // No snapshot may outlive the versions
+
+        GridVersions(const GridVersions&) = delete;
+        GridVersions& operator=(const GridVersions&) = delete;
+
+        // Publishes a copy of 'draft' and returns its version number
+        u64 publish(const Grid& draft);
+
+        // Lock-free, spins only while all MAX_READERS slots are taken. Not
+        // valid before the first publish.
+        Snapshot pin();
+
+        // Number of the current version, 0 before the first publish
+        inline u64 version() const
+            { const Version* v = current.load(); return v ? v->number : 0; }
+
+        // Versions replaced but still pinned by somebody
+        size_t pending();
+
+};
+
+#endif //GRID_VERSIONS_HPP
@@ -0,0 +1,261 @@
+#include <cstdio>
+
+#include "Headless.hpp"
+#include "Components.hpp"
+#include "Cooperative.hpp"
+#include "FlowField.hpp"
+#include "MultiTarget.hpp"
+#include "Scene.hpp"
+#include "SubgoalGraph.hpp"
+#include "PathDatabase.hpp"
+#include "Maps.hpp"
+
+// Prints every path an anytime engine reports
+class PrintObserver : public SearchObserver {
+
+    public:
+        void onImprove(const SearchResult& result) override
+        {
+            printf("improved: cost %lld, epsilon %.3f, %llu expanded, %.3f ms\n",
+                    (long long)result.cost, result.epsilon,
+                    (unsigned long long)result.expanded, result.elapsed_ms);
+        }
+
+};
+
+// Sends agents from random free cells to 'target' along one shared flow field
+static void routeAgents(const Grid& grid, const std::pair<i32, i32>& target, u32 agents, std::mt19937& rng)
+{
+    auto t0 = search::Clock::now();
+
+    FlowField flow_field;
+    flow_field.build(grid, target);
+
+    double build_ms = search::millisSince(t0);
+
+    std::uniform_int_distribution<i32> xs(0, grid.getWidth() - 1);
+    std::uniform_int_distribution<i32> ys(0, grid.getHeight() - 1);
+
+    std::vector<std::pair<i32, i32>> starts;
+    while (starts.size() < agents) {
+        std::pair<i32, i32> cell = {xs(rng), ys(rng)};
+        if (!grid.isObstacle(cell)) starts.push_back(cell);
+    }
+
+    t0 = search::Clock::now();
+
+    u32 arrived = 0;
+    u64 steps = 0;
+    std::vector<std::pair<i32, i32>> path;
+    for (const auto& start : starts) {
+        if (flow_field.pathFrom(start, path)) {
+            arrived++;
+            steps += path.size() - 1;
+        }
+    }
+
+    double route_ms = search::millisSince(t0);
+
+    printf("flow field: built in %.3f ms, %u of %u agents arrived in %llu steps, %.3f ms (%.3f us per agent)\n",
+            build_ms, arrived, agents, (unsigned long long)steps, route_ms, 1000.0 * route_ms / agents);
+}
+
+// Searches from 'start' to the nearest of random free cells, then to all of
+// them, each in one expansion
+static void searchTargets(const Grid& grid, const std::pair<i32, i32>& start, u32 targets, std::mt19937& rng)
+{
+    std::uniform_int_distribution<i32> xs(0, grid.getWidth() - 1);
+    std::uniform_int_distribution<i32> ys(0, grid.getHeight() - 1);
+
+    MultiTargetQuery query;
+    query.start = start;
+    while (query.targets.size() < targets) {
+        std::pair<i32, i32> cell = {xs(rng), ys(rng)};
+        if (!grid.isObstacle(cell)) query.targets.push_back(cell);
+    }
+
+    MultiTargetSearch search;
+
+    i32 reached;
+    SearchResult nearest = search.nearest(grid, query, reached);
+    if (nearest.found) {
+        printf("nearest of %u targets: #%d at %d,%d, cost %lld, %llu expanded, %.3f ms\n",
+                targets, reached, query.targets[reached].first, query.targets[reached].second,
+                (long long)nearest.cost, (unsigned long long)nearest.expanded, nearest.elapsed_ms);
+    } else {
+        printf("nearest of %u targets: none reachable, %llu expanded, %.3f ms\n",
+                targets, (unsigned long long)nearest.expanded, nearest.elapsed_ms);
+    }
+
+    auto all = search.all(grid, query);
+
+    u32 found = 0;
+    u64 expanded = 0;
+    double elapsed_ms = 0.0;
+    for (const auto& result : all) {
+        found += result.found;
+        expanded   = std::max(expanded, result.expanded);
+        elapsed_ms = std::max(elapsed_ms, result.elapsed_ms);
+    }
+
+    printf("all %u targets: %u reached, %llu expanded, %.3f ms\n",
+            targets, found, (unsigned long long)expanded, elapsed_ms);
+}
+
+// Plans agents between random distinct free cells connected to 'start', none
+// may share a cell with another at any step
+static void planAgents(const Grid& grid, const std::pair<i32, i32>& start, u32 agents, u32 window, std::mt19937& rng)
+{
+    std::uniform_int_distribution<i32> xs(0, grid.getWidth() - 1);
+    std::uniform_int_distribution<i32> ys(0, grid.getHeight() - 1);
+
+    Components components;
+    u64 area = 0;
+    for (i32 y = 0; y < grid.getHeight(); y++) {
+        for (i32 x = 0; x < grid.getWidth(); x++) {
+            area += !grid.isObstacle({x, y}) && components.connected(grid, start, {x, y});
+        }
+    }
+    if (area < agents) {
+        printf("cooperative: %u agents do not fit in %llu connected cells\n", agents, (unsigned long long)area);
+        return;
+    }
+
+    std::unordered_set<std::pair<i32, i32>, pair_hash> starts, targets;
+    std::vector<AgentTask> tasks;
+    while (tasks.size() < agents) {
+        std::pair<i32, i32> from = {xs(rng), ys(rng)};
+        std::pair<i32, i32> to   = {xs(rng), ys(rng)};
+        if (grid.isObstacle(from) || grid.isObstacle(to)) continue;
+        if (!components.connected(grid, start, from) || !components.connected(grid, start, to)) continue;
+        if (starts.count(from) || targets.count(to)) continue;
+
+        starts.insert(from);
+        targets.insert(to);
+        tasks.push_back({from, to});
+    }
+
+    CooperativePlanner planner(window);
+    AgentPlan plan = planner.plan(grid, tasks);
+
+    printf("cooperative (window %u): %u of %u agents arrived, makespan %u, sum of costs %llu, %llu expanded, %u replans, %.3f ms, %llu conflicts\n",
+            window, plan.arrived, agents, plan.makespan, (unsigned long long)plan.sum_of_costs,
+            (unsigned long long)plan.expanded, plan.replans, plan.elapsed_ms,
+            (unsigned long long)countConflicts(plan.paths));
+}
+
+void buildMap(const Options& options, Grid& grid, SearchQuery& query, std::mt19937& rng)
+{
+    query.budget_ms = options.budget_ms;
+
+    std::pair<i32, i32> start, target;
+    if (!options.scene.empty()) {
+        Scene scene;
+        loadScene(options.scene, scene);
+
+        grid   = std::move(scene.grid);
+        start  = scene.start;
+        target = scene.target;
+    } else {
+        generateMap(options.map, options.size, options.density, rng, grid, start, target);
+    }
+
+    query.start  = options.start.first  < 0 ? start  : options.start;
+    query.target = options.target.first < 0 ? target : options.target;
+    if (!grid.inBounds(query.start) || !grid.inBounds(query.target)) {
+        throw std::runtime_error("Start and target must lie inside the grid!");
+    }
+
+    // A generated map makes way for the ends it was given
+    if (options.scene.empty()) {
+        grid.reset(query.start);
+        grid.reset(query.target);
+    }
+}
+
+int runHeadless(const Options& options)
+{
+    Grid grid;
+    SearchQuery query;
+    std::mt19937 rng(options.seed);
+    buildMap(options, grid, query, rng);
+
+    if (!options.save_scene.empty()) {
+        Scene scene;
+        scene.grid   = grid;
+        scene.start  = query.start;
+        scene.target = query.target;
+        saveScene(options.save_scene, scene);
+    }
+
+    // A scene keeps its preprocessed data next to it
+    EngineConfig engine_config = options.engine_config;
+    if (engine_config.data_path.empty()) engine_config.data_path = options.scene;
+
+    auto engine = createEngine(options.engine, engine_config);
+
+    // Preprocessing is paid once per map, so it is reported apart
+    if (auto* subgoals = dynamic_cast<SubgoalSearch*>(engine.get())) {
+        subgoals->prepare(grid);
+
+        const SubgoalGraph& graph = subgoals->getGraph();
+        if (graph.usable()) {
+            printf("subgoal graph: %zu subgoals, %zu edges, %.1f KiB, ready in %.3f ms\n",
+                    graph.size(), graph.edgeCount(), graph.bytes() / 1024.0, graph.getBuildMs());
+        } else {
+            printf("subgoal graph: terrain costs differ, searching with A*\n");
+        }
+    }
+
+    if (auto* database = dynamic_cast<PathDatabaseSearch*>(engine.get())) {
+        if (database->prepare(grid)) {
+            const PathDatabase& table = database->getDatabase();
+            printf("path database: %u cells, %llu runs, %.1f KiB, %s in %.3f ms\n",
+                    table.cellCount(), (unsigned long long)table.runCount(), table.bytes() / 1024.0,
+                    table.isMapped() ? "mapped" : "built", table.getBuildMs());
+        } else {
+            printf("path database: more than %u free cells, searching with A*\n", PathDatabaseSearch::MAX_CELLS);
+        }
+    }
+
+    Components components;
+    if (!components.connected(grid, query.start, query.target)) {
+        printf("%s: no path (start and target are not connected)\n", engine->getName());
+        return EXIT_FAILURE;
+    }
+
+    PrintObserver observer;
+    SearchResult result = engine->search(grid, query, &observer);
+
+    if (!result.found) {
+        printf("%s: no path%s, %llu expanded, %.3f ms\n",
+                engine->getName(), result.timed_out ? " within the budget" : "",
+                (unsigned long long)result.expanded, result.elapsed_ms);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: cost %lld, length %zu, epsilon %.3f, %llu expanded, %.3f ms%s\n",
+            engine->getName(), (long long)result.cost, result.path.size(), result.epsilon,
+            (unsigned long long)result.expanded, result.elapsed_ms,
+            result.timed_out ? " (budget exhausted)" : "");
+
+    // What a memory-bounded engine paid in repeated work for its smaller footprint
+    printf("memory: %zu peak nodes, %llu generated, %llu reexpanded (%.1f%% of expansions)\n",
+            result.peak_nodes, (unsigned long long)result.generated,
+            (unsigned long long)result.reexpanded,
+            result.expanded ? 100.0 * result.reexpanded / result.expanded : 0.0);
+
+    if (options.agents > 0) {
+        routeAgents(grid, query.target, options.agents, rng);
+    }
+
+    if (options.targets > 0) {
+        searchTargets(grid, query.start, options.targets, rng);
+    }
+
+    if (options.cooperative > 0) {
+        planAgents(grid, query.start, options.cooperative, options.window, rng);
+    }
+
+    return EXIT_SUCCESS;
+}
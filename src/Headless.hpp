@@ -0,0 +1,18 @@
+#ifndef HEADLESS_HPP
+#define HEADLESS_HPP
+
+#include <random>
+
+#include "Options.hpp"
+#include "Grid.hpp"
+#include "Search.hpp"
+
+// Runs one query without SDL and prints every (improved) result to stdout.
+// Returns the process exit code.
+int runHeadless(const Options& options);
+
+// Fills 'grid' with the generated map described by 'options', or the scene
+// it names, and sets up the query between its start and target
+void buildMap(const Options& options, Grid& grid, SearchQuery& query, std::mt19937& rng);
+
+#endif //HEADLESS_HPP
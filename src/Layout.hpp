@@ -0,0 +1,129 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+#include "Util.hpp"
+
+// Orders of the per-cell search state in memory
+enum Layouts {
+    LAYOUT_ROWS,    // Row-major, north and south neighbours a full row apart
+    LAYOUT_TILES,   // 64x64 tiles, row-major inside a tile
+    LAYOUT_MORTON   // 64x64 tiles, Z-order inside a tile
+};
+
+// Z-order codes of coordinates below 2^16: the bits of x and y interleaved,
+// x in the even bits. Compiled to pdep/pext where BMI2 is enabled.
+namespace morton {
+
+    inline u32 spread(u32 v)
+    {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    inline u32 compact(u32 v)
+    {
+        v &= 0x55555555;
+        v = (v | (v >> 1)) & 0x33333333;
+        v = (v | (v >> 2)) & 0x0f0f0f0f;
+        v = (v | (v >> 4)) & 0x00ff00ff;
+        v = (v | (v >> 8)) & 0x0000ffff;
+        return v;
+    }
+
+    // Portable versions, also kept for comparison in the benchmark
+    inline u32 encodePortable(u32 x, u32 y) { return spread(x) | spread(y) << 1; }
+    inline std::pair<u32, u32> decodePortable(u32 code) { return {compact(code), compact(code >> 1)}; }
+
+    inline u32 encode(u32 x, u32 y)
+    {
+#ifdef __BMI2__
+        return _pdep_u32(x, 0x55555555) | _pdep_u32(y, 0xaaaaaaaa);
+#else
+        return encodePortable(x, y);
+#endif
+    }
+
+    inline std::pair<u32, u32> decode(u32 code)
+    {
+#ifdef __BMI2__
+        return {_pext_u32(code, 0x55555555), _pext_u32(code, 0xaaaaaaaa)};
+#else
+        return decodePortable(code);
+#endif
+    }
+
+}
+
+// Maps cells to slots of a dense array in one of the Layouts. The tiled
+// layouts keep the cells a search expands next to each other close in
+// memory, a row-major array puts the north and south neighbours of a cell
+// on 4096-wide maps 4096 slots away. Tiles along the right and bottom edge
+// are padded, size() counts the padding.
+class CellLayout {
+
+    private:
+        static constexpr i32 TILE_BITS = 6;
+        static constexpr i32 TILE = 1 << TILE_BITS;
+
+        short kind = LAYOUT_ROWS;
+        i32 width  = 0;
+        i32 height = 0;
+        i32 tiles  = 0;     // Tiles per row of tiles
+
+    public:
+        CellLayout() {}
+
+        inline void configure(short kind, i32 width, i32 height)
+        {
+            this->kind   = kind;
+            this->width  = width;
+            this->height = height;
+            tiles = (width + TILE - 1) >> TILE_BITS;
+        }
+
+        inline size_t size() const
+        {
+            if (kind == LAYOUT_ROWS) return (size_t)width * height;
+            return (size_t)tiles * ((height + TILE - 1) >> TILE_BITS) << (2 * TILE_BITS);
+        }
+
+        inline size_t index(const std::pair<i32, i32>& cell) const
+        {
+            auto [x, y] = cell;
+            if (kind == LAYOUT_ROWS) return (size_t)y * width + x;
+
+            size_t tile = (size_t)(y >> TILE_BITS) * tiles + (x >> TILE_BITS);
+            u32 lx = x & (TILE - 1), ly = y & (TILE - 1);
+            u32 inner = kind == LAYOUT_MORTON ? morton::encode(lx, ly) : ly << TILE_BITS | lx;
+
+            return tile << (2 * TILE_BITS) | inner;
+        }
+
+        inline std::pair<i32, i32> cell(size_t i) const
+        {
+            if (kind == LAYOUT_ROWS) return {(i32)(i % width), (i32)(i / width)};
+
+            size_t tile = i >> (2 * TILE_BITS);
+            u32 inner = i & ((1u << (2 * TILE_BITS)) - 1);
+
+            std::pair<u32, u32> local = kind == LAYOUT_MORTON
+                ? morton::decode(inner)
+                : std::pair<u32, u32>(inner & (TILE - 1), inner >> TILE_BITS);
+
+            return {(i32)((tile % tiles) << TILE_BITS | local.first),
+                    (i32)((tile / tiles) << TILE_BITS | local.second)};
+        }
+
+        inline short getKind() const { return kind; }
+
+};
+
+#endif //LAYOUT_HPP
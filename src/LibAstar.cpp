@@ -0,0 +1,328 @@
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
+#include "astar.h"
+#include "Engines.hpp"
+#include "Components.hpp"
+
+struct astar_grid {
+    Grid grid;
+
+    astar_grid(Grid grid) : grid(std::move(grid)) {}
+
+    // Rebuilt by the first batch after an edit, under the lock since
+    // batches may run on the grid at once
+    mutable std::mutex mutex;
+    mutable Components components;
+    mutable u64 components_edits = 0;
+};
+
+struct astar_engine {
+    std::string name;
+    EngineConfig config;
+
+    // One per thread of the last batch, the first one always exists
+    std::vector<std::unique_ptr<SearchEngine>> engines;
+};
+
+static thread_local std::string last_error;
+
+// Runs 'f' and turns exceptions into a status and a message
+template<class F>
+static int32_t guarded(F&& f)
+{
+    try {
+        last_error.clear();
+        return f();
+    } catch (const std::invalid_argument& e) {
+        last_error = e.what();
+        return ASTAR_ERROR_ARGUMENT;
+    } catch (const std::exception& e) {
+        last_error = e.what();
+        return ASTAR_ERROR_INTERNAL;
+    }
+}
+
+static void require(bool condition, const char* message)
+{
+    if (!condition) throw std::invalid_argument(message);
+}
+
+static void requireCell(const astar_grid* grid, i32 x, i32 y)
+{
+    require(grid != nullptr, "grid is NULL");
+    require(grid->grid.inBounds({x, y}), "cell outside of the grid");
+}
+
+extern "C" {
+
+int32_t astar_abi_version(void)
+{
+    return ASTAR_ABI_VERSION;
+}
+
+const char* astar_last_error(void)
+{
+    return last_error.c_str();
+}
+
+astar_grid* astar_grid_create(int32_t width, int32_t height)
+{
+    astar_grid* grid = nullptr;
+    guarded([&] {
+        require(width > 0 && height > 0, "grid size must be positive");
+        grid = new astar_grid(Grid(width, height));
+        return ASTAR_OK;
+    });
+
+    return grid;
+}
+
+astar_grid* astar_grid_wrap(int32_t width, int32_t height, uint64_t* bits)
+{
+    astar_grid* grid = nullptr;
+    guarded([&] {
+        require(width > 0 && height > 0, "grid size must be positive");
+        require(bits != nullptr, "bits is NULL");
+        grid = new astar_grid(Grid(width, height, bits));
+        return ASTAR_OK;
+    });
+
+    return grid;
+}
+
+void astar_grid_destroy(astar_grid* grid)
+{
+    delete grid;
+}
+
+int32_t astar_grid_width(const astar_grid* grid)
+{
+    return grid ? grid->grid.getWidth() : ASTAR_ERROR_ARGUMENT;
+}
+
+int32_t astar_grid_height(const astar_grid* grid)
+{
+    return grid ? grid->grid.getHeight() : ASTAR_ERROR_ARGUMENT;
+}
+
+int32_t astar_grid_get(const astar_grid* grid, int32_t x, int32_t y)
+{
+    return guarded([&] {
+        requireCell(grid, x, y);
+        return (int32_t)grid->grid.isObstacle({x, y});
+    });
+}
+
+int32_t astar_grid_set(astar_grid* grid, int32_t x, int32_t y, int32_t blocked)
+{
+    return guarded([&] {
+        requireCell(grid, x, y);
+        if (blocked) grid->grid.set({x, y});
+        else grid->grid.reset({x, y});
+        return ASTAR_OK;
+    });
+}
+
+int32_t astar_grid_fill(astar_grid* grid, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t blocked)
+{
+    return guarded([&] {
+        require(grid != nullptr, "grid is NULL");
+        grid->grid.fillRect({x0, y0}, {x1, y1}, blocked != 0, [](const std::pair<i32, i32>&) {});
+        return ASTAR_OK;
+    });
+}
+
+int32_t astar_grid_clear(astar_grid* grid)
+{
+    return guarded([&] {
+        require(grid != nullptr, "grid is NULL");
+        grid->grid.clear();
+        return ASTAR_OK;
+    });
+}
+
+int32_t astar_grid_set_cost(astar_grid* grid, int32_t x, int32_t y, uint8_t cost)
+{
+    return guarded([&] {
+        requireCell(grid, x, y);
+        require(cost > 0, "cost must be 1 to 255");
+        grid->grid.setCost({x, y}, cost);
+        return ASTAR_OK;
+    });
+}
+
+int32_t astar_grid_touch(astar_grid* grid)
+{
+    return guarded([&] {
+        require(grid != nullptr, "grid is NULL");
+        grid->grid.touch();
+        return ASTAR_OK;
+    });
+}
+
+void astar_engine_config_default(astar_engine_config* config)
+{
+    if (!config) return;
+
+    EngineConfig defaults;
+    config->name         = "astar";
+    config->weight       = defaults.weight;
+    config->epsilon      = defaults.epsilon;
+    config->epsilon_step = defaults.epsilon_step;
+    config->node_cap     = defaults.node_cap;
+    config->table_size   = defaults.table_size;
+    config->layout       = defaults.layout;
+}
+
+astar_engine* astar_engine_create(const astar_engine_config* config, int32_t* status)
+{
+    astar_engine* engine = nullptr;
+    int32_t result = guarded([&] {
+        require(config != nullptr && config->name != nullptr, "config or its name is NULL");
+        require(config->layout >= ASTAR_LAYOUT_ROWS && config->layout <= ASTAR_LAYOUT_MORTON, "unknown layout");
+
+        auto created = std::make_unique<astar_engine>();
+        created->name = config->name;
+        created->config.weight       = config->weight;
+        created->config.epsilon      = config->epsilon;
+        created->config.epsilon_step = config->epsilon_step;
+        created->config.node_cap     = config->node_cap;
+        created->config.table_size   = config->table_size;
+        created->config.layout       = (short)config->layout;
+
+        try {
+            created->engines.push_back(createEngine(created->name, created->config));
+        } catch (const std::runtime_error& e) {
+            last_error = e.what();
+            return ASTAR_ERROR_ENGINE;
+        }
+
+        engine = created.release();
+        return ASTAR_OK;
+    });
+
+    if (status) *status = result;
+    return engine;
+}
+
+void astar_engine_destroy(astar_engine* engine)
+{
+    delete engine;
+}
+
+int32_t astar_search_batch(
+        astar_engine* engine,
+        const astar_grid* grid,
+        const astar_query* queries,
+        size_t count,
+        astar_result* results,
+        int32_t* path_xy,
+        size_t path_capacity,
+        uint32_t threads)
+{
+    return guarded([&] {
+        require(engine != nullptr && grid != nullptr, "engine or grid is NULL");
+        require(count == 0 || (queries != nullptr && results != nullptr), "queries or results is NULL");
+        require(path_capacity == 0 || path_xy != nullptr, "path_xy is NULL");
+
+        const Grid& g = grid->grid;
+
+        // Queries across components are answered without a search
+        const Components& components = [&]() -> const Components& {
+            std::lock_guard<std::mutex> lock(grid->mutex);
+            if (grid->components.isDirty() || grid->components_edits != g.getEdits()) {
+                grid->components.build(g);
+                grid->components_edits = g.getEdits();
+            }
+            return grid->components;
+        }();
+
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        threads = (u32)std::min<size_t>(threads, std::max<size_t>(count, 1));
+
+        while (engine->engines.size() < threads) {
+            engine->engines.push_back(createEngine(engine->name, engine->config));
+        }
+
+        // The paths are only copied out once all lengths are known
+        std::vector<SearchResult> found(count);
+        std::vector<u8> valid(count);
+        std::atomic<size_t> next{0};
+
+        auto work = [&](SearchEngine& e) {
+            for (size_t k = next++; k < count; k = next++) {
+                const astar_query& q = queries[k];
+
+                SearchQuery query;
+                query.start  = {q.start_x,  q.start_y};
+                query.target = {q.target_x, q.target_y};
+                query.budget_ms = q.budget_ms;
+
+                valid[k] = !g.isObstacle(query.start) && !g.isObstacle(query.target);
+                if (valid[k] && components.sameComponent(query.start, query.target)) found[k] = e.search(g, query);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(threads);
+        for (u32 t = 1; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                try {
+                    work(*engine->engines[t]);
+                } catch (...) {
+                    errors[t] = std::current_exception();
+                }
+            });
+        }
+
+        try {
+            work(*engine->engines[0]);
+        } catch (...) {
+            errors[0] = std::current_exception();
+        }
+
+        for (auto& w : workers) w.join();
+        for (auto& error : errors) {
+            if (error) std::rethrow_exception(error);
+        }
+
+        size_t used = 0;
+        for (size_t k = 0; k < count; k++) {
+            const SearchResult& r = found[k];
+            astar_result& out = results[k];
+
+            out = astar_result();
+            out.path_offset = used;
+
+            if (!valid[k]) {
+                out.status = ASTAR_INVALID;
+                continue;
+            }
+
+            out.status      = r.timed_out ? ASTAR_TIMED_OUT : r.found ? ASTAR_FOUND : ASTAR_NO_PATH;
+            out.cost        = r.cost;
+            out.epsilon     = r.epsilon;
+            out.path_cells  = r.path.size();
+            out.expanded    = r.expanded;
+            out.elapsed_ms  = r.elapsed_ms;
+
+            if (r.path.size() > path_capacity - used) {
+                out.truncated = !r.path.empty();
+                continue;
+            }
+
+            for (const auto& cell : r.path) {
+                path_xy[2 * used]     = cell.first;
+                path_xy[2 * used + 1] = cell.second;
+                used++;
+            }
+            out.path_length = r.path.size();
+        }
+
+        return ASTAR_OK;
+    });
+}
+
+}
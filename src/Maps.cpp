@@ -0,0 +1,260 @@
+#include <stdexcept>
+
+#include "Maps.hpp"
+#include "Components.hpp"
+
+// Rooms are placed one per slot of a lattice of this many cells
+static constexpr i32 ROOM_SLOT = 24;
+static constexpr double ROOM_CHANCE = 0.75;
+
+const std::vector<MapInfo>& mapList()
+{
+    static const std::vector<MapInfo> maps = {
+        {"random", MAP_RANDOM},
+        {"maze",   MAP_MAZE},
+        {"rooms",  MAP_ROOMS},
+        {"open",   MAP_OPEN},
+    };
+
+    return maps;
+}
+
+short mapByName(const std::string& name)
+{
+    for (const auto& map : mapList()) {
+        if (name == map.name) return map.kind;
+    }
+
+    throw std::runtime_error("Unknown map '" + name + "'!");
+}
+
+static void none(const std::pair<i32, i32>&) {}
+
+// Corners that are walled in are swapped for the closest pair of cells on
+// the diagonal that are connected
+static void randomMap(Grid& grid, double density, std::mt19937& rng, std::pair<i32, i32>& start, std::pair<i32, i32>& target)
+{
+    const i32 width  = grid.getWidth();
+    const i32 height = grid.getHeight();
+
+    std::bernoulli_distribution blocked(density);
+    for (i32 y = 0; y < height; y++) {
+        for (i32 x = 0; x < width; x++) {
+            if (blocked(rng)) grid.set({x, y});
+        }
+    }
+
+    if (density == 0.0) return;
+
+    Components components;
+    for (i32 k = 0; k < std::min(width, height) / 4; k++) {
+        std::pair<i32, i32> s = {k, k};
+        std::pair<i32, i32> t = {width - 1 - k, height - 1 - k};
+        if (grid.isObstacle(s) || grid.isObstacle(t)) continue;
+
+        if (components.connected(grid, s, t)) {
+            start  = s;
+            target = t;
+            return;
+        }
+    }
+}
+
+// Cells on even coordinates are joined through the odd cells between them
+static void mazeMap(Grid& grid, std::mt19937& rng, std::pair<i32, i32>& start, std::pair<i32, i32>& target)
+{
+    const i32 w = (grid.getWidth()  + 1) / 2;
+    const i32 h = (grid.getHeight() + 1) / 2;
+
+    grid.fillRect({0, 0}, {grid.getWidth() - 1, grid.getHeight() - 1}, true, none);
+
+    static const std::pair<i32, i32> DIRS[4] = {{-1, 0}, {0, -1}, {1, 0}, {0, 1}};
+
+    // Iterative, the corridors of a large maze are far deeper than the stack
+    std::vector<u32> stack = {0};
+    grid.reset({0, 0});
+
+    while (!stack.empty()) {
+        i32 cx = stack.back() % w;
+        i32 cy = stack.back() / w;
+
+        std::pair<i32, i32> open[4];
+        i32 n = 0;
+        for (const auto& d : DIRS) {
+            i32 nx = cx + d.first;
+            i32 ny = cy + d.second;
+            if (nx < 0 || ny < 0 || nx >= w || ny >= h) continue;
+            if (!grid.isObstacle({2 * nx, 2 * ny})) continue;
+
+            open[n++] = {nx, ny};
+        }
+
+        if (n == 0) {
+            stack.pop_back();
+            continue;
+        }
+
+        auto [nx, ny] = open[rng() % n];
+        grid.reset({cx + nx, cy + ny});     // The wall between both cells
+        grid.reset({2 * nx, 2 * ny});
+        stack.push_back((u32)ny * w + nx);
+    }
+
+    start  = {0, 0};
+    target = {2 * (w - 1), 2 * (h - 1)};
+}
+
+static void roomsMap(Grid& grid, std::mt19937& rng, std::pair<i32, i32>& start, std::pair<i32, i32>& target)
+{
+    const i32 width  = grid.getWidth();
+    const i32 height = grid.getHeight();
+
+    grid.fillRect({0, 0}, {width - 1, height - 1}, true, none);
+
+    const i32 slots_x = std::max(1, width  / ROOM_SLOT);
+    const i32 slots_y = std::max(1, height / ROOM_SLOT);
+    const i32 slot_w = width  / slots_x;
+    const i32 slot_h = height / slots_y;
+
+    // Center of the room in every slot, x < 0 for empty slots
+    std::vector<std::pair<i32, i32>> rooms((size_t)slots_x * slots_y, {-1, -1});
+    std::bernoulli_distribution present(ROOM_CHANCE);
+
+    auto range = [&](i32 lo, i32 hi) { return lo + (i32)(rng() % (u32)(hi - lo + 1)); };
+
+    for (i32 sy = 0; sy < slots_y; sy++) {
+        for (i32 sx = 0; sx < slots_x; sx++) {
+            if (!present(rng) && sx + sy > 0) continue;
+
+            // At least a cell of wall to the next slot where there is space
+            i32 rw = range(std::min(4, slot_w), std::max(std::min(4, slot_w), slot_w - 2));
+            i32 rh = range(std::min(4, slot_h), std::max(std::min(4, slot_h), slot_h - 2));
+            i32 x0 = sx * slot_w + range(0, slot_w - rw);
+            i32 y0 = sy * slot_h + range(0, slot_h - rh);
+
+            grid.fillRect({x0, y0}, {x0 + rw - 1, y0 + rh - 1}, false, none);
+            rooms[(size_t)sy * slots_x + sx] = {x0 + rw / 2, y0 + rh / 2};
+        }
+    }
+
+    auto corridor = [&](std::pair<i32, i32> a, std::pair<i32, i32> b) {
+        grid.fillRect(a, {b.first, a.second}, false, none);
+        grid.fillRect({b.first, a.second}, b, false, none);
+    };
+
+    auto room = [&](i32 sx, i32 sy) { return rooms[(size_t)sy * slots_x + sx]; };
+
+    // Every room to the next one to its right and below, and the first room
+    // of each row to the first of the next row with rooms, so all connect
+    std::pair<i32, i32> row_first = {-1, -1};
+    for (i32 sy = 0; sy < slots_y; sy++) {
+        std::pair<i32, i32> first = {-1, -1};
+
+        for (i32 sx = 0; sx < slots_x; sx++) {
+            auto a = room(sx, sy);
+            if (a.first < 0) continue;
+
+            if (first.first < 0) first = a;
+
+            for (i32 nx = sx + 1; nx < slots_x; nx++) {
+                if (room(nx, sy).first >= 0) {
+                    corridor(a, room(nx, sy));
+                    break;
+                }
+            }
+
+            for (i32 ny = sy + 1; ny < slots_y; ny++) {
+                if (room(sx, ny).first >= 0) {
+                    corridor(a, room(sx, ny));
+                    break;
+                }
+            }
+
+            target = a;
+        }
+
+        if (first.first >= 0) {
+            if (row_first.first >= 0) corridor(row_first, first);
+            row_first = first;
+        }
+    }
+
+    start = room(0, 0);
+}
+
+// Walls never touch each other, not even diagonally, so the free cells stay
+// connected whatever the density
+static void openMap(Grid& grid, double density, std::mt19937& rng)
+{
+    const i32 width  = grid.getWidth();
+    const i32 height = grid.getHeight();
+
+    const double cells = density * width * height;
+    const i32 longest = std::max(4, std::min(width, height) / 8);
+
+    auto vacant = [&](i32 x0, i32 y0, i32 x1, i32 y1) {
+        for (i32 y = y0; y <= y1; y++) {
+            for (i32 x = x0; x <= x1; x++) {
+                if (grid.inBounds({x, y}) && grid.isObstacle({x, y})) return false;
+            }
+        }
+        return true;
+    };
+
+    u64 walled = 0;
+    auto count = [&](const std::pair<i32, i32>&) { walled++; };
+
+    for (u64 attempt = 0; walled < cells && attempt < 4 * (u64)cells + 64; attempt++) {
+        i32 length = 4 + (i32)(rng() % (u32)(longest - 3));
+        i32 x = (i32)(rng() % (u32)width);
+        i32 y = (i32)(rng() % (u32)height);
+
+        std::pair<i32, i32> end = {x + length - 1, y};
+        if (rng() & 1) end = {x, y + length - 1};
+
+        if (vacant(x - 1, y - 1, end.first + 1, end.second + 1)) {
+            grid.fillRect({x, y}, end, true, count);
+        }
+    }
+}
+
+void generateMap(
+        short kind,
+        std::pair<i32, i32> size,
+        double density,
+        std::mt19937& rng,
+        Grid& grid,
+        std::pair<i32, i32>& start,
+        std::pair<i32, i32>& target)
+{
+    grid.resize(size.first, size.second);
+    grid.clear();
+    grid.clearCosts();
+
+    start  = {0, 0};
+    target = {size.first - 1, size.second - 1};
+
+    switch (kind) {
+        case MAP_RANDOM:
+            randomMap(grid, density, rng, start, target);
+            break;
+
+        case MAP_MAZE:
+            mazeMap(grid, rng, start, target);
+            break;
+
+        case MAP_ROOMS:
+            roomsMap(grid, rng, start, target);
+            break;
+
+        case MAP_OPEN:
+            openMap(grid, density, rng);
+            break;
+
+        default:
+            throw std::runtime_error("Unknown map kind!");
+    }
+
+    grid.reset(start);
+    grid.reset(target);
+}
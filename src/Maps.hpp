@@ -0,0 +1,39 @@
+#ifndef MAPS_HPP
+#define MAPS_HPP
+
+#include <random>
+#include <string>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+
+enum MapKinds {
+    MAP_RANDOM,     // Every cell blocked with probability 'density'
+    MAP_MAZE,       // Recursive backtracker, one cell wide corridors
+    MAP_ROOMS,      // Rooms on a coarse lattice joined by corridors
+    MAP_OPEN        // Open field, 'density' of it covered by short walls
+};
+
+struct MapInfo {
+    const char* name;   // Accepted by mapByName()
+    short kind;
+};
+
+const std::vector<MapInfo>& mapList();
+
+// Throws std::runtime_error for unknown names
+short mapByName(const std::string& name);
+
+// Resizes 'grid' to 'size' and fills it with a map of 'kind', drawing only
+// from 'rng', so a seed always gives the same map. Sets a start and target
+// that are free, connected if the map allows it and far apart.
+void generateMap(
+        short kind,
+        std::pair<i32, i32> size,
+        double density,
+        std::mt19937& rng,
+        Grid& grid,
+        std::pair<i32, i32>& start,
+        std::pair<i32, i32>& target);
+
+#endif //MAPS_HPP
@@ -0,0 +1,390 @@
+#include <limits>
+#include <tuple>
+
+#include "MemoryBoundedSearch.hpp"
+
+static const std::pair<i32, i32> DIRS[4] = {{-1, 0}, {0, -1}, {1, 0}, {0, 1}};
+
+static inline std::pair<i32, i32> step(const std::pair<i32, i32>& c, i32 d)
+{
+    return {c.first + DIRS[d].first, c.second + DIRS[d].second};
+}
+
+// Cancellation and budget are checked every this many expansions
+static constexpr u64 CHECK_INTERVAL = 1024;
+
+SearchResult IDAStarSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    SearchResult result;
+
+    const auto& start  = query.start;
+    const auto& target = query.target;
+
+    const i64 INF = std::numeric_limits<i64>::max();
+
+    i64 h_scale = grid.minCost();
+    auto h = [&](const std::pair<i32, i32>& s) { return search::manhattan(s, target) * h_scale; };
+
+
+    struct Frame {
+        std::pair<i32, i32> cell;
+        i64 g;
+        i32 next;   // Next direction to try, -1 before the cell was expanded
+    };
+    std::vector<Frame> stack;
+
+    i64 threshold = h(start);
+    while (true) {
+        if (++iteration == 0) {
+            std::fill(table.begin(), table.end(), Entry{0, 0, 0});
+            iteration = 1;
+        }
+
+        i64 next_threshold = INF;
+        u64 iteration_expanded = 0;
+
+        stack.clear();
+        stack.push_back({start, 0, -1});
+
+        while (!stack.empty()) {
+            if (result.expanded % CHECK_INTERVAL == 0) {
+                if ((observer && observer->cancelled())
+                        || (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms)) {
+                    result.timed_out = !(observer && observer->cancelled());
+                    result.elapsed_ms = search::millisSince(t0);
+                    return result;
+                }
+            }
+
+            Frame& top = stack.back();
+
+            if (top.next < 0) {
+                i64 f = top.g + h(top.cell);
+                if (f > threshold) {
+                    next_threshold = std::min(next_threshold, f);
+                    stack.pop_back();
+                    continue;
+                }
+
+                if (top.cell == target) {
+                    result.found = true;
+                    result.cost  = top.g;
+                    for (const auto& frame : stack) {
+                        result.path.push_back(frame.cell);
+                    }
+                    break;
+                }
+
+                // Prune cells already reached as cheaply in this iteration
+                u64 key = (u64)top.cell.second * grid.getWidth() + top.cell.first + 1;
+                Entry& entry = table[(key * 0x9E3779B97F4A7C15ULL >> 17) % table.size()];
+                if (entry.key == key && entry.iteration == iteration && entry.g <= top.g) {
+                    stack.pop_back();
+                    continue;
+                }
+                entry = {key, iteration, top.g};
+
+                top.next = 0;
+                result.expanded++;
+                iteration_expanded++;
+
+                if (observer) observer->onClose(top.cell);
+            }
+
+            if (top.next == 4) {
+                stack.pop_back();
+                continue;
+            }
+
+            auto square = step(top.cell, top.next++);
+            if (grid.isObstacle(square)) continue;
+            if (stack.size() > 1 && square == stack[stack.size() - 2].cell) continue;
+
+            i64 g = top.g + search::stepCost(grid, square);
+            stack.push_back({square, g, -1});
+            result.generated++;
+            result.peak_nodes = std::max(result.peak_nodes, stack.size());
+
+            if (observer) observer->onOpen(square, g + h(square));
+        }
+
+        if (result.found || next_threshold == INF) {
+            break;
+        }
+
+        // Everything expanded so far will be expanded again
+        result.reexpanded += iteration_expanded;
+        threshold = next_threshold;
+    }
+
+    result.peak_nodes += table.size();
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
+
+SearchResult SMAStarSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    SearchResult result;
+
+    const auto& start  = query.start;
+    const auto& target = query.target;
+
+    // Values of Node::forgotten besides the f of a dropped child
+    const i64 INF    = std::numeric_limits<i64>::max() / 4;
+    const i64 UNSEEN = -1;  // Never generated
+    const i64 NONE   = -2;  // Blocked, or the way back to the parent
+
+    pool.reset();
+    free_nodes.clear();
+    cheapest.reset((size_t)grid.getWidth() * grid.getHeight());
+    seen.reset((size_t)grid.getWidth() * grid.getHeight());
+    auto index = [&](const std::pair<i32, i32>& c) { return (size_t)c.second * grid.getWidth() + c.first; };
+
+    // Best node first (lowest f, deepest); worst leaf last (highest f, shallowest)
+    typedef std::tuple<i64, i32, i32> Key;
+    std::set<Key> open;
+    std::set<Key> leaves;
+
+    auto key = [&](i32 i) { return Key(pool[i].f, -pool[i].depth, i); };
+
+    auto setOpen = [&](i32 i, bool in) {
+        if (pool[i].in_open == in) return;
+        if (in) open.insert(key(i));
+        else open.erase(key(i));
+        pool[i].in_open = in;
+    };
+
+    auto setLeaf = [&](i32 i, bool leaf) {
+        if (pool[i].is_leaf == leaf) return;
+        if (leaf) leaves.insert(key(i));
+        else leaves.erase(key(i));
+        pool[i].is_leaf = leaf;
+    };
+
+    auto setF = [&](i32 i, i64 f) {
+        bool in_open = pool[i].in_open, is_leaf = pool[i].is_leaf;
+        setOpen(i, false);
+        setLeaf(i, false);
+        pool[i].f = f;
+        setOpen(i, in_open);
+        setLeaf(i, is_leaf);
+    };
+
+    // A direction is pending if its child is not in memory but may still
+    // lead somewhere
+    auto pending = [&](i32 i) {
+        const Node& n = pool[i];
+        for (i32 d = 0; d < 4; d++) {
+            if (n.child[d] < 0 && n.forgotten[d] != NONE && n.forgotten[d] < INF) return true;
+        }
+        return false;
+    };
+
+    auto allSeen = [&](i32 i) {
+        for (i32 d = 0; d < 4; d++) {
+            if (pool[i].child[d] < 0 && pool[i].forgotten[d] == UNSEEN) return false;
+        }
+        return true;
+    };
+
+    auto allocate = [&](const std::pair<i32, i32>& cell, i32 parent) {
+        i32 i;
+        if (!free_nodes.empty()) {
+            i = free_nodes.back();
+            free_nodes.pop_back();
+        } else {
+            i = pool.allocate();
+        }
+
+        Node& n = pool[i];
+        n.cell = cell;
+        n.parent = parent;
+        n.depth = parent < 0 ? 0 : pool[parent].depth + 1;
+        n.in_memory = 0;
+        n.in_open = n.is_leaf = false;
+
+        for (i32 d = 0; d < 4; d++) {
+            auto s = step(cell, d);
+            bool back = parent >= 0 && s == pool[parent].cell;
+            n.child[d] = -1;
+            n.forgotten[d] = grid.isObstacle(s) || back ? NONE : UNSEEN;
+        }
+
+        return i;
+    };
+
+    // Pushes out the worst leaf except 'keep', returns false if there is none
+    auto evict = [&](i32 keep) {
+        for (auto it = leaves.rbegin(); it != leaves.rend(); ++it) {
+            i32 i = std::get<2>(*it);
+            if (i == keep || pool[i].parent < 0) continue;
+
+            i32 p = pool[i].parent;
+            for (i32 d = 0; d < 4; d++) {
+                if (pool[p].child[d] == i) {
+                    pool[p].child[d] = -1;
+                    pool[p].forgotten[d] = pool[i].f;
+                }
+            }
+
+            if (--pool[p].in_memory == 0) setLeaf(p, true);
+            if (pending(p)) setOpen(p, true);
+
+            setOpen(i, false);
+            setLeaf(i, false);
+            free_nodes.push_back(i);
+
+            if (cheapest.get(index(pool[i].cell), -1) == i) cheapest.set(index(pool[i].cell), -1);
+
+            if (observer) observer->onDrop(pool[i].cell);
+            return true;
+        }
+
+        return false;
+    };
+
+    // Once every successor of 'i' was seen, its f is the best of theirs
+    auto backup = [&](i32 i) {
+        while (i >= 0 && allSeen(i)) {
+            i64 best = INF;
+            for (i32 d = 0; d < 4; d++) {
+                const Node& n = pool[i];
+                if (n.child[d] >= 0) best = std::min(best, pool[n.child[d]].f);
+                else if (n.forgotten[d] != NONE) best = std::min(best, n.forgotten[d]);
+            }
+
+            if (best == pool[i].f) break;
+
+            setF(i, best);
+            i = pool[i].parent;
+        }
+    };
+
+    i64 h_scale = grid.minCost();
+    auto h = [&](const std::pair<i32, i32>& s) { return search::manhattan(s, target) * h_scale; };
+
+    i32 root = allocate(start, -1);
+    pool[root].g = 0;
+    pool[root].f = h(start);
+    setOpen(root, true);
+    setLeaf(root, true);
+    cheapest.set(index(start), root);
+    seen.set(index(start), 1);
+
+    size_t live = 1;
+    result.peak_nodes = 1;
+
+    while (true) {
+        if (result.expanded % CHECK_INTERVAL == 0) {
+            if (observer && observer->cancelled()) break;
+            if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+                result.timed_out = true;
+                break;
+            }
+        }
+
+        // Nothing left, or nothing that fits into memory
+        if (open.empty() || std::get<0>(*open.begin()) >= INF) break;
+
+        i32 b = std::get<2>(*open.begin());
+
+        if (pool[b].cell == target) {
+            result.found = true;
+            result.cost  = pool[b].g;
+            for (i32 i = b; i >= 0; i = pool[i].parent) {
+                result.path.push_back(pool[i].cell);
+            }
+            std::reverse(result.path.begin(), result.path.end());
+            break;
+        }
+
+        result.expanded++;
+        if (observer) observer->onClose(pool[b].cell);
+
+        // Unseen successors first, then the most promising forgotten one
+        i32 d = -1;
+        for (i32 k = 0; k < 4 && d < 0; k++) {
+            if (pool[b].child[k] < 0 && pool[b].forgotten[k] == UNSEEN) d = k;
+        }
+        bool regenerate = d < 0;
+        for (i32 k = 0; k < 4 && regenerate; k++) {
+            i64 v = pool[b].forgotten[k];
+            if (pool[b].child[k] < 0 && v != NONE && v < INF && (d < 0 || v < pool[b].forgotten[d])) d = k;
+        }
+
+        if (d < 0) {
+            setOpen(b, false);
+            continue;
+        }
+
+        auto cell = step(pool[b].cell, d);
+        i64 g = pool[b].g + search::stepCost(grid, cell);
+
+        // A cell held at most as cheaply elsewhere is covered by that node,
+        // even after it is dropped its parent remembers it
+        i32 known = cheapest.get(index(cell), -1);
+        if (known >= 0 && pool[known].g <= g) {
+            pool[b].forgotten[d] = INF;
+            if (!pending(b)) setOpen(b, false);
+            backup(b);
+            continue;
+        }
+
+        if (live >= node_cap) {
+            if (!evict(b)) {
+                // Not even one more node fits, give this direction up
+                pool[b].forgotten[d] = INF;
+                if (!pending(b)) setOpen(b, false);
+                backup(b);
+                continue;
+            }
+            live--;
+        }
+
+        i32 s = allocate(cell, b);
+        live++;
+        result.peak_nodes = std::max(result.peak_nodes, live);
+        cheapest.set(index(cell), s);
+
+        Node& n = pool[s];
+        n.g = g;
+        n.f = std::max(pool[b].f, n.g + h(cell));
+        if (regenerate) n.f = std::max(n.f, pool[b].forgotten[d]);
+
+        // A path longer than memory can never be completed
+        bool dead_end = cell != target && !pending(s);
+        if ((cell != target && (size_t)n.depth >= node_cap - 1) || dead_end) {
+            n.f = INF;
+        }
+
+        pool[b].child[d] = s;
+        pool[b].in_memory++;
+        setLeaf(b, false);
+
+        setLeaf(s, true);
+        if (cell == target || pending(s)) setOpen(s, true);
+
+        result.generated++;
+        if (seen.has(index(cell))) result.reexpanded++;
+        seen.set(index(cell), 1);
+        if (observer) observer->onOpen(cell, n.f);
+
+        if (!pending(b)) setOpen(b, false);
+        backup(b);
+    }
+
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
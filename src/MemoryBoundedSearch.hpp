@@ -0,0 +1,88 @@
+#ifndef MEMORY_BOUNDED_SEARCH_HPP
+#define MEMORY_BOUNDED_SEARCH_HPP
+
+#include "Search.hpp"
+#include "Arena.hpp"
+
+// Iterative deepening A* (Korf 1985).
+//
+// Depth-first searches with a growing f-threshold, so memory is the current
+// path plus a transposition table of fixed size. The table remembers the
+// smallest g a cell was reached with in the current iteration and prunes
+// worse duplicates; a collision simply overwrites the old entry. All work of
+// earlier iterations is repeated and reported as 'reexpanded'.
+class IDAStarSearch : public SearchEngine {
+
+    private:
+        struct Entry {
+            u64 key;    // Cell index + 1, 0 if empty
+            u32 iteration;
+            i64 g;
+        };
+
+        // Entries stamped with an older iteration, of this search or an
+        // earlier one, are empty, so the table is never cleared
+        std::vector<Entry> table;
+        u32 iteration = 0;
+
+    public:
+        IDAStarSearch(size_t table_size = 1 << 16) : table(std::max<size_t>(table_size, 1)) {}
+
+        const char* getName() const override { return "IDA*"; }
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+// Simplified memory-bounded A* (Russell 1992).
+//
+// Behaves like A* until 'node_cap' nodes are in memory. After that, every
+// new node first pushes out the shallowest leaf with the highest f-value.
+// The parent keeps the f-value of the dropped subtree and regenerates it
+// once it becomes the most promising again. Cells generated more than once
+// are reported as 'reexpanded'. Finds the optimal path if that path fits
+// into 'node_cap' nodes.
+class SMAStarSearch : public SearchEngine {
+
+    private:
+        struct Node {
+            std::pair<i32, i32> cell;
+            i64 g;
+            i64 f;
+            i32 parent;
+            i32 depth;
+            i32 child[4];
+            i64 forgotten[4];
+            i32 in_memory;
+            bool in_open;
+            bool is_leaf;
+        };
+
+        size_t node_cap;
+
+        // Scratch kept between searches, reset in O(1)
+        Pool<Node> pool;
+        std::vector<i32> free_nodes;
+
+        // Cheapest node of every cell in memory. Grids have many equally good
+        // paths to a cell, without this the tree would hold all of them.
+        StampedArray<i32> cheapest;
+
+        // Set once a cell was generated. Generating it again is work
+        // repeated because memory ran out.
+        StampedArray<u8> seen;
+
+    public:
+        SMAStarSearch(size_t node_cap = 1 << 16) : node_cap(std::max<size_t>(node_cap, 2)) {}
+
+        const char* getName() const override { return "SMA*"; }
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+#endif //MEMORY_BOUNDED_SEARCH_HPP
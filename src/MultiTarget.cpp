@@ -0,0 +1,321 @@
+#include <climits>
+#include <cmath>
+
+#include "MultiTarget.hpp"
+
+void GoalIndex::build(const std::vector<std::pair<i32, i32>>& targets, i32 width, i32 height)
+{
+    cells.clear();
+    ids.clear();
+
+    std::vector<i32> inside;
+    for (i32 k = 0; k < (i32)targets.size(); k++) {
+        auto [x, y] = targets[k];
+        if (x >= 0 && y >= 0 && x < width && y < height) inside.push_back(k);
+    }
+
+    // About one target per bucket
+    double area = (double)std::max(width, 1) * std::max(height, 1);
+    bucket_size = std::max(1, (i32)std::sqrt(area / std::max<size_t>(inside.size(), 1)));
+    columns = (std::max(width, 1) + bucket_size - 1) / bucket_size;
+    rows    = (std::max(height, 1) + bucket_size - 1) / bucket_size;
+
+    auto bucket = [&](const std::pair<i32, i32>& cell) {
+        return (cell.second / bucket_size) * columns + cell.first / bucket_size;
+    };
+
+    // Counting sort by bucket
+    first.assign((size_t)columns * rows + 1, 0);
+    for (i32 k : inside) first[bucket(targets[k]) + 1]++;
+    for (size_t b = 1; b < first.size(); b++) first[b] += first[b - 1];
+
+    cells.resize(inside.size());
+    ids.resize(inside.size());
+
+    std::vector<u32> at(first.begin(), first.end() - 1);
+    for (i32 k : inside) {
+        u32 slot = at[bucket(targets[k])]++;
+        cells[slot] = targets[k];
+        ids[slot] = k;
+    }
+}
+
+i32 GoalIndex::nearest(const std::pair<i32, i32>& cell, i32* which) const
+{
+    if (cells.empty()) return -1;
+
+    i32 bx = std::min(std::max(cell.first  / bucket_size, 0), columns - 1);
+    i32 by = std::min(std::max(cell.second / bucket_size, 0), rows - 1);
+
+    i32 best = INT_MAX, best_id = -1;
+    auto scan = [&](i32 x, i32 y) {
+        if (x < 0 || y < 0 || x >= columns || y >= rows) return;
+
+        size_t b = (size_t)y * columns + x;
+        for (u32 k = first[b]; k < first[b + 1]; k++) {
+            i32 d = abs(cells[k].first - cell.first) + abs(cells[k].second - cell.second);
+            if (d < best) {
+                best = d;
+                best_id = ids[k];
+            }
+        }
+    };
+
+    // A target in ring r is at least (r - 1) buckets and one cell away
+    i32 rings = std::max(columns, rows);
+    for (i32 r = 0; r <= rings; r++) {
+        if (r > 0 && best <= (r - 1) * bucket_size + 1) break;
+
+        if (r == 0) {
+            scan(bx, by);
+            continue;
+        }
+
+        for (i32 x = bx - r; x <= bx + r; x++) {
+            scan(x, by - r);
+            scan(x, by + r);
+        }
+        for (i32 y = by - r + 1; y < by + r; y++) {
+            scan(bx - r, y);
+            scan(bx + r, y);
+        }
+    }
+
+    if (which) *which = best_id;
+    return best;
+}
+
+i32 MultiTargetSearch::markTargets(const Grid& grid, const std::vector<std::pair<i32, i32>>& targets)
+{
+    i32 width = grid.getWidth();
+
+    goal_at.reset((size_t)width * grid.getHeight());
+    next_goal.assign(targets.size(), -1);
+
+    // Walked backwards, so every chain lists its targets in query order
+    i32 count = 0;
+    for (i32 k = (i32)targets.size() - 1; k >= 0; k--) {
+        const auto& cell = targets[k];
+        if (!grid.inBounds(cell) || grid.isObstacle(cell)) continue;
+
+        size_t slot = (size_t)cell.second * width + cell.first;
+        next_goal[k] = goal_at.get(slot, -1);
+        goal_at.set(slot, k);
+        count++;
+    }
+
+    return count;
+}
+
+void MultiTargetSearch::retrace(i32 slot, i32 width, std::vector<std::pair<i32, i32>>& path) const
+{
+    path.clear();
+    for (i32 i = slot; i >= 0; i = nodes[i].parent) {
+        path.push_back({i % width, i / width});
+    }
+    std::reverse(path.begin(), path.end());
+}
+
+SearchResult MultiTargetSearch::nearest(
+        const Grid& grid,
+        const MultiTargetQuery& query,
+        i32& reached,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    SearchResult result;
+    result.epsilon = weight + TIE_BREAKER;
+    reached = -1;
+
+    const auto& start = query.start;
+    i32 width = grid.getWidth();
+
+    if (!grid.inBounds(start) || markTargets(grid, query.targets) == 0) {
+        result.elapsed_ms = search::millisSince(t0);
+        return result;
+    }
+
+    // Blocked targets are never reached, they would only weaken the estimate
+    std::vector<std::pair<i32, i32>> free_targets = query.targets;
+    for (auto& cell : free_targets) {
+        if (grid.inBounds(cell) && grid.isObstacle(cell)) cell = {-1, -1};
+    }
+    index.build(free_targets, width, grid.getHeight());
+
+    nodes.reset((size_t)width * grid.getHeight());
+    openHeap.clear();
+
+    auto later = std::greater<std::pair<i64, i32>>();
+
+    double h_scale = grid.minCost() * (weight + TIE_BREAKER);
+    auto heuristic = [&](const std::pair<i32, i32>& cell) {
+        return (i64)(STEP_COST * (i64)index.nearest(cell) * h_scale);
+    };
+
+    i32 s = start.second * width + start.first;
+    nodes.set(s, {0, heuristic(start), -1, false});
+    openHeap.push_back({nodes[s].f, s});
+    size_t touched = 1;
+
+    while (!openHeap.empty()) {
+        if (observer && observer->cancelled()) break;
+
+        if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+            result.timed_out = true;
+            break;
+        }
+
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [f, i] = openHeap.back();
+        openHeap.pop_back();
+
+        Node& node = nodes[i];
+        if (node.closed || node.f != f) continue;
+
+        node.closed = true;
+        result.expanded++;
+
+        std::pair<i32, i32> current = {i % width, i / width};
+        if (observer) observer->onClose(current);
+
+        if (goal_at.has(i)) {
+            reached = goal_at[i];
+            result.found = true;
+            result.cost  = node.g;
+            retrace(i, width, result.path);
+            break;
+        }
+
+        // The estimate of a cell never changes, only its g does
+        i64 g = node.g;
+        search::adjacentSquares(grid, current, adjacentSquares);
+        for (const auto& square : adjacentSquares) {
+            i32 j = square.second * width + square.first;
+            i64 new_gScore = g + search::stepCost(grid, square);
+
+            i64 h;
+            if (nodes.has(j)) {
+                if (nodes[j].closed || new_gScore >= nodes[j].g) continue;
+                h = nodes[j].f - nodes[j].g;
+            } else {
+                h = heuristic(square);
+                touched++;
+            }
+
+            i64 new_fScore = new_gScore + h;
+            nodes.set(j, {new_gScore, new_fScore, i, false});
+
+            openHeap.push_back({new_fScore, j});
+            std::push_heap(openHeap.begin(), openHeap.end(), later);
+            result.generated++;
+
+            if (observer) observer->onOpen(square, new_fScore);
+        }
+    }
+
+    result.peak_nodes = touched;
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
+
+std::vector<SearchResult> MultiTargetSearch::all(
+        const Grid& grid,
+        const MultiTargetQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    std::vector<SearchResult> results(query.targets.size());
+
+    const auto& start = query.start;
+    i32 width = grid.getWidth();
+
+    i32 left = grid.inBounds(start) ? markTargets(grid, query.targets) : 0;
+
+    nodes.reset((size_t)width * grid.getHeight());
+    openHeap.clear();
+
+    auto later = std::greater<std::pair<i64, i32>>();
+
+    size_t touched = 0;
+    u64 expanded = 0, generated = 0;
+    bool timed_out = false;
+
+    if (left > 0) {
+        i32 s = start.second * width + start.first;
+        nodes.set(s, {0, 0, -1, false});
+        openHeap.push_back({0, s});
+        touched = 1;
+    }
+
+    while (left > 0 && !openHeap.empty()) {
+        if (observer && observer->cancelled()) break;
+
+        if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+            timed_out = true;
+            break;
+        }
+
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [g, i] = openHeap.back();
+        openHeap.pop_back();
+
+        Node& node = nodes[i];
+        if (node.closed || node.g != g) continue;
+
+        node.closed = true;
+        expanded++;
+
+        std::pair<i32, i32> current = {i % width, i / width};
+        if (observer) observer->onClose(current);
+
+        // Every target on this cell is done, they share the path
+        if (goal_at.has(i)) {
+            for (i32 k = goal_at[i]; k >= 0; k = next_goal[k], left--) {
+                SearchResult& result = results[k];
+                result.found = true;
+                result.cost  = g;
+                result.expanded  = expanded;
+                result.generated = generated;
+                result.peak_nodes = touched;
+                result.elapsed_ms = search::millisSince(t0);
+                retrace(i, width, result.path);
+            }
+        }
+
+        search::adjacentSquares(grid, current, adjacentSquares);
+        for (const auto& square : adjacentSquares) {
+            i32 j = square.second * width + square.first;
+            i64 new_gScore = g + search::stepCost(grid, square);
+
+            if (nodes.has(j)) {
+                if (nodes[j].closed || new_gScore >= nodes[j].g) continue;
+            } else {
+                touched++;
+            }
+
+            nodes.set(j, {new_gScore, new_gScore, i, false});
+
+            openHeap.push_back({new_gScore, j});
+            std::push_heap(openHeap.begin(), openHeap.end(), later);
+            generated++;
+
+            if (observer) observer->onOpen(square, new_gScore);
+        }
+    }
+
+    double elapsed_ms = search::millisSince(t0);
+    for (auto& result : results) {
+        if (result.found) continue;
+
+        result.timed_out  = timed_out;
+        result.expanded   = expanded;
+        result.generated  = generated;
+        result.peak_nodes = touched;
+        result.elapsed_ms = elapsed_ms;
+    }
+
+    return results;
+}
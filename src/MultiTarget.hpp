@@ -0,0 +1,105 @@
+#ifndef MULTI_TARGET_HPP
+#define MULTI_TARGET_HPP
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Arena.hpp"
+#include "Search.hpp"
+
+struct MultiTargetQuery {
+    std::pair<i32, i32> start;
+    std::vector<std::pair<i32, i32>> targets;
+
+    double budget_ms = 0.0;     // 0 means no deadline
+};
+
+// Targets binned into the square buckets of a coarse grid, about one target
+// per bucket. The nearest target to a cell is found by scanning the buckets
+// around it ring by ring, until no ring further out can hold a closer one.
+class GoalIndex {
+
+    private:
+        i32 bucket_size = 1;
+        i32 columns = 0;
+        i32 rows    = 0;
+
+        // Targets sorted by bucket, those of bucket b are [first[b], first[b + 1])
+        std::vector<u32> first;
+        std::vector<std::pair<i32, i32>> cells;
+        std::vector<i32> ids;       // Index of each target in the query
+
+    public:
+        GoalIndex() {}
+
+        // Indexes the targets that lie inside a width x height grid
+        void build(const std::vector<std::pair<i32, i32>>& targets, i32 width, i32 height);
+
+        // Manhattan distance in cells to the nearest target, -1 without any.
+        // Its index goes to 'which' if given.
+        i32 nearest(const std::pair<i32, i32>& cell, i32* which = nullptr) const;
+
+        inline bool empty() const { return cells.empty(); }
+
+};
+
+// Searches from one start to many targets on the 4-connected grid, both
+// over a single expansion instead of one search per target:
+//
+// nearest() is A* towards whichever target is closest, guided by the
+// distance to the nearest target, a minimum of admissible heuristics. As in
+// AStarSearch it is inflated by the weight and the tie breaker, so the
+// path's cost is at most the reported epsilon times the optimum. A GoalIndex
+// answers it for every generated cell.
+//
+// all() is Dijkstra that runs until every target is closed, and retraces a
+// path to each from the shared tree.
+class MultiTargetSearch {
+
+    private:
+        static constexpr double TIE_BREAKER = 0.1;     // As in AStarSearch
+
+        double weight;
+
+        struct Node {
+            i64 g;
+            i64 f;
+            i32 parent;     // Row-major slot, -1 for the start
+            bool closed;
+        };
+
+        StampedArray<Node> nodes;
+        std::vector<std::pair<i64, i32>> openHeap;
+        std::vector<std::pair<i32, i32>> adjacentSquares;
+
+        // Targets on a cell: the first in 'goal_at', the rest chained
+        // through 'next_goal', in query order
+        StampedArray<i32> goal_at;
+        std::vector<i32> next_goal;
+
+        GoalIndex index;
+
+        // Returns the number of targets that are free cells of 'grid'
+        i32 markTargets(const Grid& grid, const std::vector<std::pair<i32, i32>>& targets);
+        void retrace(i32 slot, i32 width, std::vector<std::pair<i32, i32>>& path) const;
+
+    public:
+        MultiTargetSearch(double weight = 1.0) : weight(weight) {}
+
+        // Path to the closest target, whose index goes to 'reached', -1 if
+        // none was reached
+        SearchResult nearest(
+                const Grid& grid,
+                const MultiTargetQuery& query,
+                i32& reached,
+                SearchObserver* observer = nullptr);
+
+        // One result per target, in query order. The statistics of each are
+        // those of the shared expansion at the time its target was closed.
+        std::vector<SearchResult> all(
+                const Grid& grid,
+                const MultiTargetQuery& query,
+                SearchObserver* observer = nullptr);
+
+};
+
+#endif //MULTI_TARGET_HPP
@@ -0,0 +1,287 @@
+#include "NeighbourKernel.hpp"
+
+#include <climits>
+
+#include "PaddedGrid.hpp"
+#include "PaddedSearch.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NEIGHBOUR_KERNEL_X86
+#include <immintrin.h>
+#endif
+
+// The 3x3 block around a cell is read as a 9 bit pattern, the row above in
+// bits 0-2, the cell's own row in bits 3-5 and the row below in bits 6-8,
+// west to east. Two tables turn a pattern into a direction mask: the
+// neighbours that are open, and the diagonals that cut no corner.
+struct NeighbourTables {
+    u8 open[512];
+    u8 corners[512];
+};
+
+static constexpr i32 bitOf(i32 d)
+{
+    return (PaddedGrid::STEPS[d].second + 1) * 3 + PaddedGrid::STEPS[d].first + 1;
+}
+
+static constexpr NeighbourTables buildTables()
+{
+    NeighbourTables tables = {};
+    for (i32 pattern = 0; pattern < 512; pattern++) {
+        u8 open = 0, corners = 0x0f;
+        for (i32 d = 0; d < PaddedGrid::DIRECTIONS; d++) {
+            if (!(pattern >> bitOf(d) & 1)) open |= 1 << d;
+            if (d >= 4 && !(pattern >> bitOf(PaddedGrid::SIDES[d][0]) & 1)
+                    && !(pattern >> bitOf(PaddedGrid::SIDES[d][1]) & 1)) {
+                corners |= 1 << d;
+            }
+        }
+        tables.open[pattern] = open;
+        tables.corners[pattern] = corners;
+    }
+    return tables;
+}
+
+static constexpr NeighbourTables TABLES = buildTables();
+
+static constexpr i32 STEP_COSTS[8] = {
+    STEP_COST, STEP_COST, STEP_COST, STEP_COST,
+    DIAGONAL_COST, DIAGONAL_COST, DIAGONAL_COST, DIAGONAL_COST
+};
+
+// Three bits starting at bit 'at'
+static inline u32 bits3(const u64* bits, size_t at)
+{
+    size_t w = at >> 6, shift = at & 63;
+    u64 v = bits[w] >> shift;
+    if (shift > 61) v |= bits[w + 1] << (64 - shift);
+    return v & 7;
+}
+
+static inline u32 pattern(const u64* bits, i32 i, i32 pitch)
+{
+    size_t at = (size_t)i - 1;
+    return bits3(bits, at - pitch) | bits3(bits, at) << 3 | bits3(bits, at + pitch) << 6;
+}
+
+// Directions that are open and cut no corner, before any g score is known
+static inline u32 candidates(const NeighbourContext& context, i32 i)
+{
+    i32 pitch = context.offsets[3];     // South is a row down
+    u32 mask = TABLES.open[pattern(context.done, i, pitch)];
+    if (context.directions == 8) return mask & TABLES.corners[pattern(context.walls, i, pitch)];
+    return mask & 0x0f;
+}
+
+static u32 scalarKernel(const NeighbourContext& context,
+        i32 i, i32 x, i32 y, i64 g, NeighbourBatch& out)
+{
+    u32 mask = candidates(context, i);
+
+    for (u32 left = mask; left; left &= left - 1) {
+        i32 d = __builtin_ctz(left);
+        i32 j = i + context.offsets[d];
+
+        i64 new_g = g + STEP_COSTS[d] * (i64)(context.costs ? context.costs[j] : 1);
+        if (context.stamps[j] == context.generation
+                && new_g >= context.g_slots[(size_t)j * context.g_stride]) {
+            mask &= ~(1u << d);
+            continue;
+        }
+
+        i32 dx = abs(x + PaddedGrid::STEPS[d].first - context.target_x);
+        i32 dy = abs(y + PaddedGrid::STEPS[d].second - context.target_y);
+        i64 h = STEP_COST * (i64)(dx + dy);
+        if (context.directions == 8) h += (DIAGONAL_COST - 2 * STEP_COST) * (i64)std::min(dx, dy);
+
+        out.g[d] = new_g;
+        out.f[d] = new_g + (i64)(h * context.h_scale);
+    }
+
+    return mask;
+}
+
+#ifdef NEIGHBOUR_KERNEL_X86
+
+// Four directions per register: the scores of the four straight
+// neighbours, then those of the diagonals. The per-neighbour loads are
+// scalar, SSE has no gathers.
+__attribute__((target("sse4.2")))
+static u32 sse4Kernel(const NeighbourContext& context,
+        i32 i, i32 x, i32 y, i64 g, NeighbourBatch& out)
+{
+    u32 mask = candidates(context, i);
+    if (!mask) return 0;
+
+    alignas(16) i32 cost[8];
+    alignas(16) i64 seen[8], old[8];
+    for (i32 d = 0; d < context.directions; d++) {
+        i32 j = i + context.offsets[d];
+        cost[d] = context.costs ? context.costs[j] : 1;
+        seen[d] = context.stamps[j] == context.generation ? -1 : 0;
+        old[d]  = context.g_slots[(size_t)j * context.g_stride];
+    }
+
+    __m128i gs = _mm_set1_epi64x(g);
+    __m128i rel_x = _mm_set1_epi32(x - context.target_x);
+    __m128i rel_y = _mm_set1_epi32(y - context.target_y);
+    __m128d scale = _mm_set1_pd(context.h_scale);
+
+    u32 rejected = 0;
+    for (i32 d = 0; d < context.directions; d += 4) {
+        __m128i step = _mm_mullo_epi32(_mm_loadu_si128((const __m128i*)(STEP_COSTS + d)),
+                _mm_load_si128((const __m128i*)(cost + d)));
+
+        __m128i sx = d == 0 ? _mm_setr_epi32(-1, 0, 1, 0) : _mm_setr_epi32(-1, 1, -1, 1);
+        __m128i sy = d == 0 ? _mm_setr_epi32(0, -1, 0, 1) : _mm_setr_epi32(-1, -1, 1, 1);
+        __m128i dx = _mm_abs_epi32(_mm_add_epi32(rel_x, sx));
+        __m128i dy = _mm_abs_epi32(_mm_add_epi32(rel_y, sy));
+        __m128i h = _mm_mullo_epi32(_mm_add_epi32(dx, dy), _mm_set1_epi32(STEP_COST));
+        if (context.directions == 8) {
+            h = _mm_add_epi32(h, _mm_mullo_epi32(_mm_min_epi32(dx, dy),
+                        _mm_set1_epi32(DIAGONAL_COST - 2 * STEP_COST)));
+        }
+
+        __m128i h_lo = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(h), scale));
+        __m128i h_hi = _mm_cvttpd_epi32(_mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(h, h)), scale));
+        __m128i new_g[2] = {
+            _mm_add_epi64(gs, _mm_cvtepi32_epi64(step)),
+            _mm_add_epi64(gs, _mm_cvtepi32_epi64(_mm_unpackhi_epi64(step, step)))
+        };
+        __m128i f[2] = {
+            _mm_add_epi64(new_g[0], _mm_cvtepi32_epi64(h_lo)),
+            _mm_add_epi64(new_g[1], _mm_cvtepi32_epi64(h_hi))
+        };
+
+        for (i32 k = 0; k < 2; k++) {
+            i32 at = d + 2 * k;
+
+            // Known with a g score no worse than the new one
+            __m128i worse = _mm_andnot_si128(
+                    _mm_cmpgt_epi64(_mm_load_si128((const __m128i*)(old + at)), new_g[k]),
+                    _mm_load_si128((const __m128i*)(seen + at)));
+            rejected |= (u32)_mm_movemask_pd(_mm_castsi128_pd(worse)) << at;
+
+            _mm_store_si128((__m128i*)(out.g + at), new_g[k]);
+            _mm_store_si128((__m128i*)(out.f + at), f[k]);
+        }
+    }
+
+    return mask & ~rejected;
+}
+
+// All eight directions in one register of 32 bit lanes, widened to two of
+// 64 bit lanes for the scores. Costs, stamps and g scores are gathered.
+__attribute__((target("avx2")))
+static u32 avx2Kernel(const NeighbourContext& context,
+        i32 i, i32 x, i32 y, i64 g, NeighbourBatch& out)
+{
+    u32 mask = candidates(context, i);
+    if (!mask) return 0;
+
+    __m256i j = _mm256_add_epi32(_mm256_set1_epi32(i),
+            _mm256_loadu_si256((const __m256i*)context.offsets));
+
+    __m256i step = _mm256_loadu_si256((const __m256i*)STEP_COSTS);
+    if (context.costs) {
+        __m256i cost = _mm256_i32gather_epi32((const int*)context.costs, j, 1);
+        step = _mm256_mullo_epi32(step, _mm256_and_si256(cost, _mm256_set1_epi32(0xff)));
+    }
+
+    __m256i gs = _mm256_set1_epi64x(g);
+    __m256i g_lo = _mm256_add_epi64(gs, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(step)));
+    __m256i g_hi = _mm256_add_epi64(gs, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(step, 1)));
+
+    __m256i seen = _mm256_cmpeq_epi32(_mm256_i32gather_epi32((const int*)context.stamps, j, 4),
+            _mm256_set1_epi32((i32)context.generation));
+    __m256i slot = _mm256_mullo_epi32(j, _mm256_set1_epi32(context.g_stride));
+    __m256i old_lo = _mm256_i32gather_epi64((const long long*)context.g_slots,
+            _mm256_castsi256_si128(slot), 8);
+    __m256i old_hi = _mm256_i32gather_epi64((const long long*)context.g_slots,
+            _mm256_extracti128_si256(slot, 1), 8);
+
+    // Known with a g score no worse than the new one
+    __m256i worse_lo = _mm256_andnot_si256(_mm256_cmpgt_epi64(old_lo, g_lo),
+            _mm256_cvtepi32_epi64(_mm256_castsi256_si128(seen)));
+    __m256i worse_hi = _mm256_andnot_si256(_mm256_cmpgt_epi64(old_hi, g_hi),
+            _mm256_cvtepi32_epi64(_mm256_extracti128_si256(seen, 1)));
+    u32 rejected = (u32)_mm256_movemask_pd(_mm256_castsi256_pd(worse_lo))
+            | (u32)_mm256_movemask_pd(_mm256_castsi256_pd(worse_hi)) << 4;
+
+    __m256i dx = _mm256_abs_epi32(_mm256_add_epi32(_mm256_set1_epi32(x - context.target_x),
+                _mm256_setr_epi32(-1, 0, 1, 0, -1, 1, -1, 1)));
+    __m256i dy = _mm256_abs_epi32(_mm256_add_epi32(_mm256_set1_epi32(y - context.target_y),
+                _mm256_setr_epi32(0, -1, 0, 1, -1, -1, 1, 1)));
+    __m256i h = _mm256_mullo_epi32(_mm256_add_epi32(dx, dy), _mm256_set1_epi32(STEP_COST));
+    if (context.directions == 8) {
+        h = _mm256_add_epi32(h, _mm256_mullo_epi32(_mm256_min_epi32(dx, dy),
+                    _mm256_set1_epi32(DIAGONAL_COST - 2 * STEP_COST)));
+    }
+
+    __m256d scale = _mm256_set1_pd(context.h_scale);
+    __m128i h_lo = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(h)), scale));
+    __m128i h_hi = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(h, 1)), scale));
+
+    _mm256_store_si256((__m256i*)out.g, g_lo);
+    _mm256_store_si256((__m256i*)(out.g + 4), g_hi);
+    _mm256_store_si256((__m256i*)out.f, _mm256_add_epi64(g_lo, _mm256_cvtepi32_epi64(h_lo)));
+    _mm256_store_si256((__m256i*)(out.f + 4), _mm256_add_epi64(g_hi, _mm256_cvtepi32_epi64(h_hi)));
+
+    return mask & ~rejected;
+}
+
+#endif
+
+static bool supported(KernelKind kind)
+{
+    switch (kind) {
+        case KERNEL_SCALAR:
+            return true;
+#ifdef NEIGHBOUR_KERNEL_X86
+        case KERNEL_SSE4:
+            return __builtin_cpu_supports("sse4.2");
+        case KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+KernelKind kernel::resolve(KernelKind kind)
+{
+    if (kind != KERNEL_AUTO && supported(kind)) return kind;
+    if (supported(KERNEL_AVX2)) return KERNEL_AVX2;
+    if (supported(KERNEL_SSE4)) return KERNEL_SSE4;
+    return KERNEL_SCALAR;
+}
+
+NeighbourKernel kernel::get(KernelKind kind)
+{
+    switch (resolve(kind)) {
+#ifdef NEIGHBOUR_KERNEL_X86
+        case KERNEL_AVX2: return avx2Kernel;
+        case KERNEL_SSE4: return sse4Kernel;
+#endif
+        default:          return scalarKernel;
+    }
+}
+
+const char* kernel::name(KernelKind kind)
+{
+    switch (kind) {
+        case KERNEL_AUTO:   return "auto";
+        case KERNEL_SCALAR: return "scalar";
+        case KERNEL_SSE4:   return "sse4";
+        case KERNEL_AVX2:   return "avx2";
+    }
+    return "unknown";
+}
+
+bool kernel::fitsVector(const NeighbourContext& context, i32 width, i32 height)
+{
+    // Gather indices are 32 bit, and so is the scaled heuristic
+    double slots = (double)(width + 2) * (height + 2) * context.g_stride;
+    double h = (double)STEP_COST * (width + height + 2) * context.h_scale;
+    return slots < INT_MAX && h < INT_MAX;
+}
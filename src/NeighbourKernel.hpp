@@ -0,0 +1,64 @@
+#ifndef NEIGHBOUR_KERNEL_HPP
+#define NEIGHBOUR_KERNEL_HPP
+
+#include "Util.hpp"
+
+// Implementations of the neighbour kernel, in order of preference
+enum KernelKind {
+    KERNEL_AUTO,        // The best one the CPU supports
+    KERNEL_SCALAR,
+    KERNEL_SSE4,
+    KERNEL_AVX2
+};
+
+// Everything the kernel reads, fixed for one search. The node state is
+// described by its raw storage: a slot j is known if stamps[j] ==
+// generation, and its g score is then g_slots[j * g_stride].
+struct NeighbourContext {
+    const u64* done;        // Padded walls and closed cells
+    const u64* walls;       // Padded walls
+    const u8* costs;        // Padded costs, readable 3 bytes past the end, or
+                            // nullptr when all costs are 1
+    const i32* offsets;     // Padded index offsets in PaddedGrid::STEPS order
+
+    const u32* stamps;
+    u32 generation;
+    const i64* g_slots;
+    i32 g_stride;           // In i64s
+
+    i32 target_x;
+    i32 target_y;
+    double h_scale;         // Applied to the octile/Manhattan distance
+    i32 directions;         // 4 or 8
+};
+
+// Candidate scores for each direction, valid where the mask bit is set
+struct NeighbourBatch {
+    alignas(32) i64 g[8];
+    alignas(32) i64 f[8];
+};
+
+// Evaluates every neighbour of the expanded cell 'i' at (x, y) with score
+// 'g' in one pass. Returns a mask with bit d set for each direction that is
+// neither blocked, closed nor cuts a corner and improves on the neighbour's
+// g score, and the scores of those directions in 'out'.
+typedef u32 (*NeighbourKernel)(const NeighbourContext& context,
+        i32 i, i32 x, i32 y, i64 g, NeighbourBatch& out);
+
+namespace kernel {
+
+    // The implementation of 'kind', or of the best supported one for
+    // KERNEL_AUTO, as reported by CPUID. Falls back to the best supported
+    // one if 'kind' is not.
+    KernelKind resolve(KernelKind kind);
+    NeighbourKernel get(KernelKind kind);
+
+    const char* name(KernelKind kind);
+
+    // The vector kernels index the node state and convert the heuristic
+    // through 32 bits, larger maps or estimates need the scalar one
+    bool fitsVector(const NeighbourContext& context, i32 width, i32 height);
+
+}
+
+#endif //NEIGHBOUR_KERNEL_HPP
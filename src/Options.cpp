@@ -0,0 +1,170 @@
+#include <stdexcept>
+#include <sstream>
+
+#include "Options.hpp"
+
+static std::pair<i32, i32> parsePair(const std::string& arg, char sep)
+{
+    std::pair<i32, i32> p;
+    char c;
+
+    std::istringstream in(arg);
+    if (!(in >> p.first >> c >> p.second) || c != sep || !in.eof()) {
+        throw std::runtime_error("Malformed argument '" + arg + "'!");
+    }
+
+    return p;
+}
+
+static double parseNumber(const std::string& arg)
+{
+    try {
+        size_t used;
+        double v = std::stod(arg, &used);
+        if (used == arg.size()) return v;
+    } catch (const std::exception&) {}
+
+    throw std::runtime_error("Malformed number '" + arg + "'!");
+}
+
+Options parseOptions(int argc, char** argv)
+{
+    Options options;
+
+    for (i32 i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error("Missing value for '" + arg + "'!");
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--engine") {
+            options.engine = value();
+        } else if (arg == "--budget") {
+            options.budget_ms = parseNumber(value());
+        } else if (arg == "--weight") {
+            options.engine_config.weight = parseNumber(value());
+        } else if (arg == "--epsilon") {
+            options.engine_config.epsilon = parseNumber(value());
+        } else if (arg == "--epsilon-step") {
+            options.engine_config.epsilon_step = parseNumber(value());
+        } else if (arg == "--node-cap") {
+            options.engine_config.node_cap = (size_t)parseNumber(value());
+        } else if (arg == "--tt-size") {
+            options.engine_config.table_size = (size_t)parseNumber(value());
+        } else if (arg == "--layout") {
+            std::string name = value();
+            if (name == "rows") {
+                options.engine_config.layout = LAYOUT_ROWS;
+            } else if (name == "tiles") {
+                options.engine_config.layout = LAYOUT_TILES;
+            } else if (name == "morton") {
+                options.engine_config.layout = LAYOUT_MORTON;
+            } else {
+                throw std::runtime_error("Unknown layout '" + name + "'!");
+            }
+        } else if (arg == "--data") {
+            options.engine_config.data_path = value();
+        } else if (arg == "--map") {
+            options.map = mapByName(value());
+        } else if (arg == "--size") {
+            options.size = parsePair(value(), 'x');
+        } else if (arg == "--start") {
+            options.start = parsePair(value(), ',');
+        } else if (arg == "--target") {
+            options.target = parsePair(value(), ',');
+        } else if (arg == "--density") {
+            options.density = parseNumber(value());
+        } else if (arg == "--seed") {
+            options.seed = (u32)parseNumber(value());
+        } else if (arg == "--agents") {
+            options.agents = (u32)parseNumber(value());
+        } else if (arg == "--targets") {
+            options.targets = (u32)parseNumber(value());
+        } else if (arg == "--cooperative") {
+            options.cooperative = (u32)parseNumber(value());
+        } else if (arg == "--window") {
+            options.window = (u32)parseNumber(value());
+        } else if (arg == "--scene") {
+            options.scene = value();
+        } else if (arg == "--save-scene") {
+            options.save_scene = value();
+        } else if (arg == "--record") {
+            options.record_dir = value();
+        } else if (arg == "--record-raw") {
+            options.record_raw = value();
+        } else if (arg == "--frame-every") {
+            options.frame_every = (u64)parseNumber(value());
+        } else if (arg == "--cell-size") {
+            options.cell_size = (i32)parseNumber(value());
+        } else if (arg == "--encoders") {
+            options.encoders = (u32)parseNumber(value());
+        } else if (arg == "--serve") {
+            options.serve = value();
+        } else if (arg == "--threads") {
+            options.threads = (u32)parseNumber(value());
+        } else {
+            throw std::runtime_error("Unknown option '" + arg + "', see --help!");
+        }
+    }
+
+    if (options.size.first <= 0 || options.size.second <= 0) {
+        throw std::runtime_error("The grid size must be positive!");
+    }
+
+    if (options.cell_size <= 0 || options.frame_every == 0) {
+        throw std::runtime_error("The cell size and the frame interval must be positive!");
+    }
+
+    return options;
+}
+
+void printUsage(std::ostream& out)
+{
+    out << "Usage: A-Star [options]\n"
+        << "\n"
+        << "  --scene FILE          Open a saved scene instead of a random map\n"
+        << "  --headless            Search without opening a window\n"
+        << "  --engine NAME         Search engine:";
+    for (const auto& engine : engineList()) out << " " << engine.name;
+    out << "\n"
+        << "  --budget MS           Hard time budget per query, 0 for none\n"
+        << "  --weight W            Heuristic weight of weighted A*\n"
+        << "  --epsilon E           Initial epsilon of ARA*\n"
+        << "  --epsilon-step D      Epsilon decrease per ARA* pass\n"
+        << "  --node-cap N          Most nodes SMA* keeps in memory\n"
+        << "  --tt-size N           Transposition table entries of IDA*\n"
+        << "  --layout L            Search state layout of A*: rows, tiles or morton\n"
+        << "  --data PATH           Keep preprocessed maps in PATH.ssg and PATH.cpd (default the --scene file)\n"
+        << "\n"
+        << "Headless map:\n"
+        << "  --map KIND            Generated map:";
+    for (const auto& map : mapList()) out << " " << map.name;
+    out << "\n"
+        << "  --size WxH            Grid dimensions (default 16x9)\n"
+        << "  --start X,Y           Start cell (default top left, or picked by the map)\n"
+        << "  --target X,Y          Target cell (default bottom right, or picked by the map)\n"
+        << "  --density P           Fraction of obstacles of random and open maps (default 0)\n"
+        << "  --seed S              Seed of the map generator\n"
+        << "  --agents N            Also route N random agents through a flow field\n"
+        << "  --targets N           Also search the nearest of N random targets, then all of them\n"
+        << "  --cooperative N       Also plan N random agents that must not collide\n"
+        << "  --window W            Steps the agents plan ahead, 0 for full plans (default 16)\n"
+        << "  --save-scene FILE     Save the map as a scene before searching\n"
+        << "\n"
+        << "Recording (renders the headless map offscreen):\n"
+        << "  --record DIR          Write frame_000000.png, ... to DIR\n"
+        << "  --record-raw FILE     Write raw RGBA frames to FILE, - for stdout\n"
+        << "  --frame-every N       Expansions between frames (default 1)\n"
+        << "  --cell-size PX        Pixels per cell (default 8)\n"
+        << "  --encoders N          PNG encoder threads (default one per core)\n"
+        << "\n"
+        << "Server (answers queries on the headless map, see src/Protocol.hpp):\n"
+        << "  --serve SOCKET        Listen on a Unix domain socket until SIGINT or SIGTERM\n"
+        << "  --threads N           Worker threads (default one per core)\n";
+}
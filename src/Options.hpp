@@ -0,0 +1,51 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <string>
+
+#include "Util.hpp"
+#include "Engines.hpp"
+#include "Maps.hpp"
+
+// Command line options
+struct Options {
+    bool headless = false;
+
+    std::string engine = "astar";
+    EngineConfig engine_config;
+    double budget_ms = 0.0;
+
+    // Headless map, generated from the seed
+    short map = MAP_RANDOM;
+    std::pair<i32, i32> size = {16, 9};
+    std::pair<i32, i32> start = {-1, -1};   // Defaults to the start the map picks
+    std::pair<i32, i32> target = {-1, -1};  // Defaults to the target the map picks
+    double density = 0.0;
+    u32 seed = 1;
+
+    u32 agents = 0;     // Agents routed through a flow field to the target
+    u32 targets = 0;    // Random targets searched from the start at once
+    u32 cooperative = 0;    // Agents planned together without colliding
+    u32 window = 16;        // Lookahead of the cooperative plan, 0 plans in full
+
+    // Scene files, a loaded scene replaces the random map
+    std::string scene;
+    std::string save_scene;
+
+    // Offscreen recording of the search on the headless map
+    std::string record_dir;     // PNG frames
+    std::string record_raw;     // Raw RGBA stream, "-" for stdout
+    u64 frame_every = 1;        // Expansions per frame
+    i32 cell_size = 8;          // Pixels per cell
+    u32 encoders = 0;           // PNG encoder threads, 0 for one per core
+
+    // Query daemon, serves the headless map
+    std::string serve;          // Unix socket path
+    u32 threads = 0;            // Workers, 0 for one per core
+};
+
+// Throws std::runtime_error on malformed arguments
+Options parseOptions(int argc, char** argv);
+void printUsage(std::ostream& out);
+
+#endif //OPTIONS_HPP
@@ -0,0 +1,72 @@
+#include "PaddedGrid.hpp"
+
+constexpr std::pair<i32, i32> PaddedGrid::STEPS[];
+constexpr i32 PaddedGrid::SIDES[][2];
+
+// Sets 'count' bits starting at bit 'from'
+static void setBits(std::vector<u64>& bits, size_t from, size_t count)
+{
+    while (count > 0) {
+        size_t shift = from & 63;
+        size_t n = std::min<size_t>(count, 64 - shift);
+        u64 mask = n == 64 ? ~0ULL : ((1ULL << n) - 1) << shift;
+
+        bits[from >> 6] |= mask;
+        from  += n;
+        count -= n;
+    }
+}
+
+void PaddedGrid::build(const Grid& grid)
+{
+    width  = grid.getWidth();
+    height = grid.getHeight();
+    pitch  = width + 2;
+
+    // One spare word, so the shifted copy of the last word may spill over
+    walls.assign((size() + 63) / 64 + 1, 0);
+
+    // Top and bottom rows, then the left and right sentinel of each row.
+    // The right sentinel of a row and the left one of the next are adjacent.
+    setBits(walls, 0, pitch + 1);
+    for (i32 y = 1; y <= height; y++) {
+        setBits(walls, (size_t)y * pitch + pitch - 1, 2);
+    }
+    setBits(walls, (size_t)(height + 1) * pitch, pitch);
+
+    // Bits past the width of a grid row are clear, whole words can be ORed
+    // in at the row's offset
+    i32 stride = grid.getStride();
+    for (i32 y = 0; y < height; y++) {
+        const u64* row = grid.getRow(y);
+        size_t at = (size_t)(y + 1) * pitch + 1;
+        size_t shift = at & 63;
+
+        for (i32 w = 0; w < stride; w++, at += 64) {
+            walls[at >> 6] |= row[w] << shift;
+            if (shift) walls[(at >> 6) + 1] |= row[w] >> (64 - shift);
+        }
+    }
+
+    done = walls;
+
+    // Three spare bytes, so a kernel may read a word at any cell
+    if (grid.maxCost() > 1) {
+        costs.assign(size() + 3, 255);
+        for (i32 y = 0; y < height; y++) {
+            const u8* row = grid.getCostRow(y);
+            std::copy(row, row + width, costs.begin() + (size_t)(y + 1) * pitch + 1);
+        }
+    } else {
+        costs.clear();
+    }
+
+    for (i32 d = 0; d < DIRECTIONS; d++) {
+        offsets[d] = STEPS[d].second * pitch + STEPS[d].first;
+    }
+}
+
+void PaddedGrid::reopen()
+{
+    std::copy(walls.begin(), walls.end(), done.begin());
+}
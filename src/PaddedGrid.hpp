@@ -0,0 +1,90 @@
+#ifndef PADDED_GRID_HPP
+#define PADDED_GRID_HPP
+
+#include "Util.hpp"
+#include "Grid.hpp"
+
+// Neighbourhoods of the padded engines
+enum Connectivity {
+    CONNECT_4 = 4,
+    CONNECT_8 = 8
+};
+
+// A Grid copied into one flat bitmap with a border of blocked sentinel
+// cells around it. Cells are addressed by their index into the padded
+// rows, the neighbours of any cell inside the grid are a fixed offset away
+// and none of them lies outside of the bitmap, so neighbour generation is an
+// add and a bit test without any bounds checks.
+//
+// Two bitmaps are kept: the obstacles, and a working copy of them the search
+// sets the bits of closed cells in, so one test rejects sentinels, obstacles
+// and closed cells alike.
+class PaddedGrid {
+
+    public:
+        // Straight directions first, west, north, east, south, in the order
+        // of search::adjacentSquares(), then the diagonals
+        static constexpr i32 DIRECTIONS = 8;
+        static constexpr std::pair<i32, i32> STEPS[DIRECTIONS] = {
+            {-1, 0}, {0, -1}, {1, 0}, {0, 1},
+            {-1, -1}, {1, -1}, {-1, 1}, {1, 1}
+        };
+
+        // Straight neighbours a diagonal move passes between, both must be
+        // free so paths never cut a corner
+        static constexpr i32 SIDES[DIRECTIONS][2] = {
+            {0, 0}, {0, 0}, {0, 0}, {0, 0},
+            {0, 1}, {2, 1}, {0, 3}, {2, 3}
+        };
+
+    private:
+        i32 width  = 0;
+        i32 height = 0;
+        i32 pitch  = 0;         // Cells per padded row, width + 2
+
+        std::vector<u64> walls;     // Sentinels and obstacles
+        std::vector<u64> done;      // Walls and closed cells
+
+        std::vector<u8> costs;      // Padded, empty while all costs are 1
+
+        i32 offsets[DIRECTIONS];
+
+        static inline bool test(const std::vector<u64>& bits, i32 i)
+            { return bits[(size_t)i >> 6] >> (i & 63) & 1; }
+
+    public:
+        PaddedGrid() {}
+
+        // Copies 'grid' word by word and resets every closed mark
+        void build(const Grid& grid);
+
+        // Forgets the closed marks only
+        void reopen();
+
+        inline i32 index(const std::pair<i32, i32>& cell) const
+            { return (cell.second + 1) * pitch + cell.first + 1; }
+        inline std::pair<i32, i32> cell(i32 i) const
+            { return {i % pitch - 1, i / pitch - 1}; }
+
+        inline bool blocked(i32 i) const { return test(walls, i); }
+        inline bool closed(i32 i) const { return test(done, i); }
+        inline void close(i32 i) { done[(size_t)i >> 6] |= 1ULL << (i & 63); }
+
+        inline u8 cost(i32 i) const { return costs.empty() ? 1 : costs[i]; }
+        inline bool uniformCosts() const { return costs.empty(); }
+
+        // Index offsets in the order of STEPS
+        inline const i32* neighbourOffsets() const { return offsets; }
+
+        inline const u64* getWalls() const { return walls.data(); }
+        inline const u64* getDone() const { return done.data(); }
+        inline const u8* getCosts() const { return costs.empty() ? nullptr : costs.data(); }
+
+        inline i32 getWidth()  const { return width; }
+        inline i32 getHeight() const { return height; }
+        inline i32 getPitch()  const { return pitch; }
+        inline size_t size() const { return (size_t)pitch * (height + 2); }
+
+};
+
+#endif //PADDED_GRID_HPP
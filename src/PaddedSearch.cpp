@@ -0,0 +1,141 @@
+#include "PaddedSearch.hpp"
+
+#include <cstddef>
+
+const char* PaddedSearch::getName() const
+{
+    return connectivity == CONNECT_8 ? "A* (padded, 8-connected)" : "A* (padded)";
+}
+
+NeighbourContext PaddedSearch::makeContext(const std::pair<i32, i32>& target, double h_scale) const
+{
+    // The kernel reads g scores straight out of the node storage
+    static_assert(offsetof(Node, g) == 0 && sizeof(Node) % sizeof(i64) == 0,
+            "Node must start with its g score and be a whole number of i64s");
+
+    NeighbourContext context;
+    context.done       = padded.getDone();
+    context.walls      = padded.getWalls();
+    context.costs      = padded.getCosts();
+    context.offsets    = padded.neighbourOffsets();
+    context.stamps     = nullptr;
+    context.generation = 0;
+    context.g_slots    = nullptr;
+    context.g_stride   = sizeof(Node) / sizeof(i64);
+    context.target_x   = target.first;
+    context.target_y   = target.second;
+    context.h_scale    = h_scale;
+    context.directions = connectivity == CONNECT_8 ? 8 : 4;
+    return context;
+}
+
+KernelKind PaddedSearch::kernelFor(const Grid& grid) const
+{
+    double h_scale = grid.minCost() * (weight + TIE_BREAKER);
+    NeighbourContext context = makeContext({0, 0}, h_scale);
+    if (!kernel::fitsVector(context, grid.getWidth(), grid.getHeight())) return KERNEL_SCALAR;
+    return kernel::resolve(kernel);
+}
+
+SearchResult PaddedSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    SearchResult result;
+
+    const auto& target = query.target;
+
+    padded.build(grid);
+    nodes.reset(padded.size());
+    openHeap.clear();
+
+    i32 directions = connectivity == CONNECT_8 ? 8 : 4;
+
+    // Min-heap
+    auto later = std::greater<std::pair<i64, i32>>();
+
+    // Octile distance when diagonals are allowed, scaled by the cheapest
+    // cell like the heuristic of AStarSearch
+    double h_scale = grid.minCost() * (weight + TIE_BREAKER);
+    auto heuristic = [&](i32 x, i32 y) {
+        i32 dx = abs(x - target.first);
+        i32 dy = abs(y - target.second);
+        i64 h = STEP_COST * (i64)(dx + dy);
+        if (directions == 8) h += (DIAGONAL_COST - 2 * STEP_COST) * (i64)std::min(dx, dy);
+        return (i64)(h * h_scale);
+    };
+
+    i32 s = padded.index(query.start);
+    i32 t = padded.index(target);
+
+    nodes.set(s, {0, heuristic(query.start.first, query.start.second), -1});
+
+    NeighbourKernel evaluate = kernel::get(kernelFor(grid));
+    NeighbourContext context = makeContext(target, h_scale);
+    context.stamps     = nodes.stampData();
+    context.generation = nodes.getGeneration();
+    context.g_slots    = &nodes.data()->g;
+    NeighbourBatch batch;
+    openHeap.push_back({nodes[s].f, s});
+    size_t touched = 1;
+
+    while (!openHeap.empty()) {
+        if (observer && observer->cancelled()) break;
+
+        // The clock is read every 64 expansions, that is often enough
+        if (query.budget_ms > 0 && (result.expanded & 63) == 0 && search::millisSince(t0) > query.budget_ms) {
+            result.timed_out = true;
+            break;
+        }
+
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [f, i] = openHeap.back();
+        openHeap.pop_back();
+
+        Node& node = nodes[i];
+        if (padded.closed(i) || node.f != f) continue;
+
+        padded.close(i);
+        result.expanded++;
+
+        auto [x, y] = padded.cell(i);
+        if (observer) observer->onClose({x, y});
+
+        if (i == t) {
+            result.found = true;
+            result.cost  = node.g;
+
+            for (i32 k = i; k >= 0; k = nodes[k].parent) {
+                result.path.push_back(padded.cell(k));
+            }
+            std::reverse(result.path.begin(), result.path.end());
+            break;
+        }
+
+        const i32* offsets = context.offsets;
+        for (u32 mask = evaluate(context, i, x, y, node.g, batch); mask; mask &= mask - 1) {
+            i32 d = __builtin_ctz(mask);
+            i32 j = i + offsets[d];
+
+            if (!nodes.has(j)) touched++;
+            nodes.set(j, {batch.g[d], batch.f[d], i});
+
+            openHeap.push_back({batch.f[d], j});
+            std::push_heap(openHeap.begin(), openHeap.end(), later);
+            result.generated++;
+
+            if (observer) {
+                observer->onOpen({x + PaddedGrid::STEPS[d].first, y + PaddedGrid::STEPS[d].second}, batch.f[d]);
+            }
+        }
+    }
+
+    result.epsilon = weight + TIE_BREAKER;
+    result.peak_nodes = touched;
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef PADDED_SEARCH_HPP
+#define PADDED_SEARCH_HPP
+
+#include "Util.hpp"
+#include "Search.hpp"
+#include "PaddedGrid.hpp"
+#include "NeighbourKernel.hpp"
+
+// Diagonal step cost, 10 * sqrt(2) rounded down so the octile heuristic
+// stays admissible
+static constexpr i32 DIAGONAL_COST = 14;
+
+// A* on a PaddedGrid, 4- or 8-connected. Cells are handled by their padded
+// index throughout: the open list holds indices, the per-cell state is a
+// dense array indexed by them and a neighbour is an offset away, so the
+// inner loop has neither bounds checks nor coordinate conversions. The grid
+// is copied into the padded bitmap at the start of every search, which
+// costs one pass over the obstacle words.
+//
+// The neighbours of an expanded cell are evaluated together by a
+// NeighbourKernel, vectorised where the CPU allows, which leaves only the
+// pushes of the cells it selects to the loop.
+class PaddedSearch : public SearchEngine {
+
+    private:
+        static constexpr double TIE_BREAKER = 0.1;     // As in AStarSearch
+
+        double weight;
+        i32 connectivity;
+        KernelKind kernel;
+
+        struct Node {
+            i64 g;
+            i64 f;
+            i32 parent;     // Padded index, -1 for the start
+        };
+
+        PaddedGrid padded;
+        StampedArray<Node> nodes;
+        std::vector<std::pair<i64, i32>> openHeap;
+
+        // Everything but the node state
+        NeighbourContext makeContext(const std::pair<i32, i32>& target, double h_scale) const;
+
+    public:
+        PaddedSearch(i32 connectivity = CONNECT_4, double weight = 1.0, KernelKind kernel = KERNEL_AUTO)
+            : weight(weight), connectivity(connectivity), kernel(kernel) {}
+
+        const char* getName() const override;
+
+        // The kernel searches on 'grid' would use
+        KernelKind kernelFor(const Grid& grid) const;
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+#endif //PADDED_SEARCH_HPP
@@ -0,0 +1,407 @@
+#include <cmath>
+
+#include "Painter.hpp"
+
+void Painter::Draw(AStar& aStar)
+{
+    i32 dl = (i32)aStar.getDeltaLength();
+
+    DrawCosts(aStar, dl);
+    DrawFlowField(aStar, dl);
+    DrawObstacles(aStar, dl);
+    DrawState(aStar, dl);
+    DrawStartTarget(aStar, dl);
+    DrawGrid(aStar, dl);
+}
+
+void Painter::DrawLane(AStar& aStar, const Comparison& comparison, size_t lane, const SDL_Rect& viewport)
+{
+    auto dims = aStar.getDimensions();
+    i32 dl = std::max(1, std::min(viewport.w / dims.first, viewport.h / dims.second));
+
+    // Drawing is relative to and clipped by the viewport
+    i32 saved_top = top;
+    top = 0;
+    SDL_RenderSetViewport(renderer, &viewport);
+
+    DrawCosts(aStar, dl);
+    DrawObstacles(aStar, dl);
+    DrawLaneState(aStar, comparison, lane, dl);
+    DrawStartTarget(aStar, dl);
+    DrawGrid(aStar, dl);
+
+    SDL_RenderSetViewport(renderer, nullptr);
+    top = saved_top;
+}
+
+void Painter::DrawAgents(AStar& aStar, const std::vector<AgentTask>& tasks, const AgentPlan& plan, double time)
+{
+    i32 dl = (i32)aStar.getDeltaLength();
+    i32 inset = dl / 6;
+
+    // Each agent and its target share a hue
+    auto setColor = [&](size_t a) {
+        ImVec4 color = HSL2RGB(360.0 * a / std::max<size_t>(tasks.size(), 1), 0.8f, 0.55f);
+        SDL_SetRenderDrawColor(renderer, 
+                (Uint8)(color.x * 255), 
+                (Uint8)(color.y * 255), 
+                (Uint8)(color.z * 255), 
+                255);
+    };
+
+    for (size_t a = 0; a < tasks.size(); a++) {
+        setColor(a);
+
+        const auto& target = tasks[a].target;
+        SDL_Rect rect = {target.first * dl, top + target.second * dl, dl, dl};
+        SDL_RenderDrawRect(renderer, &rect);
+    }
+
+    time = std::max(0.0, std::min(time, (double)plan.makespan));
+    size_t t = (size_t)time;
+    double along = time - t;
+
+    for (size_t a = 0; a < tasks.size(); a++) {
+        setColor(a);
+
+        std::pair<i32, i32> from = tasks[a].start, to = tasks[a].start;
+        if (a < plan.paths.size()) {
+            const auto& path = plan.paths[a];
+            from = path[std::min(t, path.size() - 1)];
+            to   = path[std::min(t + 1, path.size() - 1)];
+        }
+
+        i32 x = (i32)((from.first  + (to.first  - from.first)  * along) * dl);
+        i32 y = (i32)((from.second + (to.second - from.second) * along) * dl);
+
+        SDL_Rect rect = {x + inset, top + y + inset, dl - 2 * inset, dl - 2 * inset};
+        SDL_RenderFillRect(renderer, &rect);
+    }
+}
+
+void Painter::DrawCosts(AStar& aStar, i32 dl)
+{
+    if (!aStar.costsAreShown()) {
+        return;
+    }
+
+    // Yellow for cheap terrain, red for the most expensive cells
+    const Grid& grid = aStar.getGrid();
+    for (i32 y = 0; y < grid.getHeight(); y++) {
+        const u8* costs = grid.getCostRow(y);
+        for (i32 x = 0; x < grid.getWidth(); x++) {
+            if (costs[x] <= 1) continue;
+
+            double t = (costs[x] - 1) / 254.0;
+            ImVec4 color = HSL2RGB(60.0 * (1.0 - t), 1.0f, 0.25f + 0.2f * t);
+            SDL_SetRenderDrawColor(renderer, 
+                    (Uint8)(color.x * 255), 
+                    (Uint8)(color.y * 255), 
+                    (Uint8)(color.z * 255), 
+                    255);
+
+            SDL_Rect rect = {x * dl, top + y * dl, dl, dl};
+            SDL_RenderFillRect(renderer, &rect);
+        }
+    }
+}
+
+void Painter::DrawFlowField(AStar& aStar, i32 dl)
+{
+    if (!aStar.flowIsShown()) {
+        return;
+    }
+
+    const FlowField& flow_field = aStar.getFlowField();
+    const Grid& grid = aStar.getGrid();
+
+    // The scale only changes with the map or the target
+    if (aStar.getFlowVersion() != flow_version) {
+        flow_version = aStar.getFlowVersion();
+        flow_max = 1;
+        for (i32 y = 0; y < grid.getHeight(); y++) {
+            for (i32 x = 0; x < grid.getWidth(); x++) {
+                u32 value = flow_field.getField({x, y});
+                if (value != FlowField::UNREACHED) flow_max = std::max(flow_max, value);
+            }
+        }
+    }
+    u32 max_field = flow_max;
+
+    // Blue next to the target, red for the cells furthest away
+    for (i32 y = 0; y < grid.getHeight(); y++) {
+        for (i32 x = 0; x < grid.getWidth(); x++) {
+            u32 value = flow_field.getField({x, y});
+            if (value == FlowField::UNREACHED) continue;
+
+            double t = (double)value / max_field;
+            ImVec4 color = HSL2RGB(240.0 * (1.0 - t), 0.8f, 0.3f);
+            SDL_SetRenderDrawColor(renderer, 
+                    (Uint8)(color.x * 255), 
+                    (Uint8)(color.y * 255), 
+                    (Uint8)(color.z * 255), 
+                    255);
+
+            SDL_Rect rect = {x * dl, top + y * dl, dl, dl};
+            SDL_RenderFillRect(renderer, &rect);
+        }
+    }
+
+    // Arrows only where they are big enough to be told apart
+    if (dl < 8) {
+        return;
+    }
+
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    for (i32 y = 0; y < grid.getHeight(); y++) {
+        for (i32 x = 0; x < grid.getWidth(); x++) {
+            u8 dir = flow_field.getFlow({x, y});
+            if (dir == FlowField::NO_FLOW) continue;
+
+            auto [dx, dy] = FlowField::DIRECTIONS[dir];
+            i32 cx = x * dl + dl / 2;
+            i32 cy = top + y * dl + dl / 2;
+            i32 len = dl * 3 / 8;
+
+            // Shaft through the center, head at the far end
+            i32 tx = cx + dx * len, ty = cy + dy * len;
+            SDL_RenderDrawLine(renderer, cx - dx * len, cy - dy * len, tx, ty);
+            SDL_RenderDrawLine(renderer, tx, ty, tx - dx * len / 2 + dy * len / 2, ty - dy * len / 2 + dx * len / 2);
+            SDL_RenderDrawLine(renderer, tx, ty, tx - dx * len / 2 - dy * len / 2, ty - dy * len / 2 - dx * len / 2);
+        }
+    }
+}
+
+void Painter::DrawObstacles(AStar& aStar, i32 dl)
+{
+    ImVec4 color;
+    SDL_Rect rect;
+
+    // Draw Obstacles
+    color = aStar.getObstacleColor();
+    SDL_SetRenderDrawColor(renderer, 
+            (Uint8)(color.x * 255), 
+            (Uint8)(color.y * 255), 
+            (Uint8)(color.z * 255), 
+            (Uint8)(color.w * 255));
+
+    aStar.getGrid().forEachObstacle([&](const std::pair<i32, i32>& obstacle) {
+        rect = {obstacle.first * dl, top + obstacle.second * dl, dl, dl};
+        SDL_RenderFillRect(renderer, &rect);
+    });
+}
+
+void Painter::DrawState(AStar& aStar, i32 dl)
+{
+    ImVec4 color;
+    SDL_Rect rect;
+
+    short state = aStar.getState();
+    if (state != SIMULATING && state != FINISHED) {
+        return;
+    }
+
+    // Read in place, the search waits for the frame to be drawn
+    AStar::TraceView view = aStar.view();
+
+    // Draw Current State Of A*
+    for (const auto tile : view.cells()) {
+        u8 cell = view.state(tile);
+
+        if (cell == CELL_OPEN) {
+            color = aStar.getOpenColor();
+        } else if (cell != CELL_CLOSED) {
+            continue;
+        } else if (aStar.closedColorIsStatic()) {
+            color = aStar.getClosedColor();
+        } else {
+            i32 heuristic = aStar.getHeuristic(tile, aStar.getTarget());
+            color = HSL2RGB(
+                    (heuristic / aStar.getScalar()) % 360, 
+                    1.0f, 
+                    0.5f);
+        }
+
+        SDL_SetRenderDrawColor(renderer, 
+                (Uint8)(color.x * 255), 
+                (Uint8)(color.y * 255), 
+                (Uint8)(color.z * 255), 
+                (Uint8)(color.w * 255));
+
+        rect = {tile.first * dl, top + tile.second * dl, dl, dl};
+        SDL_RenderFillRect(renderer, &rect);
+    }
+
+    // Draw A* Result, anytime engines show their best path while running
+    auto final_path = view.path();
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+
+    for (size_t k = 1; k < final_path.size(); k++) {
+        SDL_RenderDrawLine(renderer, 
+                final_path[k - 1].first  * dl + dl / 2, 
+                final_path[k - 1].second * dl + dl / 2 + top,
+                final_path[k].first  * dl + dl / 2, 
+                final_path[k].second * dl + dl / 2 + top
+                );
+    }
+}
+
+void Painter::DrawStartTarget(AStar& aStar, i32 dl)
+{
+    ImVec4 color;
+    SDL_Rect rect;
+
+    // Draw Start/Target
+    auto start  = aStar.getStart();
+    auto target = aStar.getTarget();
+
+    // Start
+    color = aStar.getStartColor();
+    SDL_SetRenderDrawColor(renderer, 
+            (Uint8)(color.x * 255), 
+            (Uint8)(color.y * 255), 
+            (Uint8)(color.z * 255), 
+            (Uint8)(color.w * 255));
+
+    rect = {start.first * dl, top + start.second * dl, dl, dl};
+    SDL_RenderFillRect(renderer, &rect);
+
+    // Target
+    color = aStar.getTargetColor();
+    SDL_SetRenderDrawColor(renderer, 
+            (Uint8)(color.x * 255), 
+            (Uint8)(color.y * 255), 
+            (Uint8)(color.z * 255), 
+            (Uint8)(color.w * 255));
+
+    rect = {target.first * dl, top + target.second * dl, dl, dl};
+    SDL_RenderFillRect(renderer, &rect);
+
+    for (const auto& cell : aStar.getExtraTargets()) {
+        rect = {cell.first * dl, top + cell.second * dl, dl, dl};
+        SDL_RenderFillRect(renderer, &rect);
+    }
+}
+
+void Painter::DrawGrid(AStar& aStar, i32 dl)
+{
+    ImVec4 color;
+    SDL_Rect rect;
+
+    // Draw Grid
+    if (aStar.gridIsShown()) {
+        color = aStar.getGridColor();
+        SDL_SetRenderDrawColor(renderer, 
+                (Uint8)(color.x * 255), 
+                (Uint8)(color.y * 255), 
+                (Uint8)(color.z * 255), 
+                (Uint8)(color.w * 255));
+
+        auto dims = aStar.getDimensions();
+        for (i32 i = 1; i < dims.first; i++) {
+            SDL_RenderDrawLine(renderer, 
+                    i * dl, 
+                    top, 
+                    i * dl, 
+                    top + dims.second * dl);
+        }
+
+        for (i32 i = 1; i < dims.second; i++) {
+            SDL_RenderDrawLine(renderer, 
+                    0, 
+                    top + i * dl, 
+                    dims.first * dl, 
+                    top + i * dl);
+        }
+    }
+}
+
+void Painter::DrawLaneState(AStar& aStar, const Comparison& comparison, size_t lane, i32 dl)
+{
+    ImVec4 color;
+    SDL_Rect rect;
+
+    comparison.getCells(lane, lane_cells);
+
+    // The lanes search a snapshot, which may predate a resize
+    i32 width = comparison.getGrid().getWidth();
+    for (size_t i = 0; i < lane_cells.size(); i++) {
+        if (lane_cells[i] == LANE_UNSEEN) continue;
+
+        std::pair<i32, i32> tile = {(i32)(i % width), (i32)(i / width)};
+
+        if (lane_cells[i] == LANE_OPEN) {
+            color = aStar.getOpenColor();
+        } else if (aStar.closedColorIsStatic()) {
+            color = aStar.getClosedColor();
+        } else {
+            i32 heuristic = aStar.getHeuristic(tile, aStar.getTarget());
+            color = HSL2RGB(
+                    (heuristic / aStar.getScalar()) % 360, 
+                    1.0f, 
+                    0.5f);
+        }
+
+        SDL_SetRenderDrawColor(renderer, 
+                (Uint8)(color.x * 255), 
+                (Uint8)(color.y * 255), 
+                (Uint8)(color.z * 255), 
+                (Uint8)(color.w * 255));
+
+        rect = {tile.first * dl, top + tile.second * dl, dl, dl};
+        SDL_RenderFillRect(renderer, &rect);
+    }
+
+    auto path = comparison.getPath(lane);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+    for (size_t k = 1; k < path.size(); k++) {
+        SDL_RenderDrawLine(renderer, 
+                path[k - 1].first  * dl + dl / 2, 
+                path[k - 1].second * dl + dl / 2 + top,
+                path[k].first  * dl + dl / 2, 
+                path[k].second * dl + dl / 2 + top);
+    }
+}
+
+ImVec4 HSL2RGB(double h, double s, double l)
+{
+    // Formula From: https://dystopiancode.blogspot.com/2012/06/hsl-rgb-conversion-algorithms-in-c.html
+
+    double r, g, b;
+    r = g = b = 0;
+
+    double c, x, m;
+
+    c = (1.0f - fabs(2.0f * l - 1.0f)) * s;
+    x = c * (1.0f - fabs(fmod(h / 60.0f, 2) - 1.0f));
+    m = l - c * 0.5f;
+
+    if (0 <= h && h < 60.0f) {
+        r = c;
+        g = x;
+    } else if (60.0f <= h && h < 120.0f) {
+        r = x;
+        g = c;
+    } else if (120.0f <= h && h < 180.0f) {
+        g = c;
+        b = x;
+    } else if (180.0f <= h && h < 240.0f) {
+        g = x;
+        b = c;
+    } else if (240.0f <= h && h < 300.0f) {
+        r = x;
+        b = c;
+    } else {
+        r = c;
+        b = x;
+    }
+
+    ImVec4 color = {
+        static_cast<float>(r + m), 
+        static_cast<float>(g + m), 
+        static_cast<float>(b + m), 
+        1.0f
+    };
+    
+    return color;
+}
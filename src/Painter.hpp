@@ -0,0 +1,55 @@
+#ifndef PAINTER_HPP
+#define PAINTER_HPP
+
+#include <SDL2/SDL.h>
+
+#include "../imgui/imgui.h"
+
+#include "Util.hpp"
+#include "AStar.hpp"
+#include "Comparison.hpp"
+#include "Cooperative.hpp"
+
+// Draws the grid, the search state and the overlays of an AStar model onto
+// an SDL renderer. The window uses it below the menu bar, the recorder on a
+// software renderer drawing into an offscreen surface.
+class Painter {
+
+    private:
+        SDL_Renderer* renderer;
+        i32 top;    // Rows of pixels above the grid
+
+        std::vector<u8> lane_cells;
+
+        // Largest value of the flow field at its version 'flow_version'
+        u64 flow_version = UINT64_MAX;
+        u32 flow_max = 1;
+
+        void DrawCosts(AStar& aStar, i32 dl);
+        void DrawFlowField(AStar& aStar, i32 dl);
+        void DrawObstacles(AStar& aStar, i32 dl);
+        void DrawState(AStar& aStar, i32 dl);
+        void DrawStartTarget(AStar& aStar, i32 dl);
+        void DrawGrid(AStar& aStar, i32 dl);
+        void DrawLaneState(AStar& aStar, const Comparison& comparison, size_t lane, i32 dl);
+
+    public:
+        Painter(SDL_Renderer* renderer = nullptr, i32 top = 0) : renderer(renderer), top(top) {}
+
+        inline void setRenderer(SDL_Renderer* renderer) { this->renderer = renderer; }
+        inline void setTop(i32 top) { this->top = top; }
+
+        void Draw(AStar& aStar);
+
+        // One lane of a comparison on the grid of 'aStar', scaled into 'viewport'
+        void DrawLane(AStar& aStar, const Comparison& comparison, size_t lane, const SDL_Rect& viewport);
+
+        // Agents of 'plan' at 'time' in timesteps, between two cells while
+        // moving, over the outlines of their targets
+        void DrawAgents(AStar& aStar, const std::vector<AgentTask>& tasks, const AgentPlan& plan, double time);
+
+};
+
+ImVec4 HSL2RGB(double h, double s, double l);
+
+#endif //PAINTER_HPP
@@ -0,0 +1,382 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "PathDatabase.hpp"
+#include "AtomicFile.hpp"
+
+static const char MAGIC[4] = {'A', 'C', 'P', 'D'};
+static constexpr u16 VERSION = 1;
+
+// Sources a worker takes at a time
+static constexpr u32 CHUNK = 64;
+
+static constexpr u32 BLOCKED = UINT32_MAX;
+
+const std::pair<i32, i32> PathDatabase::DIRECTIONS[4] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+
+PathDatabase::~PathDatabase()
+{
+    unmap();
+}
+
+void PathDatabase::unmap()
+{
+    if (mapping) munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+}
+
+void PathDatabase::build(const Grid& grid, u32 threads)
+{
+    auto t0 = search::Clock::now();
+
+    unmap();
+
+    i32 width  = grid.getWidth();
+    i32 height = grid.getHeight();
+
+    // Depth-first numbering of the free cells, one component after another
+    owned_order.assign((size_t)width * height, BLOCKED);
+    std::vector<std::pair<i32, i32>> cells;
+    std::vector<std::pair<i32, i32>> stack;
+    for (i32 y = 0; y < height; y++) {
+        for (i32 x = 0; x < width; x++) {
+            if (grid.isObstacle({x, y}) || owned_order[(size_t)y * width + x] != BLOCKED) continue;
+
+            stack.push_back({x, y});
+            while (!stack.empty()) {
+                auto cell = stack.back();
+                stack.pop_back();
+
+                u32& number = owned_order[(size_t)cell.second * width + cell.first];
+                if (number != BLOCKED) continue;
+                number = (u32)cells.size();
+                cells.push_back(cell);
+
+                // Reversed, so the first direction is taken first
+                for (i32 d = 3; d >= 0; d--) {
+                    std::pair<i32, i32> next = {cell.first + DIRECTIONS[d].first, cell.second + DIRECTIONS[d].second};
+                    if (!grid.isObstacle(next) && owned_order[(size_t)next.second * width + next.first] == BLOCKED) {
+                        stack.push_back(next);
+                    }
+                }
+            }
+        }
+    }
+
+    u32 n = (u32)cells.size();
+
+    // The graph by number: neighbours in every direction and entry costs
+    std::vector<u32> neighbours((size_t)n * 4, BLOCKED);
+    std::vector<u32> entry(n);
+    for (u32 r = 0; r < n; r++) {
+        entry[r] = (u32)search::stepCost(grid, cells[r]);
+        for (i32 d = 0; d < 4; d++) {
+            std::pair<i32, i32> next = {cells[r].first + DIRECTIONS[d].first, cells[r].second + DIRECTIONS[d].second};
+            if (!grid.isObstacle(next)) neighbours[(size_t)r * 4 + d] = owned_order[(size_t)next.second * width + next.first];
+        }
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max(n / CHUNK, 1u));
+
+    u32 chunks = (n + CHUNK - 1) / CHUNK;
+    std::vector<std::vector<u32>> chunk_runs(chunks);
+    owned_first.assign(n + 1, 0);
+
+    std::atomic<u32> next{0};
+    auto work = [&]() {
+        // Set of optimal first moves towards every target, NO_MOVE alone if
+        // it cannot be reached and every move for the source itself
+        std::vector<u32> dist(n);
+        std::vector<u8> moves(n);
+        std::vector<u64> heap;
+        auto later = std::greater<u64>();
+
+        for (u32 c = next++; c < chunks; c = next++) {
+            auto& out = chunk_runs[c];
+            for (u32 s = c * CHUNK; s < std::min(n, (c + 1) * CHUNK); s++) {
+                std::fill(dist.begin(), dist.end(), UINT32_MAX);
+                std::fill(moves.begin(), moves.end(), 1 << NO_MOVE);
+
+                dist[s] = 0;
+                moves[s] = 0x1f;
+                heap.clear();
+                for (i32 d = 0; d < 4; d++) {
+                    u32 v = neighbours[(size_t)s * 4 + d];
+                    if (v == BLOCKED) continue;
+
+                    dist[v] = entry[v];
+                    moves[v] = 1 << d;
+                    heap.push_back((u64)dist[v] << 32 | v);
+                }
+                std::make_heap(heap.begin(), heap.end(), later);
+
+                // Every cell takes the moves of all its predecessors on a
+                // shortest path, which are all closed before it
+                while (!heap.empty()) {
+                    std::pop_heap(heap.begin(), heap.end(), later);
+                    u64 top = heap.back();
+                    heap.pop_back();
+
+                    u32 u = (u32)top;
+                    if ((u32)(top >> 32) != dist[u]) continue;
+
+                    for (i32 d = 0; d < 4; d++) {
+                        u32 v = neighbours[(size_t)u * 4 + d];
+                        if (v == BLOCKED || v == s) continue;
+
+                        u32 g = dist[u] + entry[v];
+                        if (g < dist[v]) {
+                            dist[v] = g;
+                            moves[v] = moves[u];
+                            heap.push_back((u64)g << 32 | v);
+                            std::push_heap(heap.begin(), heap.end(), later);
+                        } else if (g == dist[v]) {
+                            moves[v] |= moves[u];
+                        }
+                    }
+                }
+
+                // Runs over the targets, each as long as one move stays optimal
+                size_t before = out.size();
+                u32 start = 0;
+                u8 shared = moves[0];
+                for (u32 t = 1; t <= n; t++) {
+                    if (t < n && (shared & moves[t])) {
+                        shared &= moves[t];
+                        continue;
+                    }
+
+                    out.push_back(start << 3 | (u32)__builtin_ctz(shared));
+                    if (t < n) {
+                        start = t;
+                        shared = moves[t];
+                    }
+                }
+                owned_first[s + 1] = out.size() - before;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (u32 t = 1; t < threads; t++) workers.emplace_back(work);
+    work();
+    for (auto& w : workers) w.join();
+
+    for (u32 r = 0; r < n; r++) owned_first[r + 1] += owned_first[r];
+
+    owned_runs.resize(owned_first[n]);
+    for (u32 c = 0; c < chunks; c++) {
+        std::copy(chunk_runs[c].begin(), chunk_runs[c].end(), owned_runs.begin() + owned_first[c * CHUNK]);
+    }
+
+    memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    header.reserved = 0;
+    header.width  = width;
+    header.height = height;
+    header.cells  = n;
+    header.padding = 0;
+    header.fingerprint = grid.fingerprint();
+    header.runs = owned_runs.size();
+
+    first = owned_first.data();
+    order = owned_order.data();
+    runs  = owned_runs.data();
+
+    build_ms = search::millisSince(t0);
+}
+
+void PathDatabase::save(const std::string& path) const
+{
+    // Another engine or process may have the old file mapped
+    AtomicFile file(path);
+
+    file.write(&header, sizeof(Header));
+    file.write(first, (header.cells + 1) * sizeof(u64));
+    file.write(order, (size_t)header.width * header.height * sizeof(u32));
+    file.write(runs, header.runs * sizeof(u32));
+
+    file.commit();
+}
+
+bool PathDatabase::open(const std::string& path, const Grid& grid)
+{
+    auto t0 = search::Clock::now();
+
+    i32 fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    void* base = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(Header)) {
+        base = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+
+    if (base == MAP_FAILED) return false;
+
+    // Sizes must add up to the file's, then the pointers stay inside it
+    Header stored;
+    memcpy(&stored, base, sizeof(Header));
+
+    size_t area = (size_t)std::max(stored.width, 0) * std::max(stored.height, 0);
+    bool valid = memcmp(stored.magic, MAGIC, 4) == 0 && stored.version == VERSION
+        && stored.width == grid.getWidth() && stored.height == grid.getHeight()
+        && stored.fingerprint == grid.fingerprint() && stored.cells <= area
+        && sizeof(Header) + (stored.cells + 1) * sizeof(u64) + area * sizeof(u32) + stored.runs * sizeof(u32)
+            == (size_t)info.st_size;
+
+    const u8* bytes = (const u8*)base;
+    const u64* stored_first = (const u64*)(bytes + sizeof(Header));
+    valid = valid && stored_first[0] == 0 && stored_first[stored.cells] == stored.runs;
+
+    if (!valid) {
+        munmap(base, info.st_size);
+        return false;
+    }
+
+    unmap();
+    owned_first.clear();
+    owned_order.clear();
+    owned_runs.clear();
+
+    mapping = base;
+    mapping_size = info.st_size;
+    header = stored;
+
+    first = stored_first;
+    order = (const u32*)(first + header.cells + 1);
+    runs  = order + area;
+
+    build_ms = search::millisSince(t0);
+
+    return true;
+}
+
+u8 PathDatabase::firstMove(const std::pair<i32, i32>& from, const std::pair<i32, i32>& to) const
+{
+    u32 r = order[(size_t)from.second * header.width + from.first];
+    u32 t = order[(size_t)to.second * header.width + to.first];
+
+    // The last run that starts at or before 't'
+    const u32* begin = runs + first[r];
+    const u32* end   = runs + first[r + 1];
+    const u32* run = std::upper_bound(begin, end, t << 3 | 7);
+    if (run == begin) return NO_MOVE;
+
+    return run[-1] & 7;
+}
+
+bool PathDatabase::path(const std::pair<i32, i32>& from, const std::pair<i32, i32>& to, std::vector<std::pair<i32, i32>>& out) const
+{
+    out.clear();
+
+    auto isFree = [&](const std::pair<i32, i32>& cell) {
+        return cell.first >= 0 && cell.second >= 0 && cell.first < header.width && cell.second < header.height
+            && order[(size_t)cell.second * header.width + cell.first] != BLOCKED;
+    };
+    if (!isFree(from) || !isFree(to)) return false;
+
+    // A shortest path visits every cell at most once, more steps than that
+    // can only come from a damaged file
+    auto cell = from;
+    out.push_back(cell);
+    while (cell != to) {
+        u8 move = firstMove(cell, to);
+        if (move >= NO_MOVE || out.size() > header.cells) {
+            out.clear();
+            return false;
+        }
+
+        cell.first  += DIRECTIONS[move].first;
+        cell.second += DIRECTIONS[move].second;
+        if (!isFree(cell)) {
+            out.clear();
+            return false;
+        }
+        out.push_back(cell);
+    }
+
+    return true;
+}
+
+const char* PathDatabaseSearch::getName() const
+{
+    return "Path database";
+}
+
+std::shared_ptr<const PathDatabase> PathDatabaseSearch::databaseOf(const Grid& grid, const std::string& path)
+{
+    auto database = std::make_shared<PathDatabase>();
+    if (!path.empty() && database->open(path, grid)) return database;
+
+    if ((size_t)grid.getWidth() * grid.getHeight() - grid.count() > MAX_CELLS) return nullptr;
+
+    database->build(grid);
+
+    // The file is only a shortcut, a search goes on without it
+    if (!path.empty()) {
+        try {
+            database->save(path);
+        } catch (const std::runtime_error&) {
+        }
+    }
+
+    return database;
+}
+
+bool PathDatabaseSearch::prepare(const Grid& grid)
+{
+    if (grid.getId() == grid_id && grid.getEdits() == grid_edits) return current != nullptr;
+
+    grid_id = grid.getId();
+    grid_edits = grid.getEdits();
+    if (current && current->matches(grid)) return true;
+
+    current = databaseOf(grid, path);
+    return current != nullptr;
+}
+
+void PathDatabaseSearch::adopt(const Grid& grid, std::shared_ptr<const PathDatabase> database)
+{
+    current = std::move(database);
+    grid_id = grid.getId();
+    grid_edits = grid.getEdits();
+}
+
+SearchResult PathDatabaseSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    if (!prepare(grid)) {
+        SearchResult result = fallback.search(grid, query, observer);
+        result.elapsed_ms = search::millisSince(t0);
+        return result;
+    }
+
+    SearchResult result;
+    if (current->path(query.start, query.target, result.path)) {
+        result.found = true;
+        for (size_t k = 1; k < result.path.size(); k++) {
+            result.cost += search::stepCost(grid, result.path[k]);
+        }
+    }
+
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
@@ -0,0 +1,151 @@
+#ifndef PATH_DATABASE_HPP
+#define PATH_DATABASE_HPP
+
+#include <memory>
+#include <string>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Search.hpp"
+
+// Compressed path database of a 4-connected grid: the first move of a
+// shortest path from every free cell to every other one. A path is followed
+// by looking up one move after another, without any search.
+//
+// Free cells are numbered in depth-first order, so neighbours mostly get
+// nearby numbers, and the moves of one source are stored as runs over the
+// targets in that order. Where several first moves are optimal, a run keeps
+// going as long as one of them is shared, which makes runs far longer than
+// those of any single shortest path tree.
+//
+// The tables are either owned or read straight from a memory-mapped file.
+class PathDatabase {
+
+    public:
+        // Moves along DIRECTIONS, NO_MOVE towards unreachable targets
+        static constexpr u8 NO_MOVE = 4;
+        static const std::pair<i32, i32> DIRECTIONS[4];
+
+    private:
+        struct Header {
+            char magic[4];
+            u16 version;
+            u16 reserved;
+            i32 width;
+            i32 height;
+            u32 cells;      // Free cells
+            u32 padding;
+            u64 fingerprint;
+            u64 runs;
+        };
+
+        Header header = {};
+
+        // Runs of source 'r' are runs[first[r]] to runs[first[r + 1] - 1],
+        // each the number of its first target shifted left by 3 over its move
+        const u64* first = nullptr;
+        const u32* order = nullptr;     // Number of every cell, UINT32_MAX if blocked
+        const u32* runs  = nullptr;
+
+        std::vector<u64> owned_first;
+        std::vector<u32> owned_order;
+        std::vector<u32> owned_runs;
+
+        void* mapping = nullptr;
+        size_t mapping_size = 0;
+
+        double build_ms = 0.0;
+
+        void unmap();
+
+    public:
+        PathDatabase() {}
+        ~PathDatabase();
+
+        PathDatabase(const PathDatabase&) = delete;
+        PathDatabase& operator=(const PathDatabase&) = delete;
+
+        // One Dijkstra search per free cell, 'threads' 0 uses one per core
+        void build(const Grid& grid, u32 threads = 0);
+
+        // Files hold the header, then first[cells + 1], order[width * height]
+        // and runs[runs], in the byte order of the host. save() throws
+        // std::runtime_error. open() maps the file and returns false if it is
+        // missing, damaged or was built for another grid.
+        void save(const std::string& path) const;
+        bool open(const std::string& path, const Grid& grid);
+
+        inline bool matches(const Grid& grid) const
+        {
+            return order && header.width == grid.getWidth() && header.height == grid.getHeight()
+                && header.fingerprint == grid.fingerprint();
+        }
+
+        // First move from 'from' towards 'to', both free cells
+        u8 firstMove(const std::pair<i32, i32>& from, const std::pair<i32, i32>& to) const;
+
+        // Follows the first moves, false if 'to' cannot be reached
+        bool path(const std::pair<i32, i32>& from, const std::pair<i32, i32>& to, std::vector<std::pair<i32, i32>>& out) const;
+
+        inline u32 cellCount() const { return header.cells; }
+        inline u64 runCount() const { return header.runs; }
+        inline size_t bytes() const
+        {
+            return sizeof(Header) + (header.cells + 1) * sizeof(u64)
+                + (size_t)header.width * header.height * sizeof(u32) + header.runs * sizeof(u32);
+        }
+        inline bool isMapped() const { return mapping != nullptr; }
+        inline double getBuildMs() const { return build_ms; }
+
+};
+
+// Answers queries from the path database of the grid, built on the first
+// search and again whenever the grid changed, or mapped from 'path' if it
+// holds the database of this grid. A search only compares the grid's id and
+// edit count with those of the last one; a grid it has not seen yet is
+// hashed once to tell whether the database still fits. Building takes one
+// search per free cell, so grids with more than MAX_CELLS free cells that no
+// file covers are searched with plain A* instead.
+class PathDatabaseSearch : public SearchEngine {
+
+    public:
+        static constexpr u32 MAX_CELLS = 1 << 14;
+
+    private:
+        std::string path;   // Empty keeps the database in memory only
+        AStarSearch fallback;
+
+        // Database of the grid last prepared, possibly shared with other
+        // engines, null if the grid is too large
+        std::shared_ptr<const PathDatabase> current;
+        u64 grid_id = 0;
+        u64 grid_edits = 0;
+
+    public:
+        PathDatabaseSearch(const std::string& path = "") : path(path), fallback(1.0) {}
+
+        const char* getName() const override;
+
+        // Database of 'grid', mapped from 'path' if it holds it, else built
+        // and saved there. Null if the grid is too large to build it. An
+        // empty 'path' only builds.
+        static std::shared_ptr<const PathDatabase> databaseOf(const Grid& grid, const std::string& path);
+
+        // Maps or builds the database unless it matches 'grid' already.
+        // Returns false if the grid is too large to build it.
+        bool prepare(const Grid& grid);
+
+        // Searches 'grid' with a database prepared for it elsewhere, so
+        // engines on several threads can share one
+        void adopt(const Grid& grid, std::shared_ptr<const PathDatabase> database);
+
+        inline const PathDatabase& getDatabase() const { return *current; }
+
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+#endif //PATH_DATABASE_HPP
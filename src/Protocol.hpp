@@ -0,0 +1,120 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <cstring>
+#include <string>
+
+#include "Util.hpp"
+
+// Wire format of the query daemon, little-endian throughout.
+//
+// Every message is a frame: u32 size of the rest of the frame, u8 type,
+// three reserved bytes and the u32 request id, echoed in the reply. Replies
+// carry the type of their request with the high bit set, or MSG_ERROR with
+// a text. A client may send any number of requests without waiting, the
+// replies of queries may come back in any order; requests are only read
+// as fast as the client reads its replies.
+//
+//   MSG_QUERY    u32 map, u8 engine (index into engineList()), u8 flags,
+//                u16 reserved, i32 start x/y, target x/y, u32 budget in us
+//     reply      u8 status, 3 reserved, i64 cost, u32 expanded, u32 cells,
+//                then i32 x/y per cell if FLAG_PATH was set
+//   MSG_LOAD     path of a scene file, a file loaded before keeps its map
+//     reply      u32 map, i32 width, height
+//   MSG_STATS    no payload
+//     reply      u64 queries, batches, errors, f64 uptime s, queries per s,
+//                mean batch size, latency p50, p90, p99, p999, max in us,
+//                u32 workers, maps
+namespace protocol {
+
+    static constexpr u32 HEADER_SIZE = 12;          // Including the size field
+    static constexpr u32 MAX_FRAME   = 1 << 20;
+
+    enum Messages {
+        MSG_QUERY = 1,
+        MSG_LOAD  = 2,
+        MSG_STATS = 3,
+        MSG_REPLY = 0x80,
+        MSG_ERROR = 0xff
+    };
+
+    enum QueryFlags {
+        FLAG_PATH = 1
+    };
+
+    enum QueryStatus {
+        STATUS_FOUND,
+        STATUS_NO_PATH,
+        STATUS_TIMED_OUT,
+        STATUS_INVALID      // Start or target blocked or outside of the map
+    };
+
+    static constexpr u32 QUERY_SIZE = 28;
+    static constexpr u32 RESULT_SIZE = 20;
+
+    inline void put8(std::vector<u8>& out, u8 v) { out.push_back(v); }
+
+    inline void put32(std::vector<u8>& out, u32 v)
+    {
+        for (i32 s = 0; s < 32; s += 8) out.push_back(v >> s & 0xff);
+    }
+
+    inline void put64(std::vector<u8>& out, u64 v)
+    {
+        for (i32 s = 0; s < 64; s += 8) out.push_back(v >> s & 0xff);
+    }
+
+    inline void putDouble(std::vector<u8>& out, double d)
+    {
+        u64 v;
+        memcpy(&v, &d, 8);
+        put64(out, v);
+    }
+
+    inline u32 get32(const u8* p)
+    {
+        return (u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24;
+    }
+
+    inline u64 get64(const u8* p)
+    {
+        return (u64)get32(p) | (u64)get32(p + 4) << 32;
+    }
+
+    inline double getDouble(const u8* p)
+    {
+        u64 v = get64(p);
+        double d;
+        memcpy(&d, &v, 8);
+        return d;
+    }
+
+    // Starts a frame, endFrame() fills in its size
+    inline size_t beginFrame(std::vector<u8>& out, u8 type, u32 id)
+    {
+        size_t start = out.size();
+        put32(out, 0);
+        put8(out, type);
+        put8(out, 0);
+        put8(out, 0);
+        put8(out, 0);
+        put32(out, id);
+        return start;
+    }
+
+    inline void endFrame(std::vector<u8>& out, size_t start)
+    {
+        u32 size = (u32)(out.size() - start - 4);
+        for (i32 k = 0; k < 4; k++) out[start + k] = size >> (8 * k) & 0xff;
+    }
+
+    inline void putError(std::vector<u8>& out, u32 id, const std::string& message)
+    {
+        size_t frame = beginFrame(out, MSG_ERROR, id);
+        out.insert(out.end(), message.begin(), message.end());
+        endFrame(out, frame);
+    }
+
+}
+
+#endif //PROTOCOL_HPP
@@ -0,0 +1,199 @@
+#include <stdexcept>
+
+#include <SDL2/SDL_image.h>
+
+#include "Recorder.hpp"
+#include "Headless.hpp"
+
+Recorder::Recorder(const Options& options, i32 width, i32 height)
+    : dir(options.record_dir)
+{
+    surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_RGBA32);
+    if (surface == nullptr) {
+        throw std::runtime_error(std::string("Could not create surface: ") + SDL_GetError());
+    }
+
+    renderer = SDL_CreateSoftwareRenderer(surface);
+    if (renderer == nullptr) {
+        SDL_FreeSurface(surface);
+        throw std::runtime_error(std::string("Could not create renderer: ") + SDL_GetError());
+    }
+
+    painter.setRenderer(renderer);
+
+    if (options.record_raw == "-") {
+        raw = stdout;
+    } else if (!options.record_raw.empty()) {
+        raw = fopen(options.record_raw.c_str(), "wb");
+        if (raw == nullptr) {
+            SDL_DestroyRenderer(renderer);
+            SDL_FreeSurface(surface);
+            throw std::runtime_error("Could not open '" + options.record_raw + "'!");
+        }
+    }
+
+    if (!dir.empty()) {
+        u32 threads = options.encoders;
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+        // A few frames per encoder keep them busy without holding the
+        // whole recording in memory
+        max_jobs = 4 * threads;
+        for (u32 t = 0; t < threads; t++) {
+            encoders.emplace_back([this] { encode(); });
+        }
+    }
+}
+
+Recorder::~Recorder()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        done = true;
+    }
+    job_ready.notify_all();
+
+    for (auto& encoder : encoders) encoder.join();
+
+    // Only left over if finish() was skipped by an exception
+    for (auto& job : jobs) SDL_FreeSurface(job.second);
+
+    if (raw != nullptr && raw != stdout) fclose(raw);
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+}
+
+void Recorder::encode()
+{
+    while (true) {
+        std::pair<u64, SDL_Surface*> job;
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            job_ready.wait(lock, [this] { return done || !jobs.empty(); });
+
+            if (jobs.empty()) return;
+
+            job = jobs.front();
+            jobs.pop_front();
+        }
+        job_taken.notify_one();
+
+        char name[32];
+        snprintf(name, sizeof(name), "/frame_%06llu.png", (unsigned long long)job.first);
+
+        if (IMG_SavePNG(job.second, (dir + name).c_str()) != 0) {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            encode_error = dir + name + ": " + IMG_GetError();
+        }
+
+        SDL_FreeSurface(job.second);
+    }
+}
+
+void Recorder::capture(AStar& aStar)
+{
+    SDL_SetRenderDrawColor(renderer, 70, 70, 70, 255);
+    SDL_RenderClear(renderer);
+    painter.Draw(aStar);
+    SDL_RenderPresent(renderer);
+
+    if (raw != nullptr) {
+        const u8* pixels = (const u8*)surface->pixels;
+        size_t row = (size_t)surface->w * 4;
+        for (i32 y = 0; y < surface->h; y++) {
+            if (fwrite(pixels + (size_t)y * surface->pitch, 1, row, raw) != row) {
+                throw std::runtime_error("Could not write raw frame!");
+            }
+        }
+    }
+
+    if (!encoders.empty()) {
+        SDL_Surface* copy = SDL_DuplicateSurface(surface);
+        if (copy == nullptr) {
+            throw std::runtime_error(std::string("Could not copy frame: ") + SDL_GetError());
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(jobs_mutex);
+            job_taken.wait(lock, [this] { return jobs.size() < max_jobs; });
+            jobs.push_back({frames, copy});
+        }
+        job_ready.notify_one();
+    }
+
+    frames++;
+}
+
+void Recorder::finish()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        done = true;
+    }
+    job_ready.notify_all();
+
+    for (auto& encoder : encoders) encoder.join();
+    encoders.clear();
+
+    if (raw != nullptr) fflush(raw);
+
+    if (!encode_error.empty()) {
+        throw std::runtime_error("Could not write frame " + encode_error);
+    }
+}
+
+int runRecording(const Options& options)
+{
+    // Environment variables still take precedence over a hint
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        throw std::runtime_error(std::string("Could not initialize SDL: ") + SDL_GetError());
+    }
+
+    struct SdlQuit { ~SdlQuit() { SDL_Quit(); } } sdl_quit;
+
+    Grid grid;
+    SearchQuery query;
+    std::mt19937 rng(options.seed);
+    buildMap(options, grid, query, rng);
+
+    i32 width  = grid.getWidth()  * options.cell_size;
+    i32 height = grid.getHeight() * options.cell_size;
+
+    AStar aStar;
+    aStar.setGrid(std::move(grid));
+    aStar.setDeltaLength(options.cell_size);
+    aStar.setStart(query.start);
+    aStar.setTarget(query.target);
+    aStar.setEngine(options.engine);
+    aStar.setEngineConfig(options.engine_config);
+    aStar.setBudget(options.budget_ms);
+
+    Recorder recorder(options, width, height);
+
+    auto t0 = search::Clock::now();
+
+    // The empty map, every n-th expansion and the final path
+    recorder.capture(aStar);
+    aStar.runSimulation(options.frame_every, [&] { recorder.capture(aStar); });
+    recorder.capture(aStar);
+    recorder.finish();
+
+    double elapsed_ms = search::millisSince(t0);
+    SearchResult result = aStar.getLastResult();
+
+    // Progress goes to stderr, stdout may carry the raw frames
+    fprintf(stderr, "%s: %s, %llu expanded, %llu frames of %dx%d in %.1f ms (%.1f frames/s)\n",
+            createEngine(options.engine, options.engine_config)->getName(),
+            result.found ? ("cost " + std::to_string(result.cost)).c_str() : "no path",
+            (unsigned long long)result.expanded, (unsigned long long)recorder.getFrames(),
+            width, height, elapsed_ms, 1000.0 * recorder.getFrames() / elapsed_ms);
+
+    if (!options.record_raw.empty() && options.record_raw != "-") {
+        fprintf(stderr, "encode with: ffmpeg -f rawvideo -pixel_format rgba -video_size %dx%d "
+                "-framerate 30 -i %s out.mp4\n", width, height, options.record_raw.c_str());
+    }
+
+    return result.found ? EXIT_SUCCESS : EXIT_FAILURE;
+}
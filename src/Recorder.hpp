@@ -0,0 +1,68 @@
+#ifndef RECORDER_HPP
+#define RECORDER_HPP
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <SDL2/SDL.h>
+
+#include "Util.hpp"
+#include "AStar.hpp"
+#include "Options.hpp"
+#include "Painter.hpp"
+
+// Renders frames of a search into an offscreen surface with SDL's software
+// renderer, so it needs no window and runs under the dummy video driver.
+//
+// PNG encoding is the slow part, a copy of every frame is queued for a pool
+// of encoder threads and the search only waits once the queue is full. Raw
+// RGBA frames are written in order right away, they cost a single write.
+class Recorder {
+
+    private:
+        SDL_Surface* surface = nullptr;
+        SDL_Renderer* renderer = nullptr;
+        Painter painter;
+
+        std::string dir;
+        FILE* raw = nullptr;
+
+        u64 frames = 0;
+
+        // Frames waiting for an encoder, bounded by 'max_jobs'
+        std::deque<std::pair<u64, SDL_Surface*>> jobs;
+        size_t max_jobs;
+        bool done = false;
+        std::mutex jobs_mutex;
+        std::condition_variable job_ready;
+        std::condition_variable job_taken;
+
+        std::vector<std::thread> encoders;
+        std::string encode_error;
+
+        void encode();
+
+    public:
+        Recorder(const Options& options, i32 width, i32 height);
+        ~Recorder();
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        // Draws the current state of 'aStar' and hands it to the outputs
+        void capture(AStar& aStar);
+
+        // Waits for the queued frames, throws if one could not be written
+        void finish();
+
+        inline u64 getFrames() const { return frames; }
+
+};
+
+// Runs the headless query while recording it. Returns the process exit code.
+int runRecording(const Options& options);
+
+#endif //RECORDER_HPP
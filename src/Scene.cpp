@@ -0,0 +1,358 @@
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "Scene.hpp"
+
+static const char MAGIC[4] = {'A', 'S', 'C', 'N'};
+static constexpr u16 VERSION = 1;
+static constexpr u16 FLAG_COSTS = 1;
+
+// Larger grids are taken as a corrupt header rather than allocated, the
+// cost layer alone takes a byte per cell
+static constexpr i32 MAX_SIDE = 1 << 16;
+static constexpr i64 MAX_CELLS = 1 << 26;
+
+static constexpr u32 FNV_OFFSET = 2166136261u;
+static constexpr u32 FNV_PRIME  = 16777619u;
+
+static inline u32 fnv(u32 hash, const u8* data, size_t size)
+{
+    for (size_t k = 0; k < size; k++) {
+        hash = (hash ^ data[k]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+Scene::Scene()
+{
+    float sec  =  50.0f / 255.0f;
+    float prim = 175.0f / 255.0f;
+    float back =  70.0f / 255.0f;
+
+    colors[COLOR_START]      = {prim,  sec,  sec, 1.0f};
+    colors[COLOR_TARGET]     = { sec,  sec, prim, 1.0f};
+    colors[COLOR_OBSTACLE]   = { sec, prim,  sec, 1.0f};
+    colors[COLOR_GRID]       = {0.0f, 0.0f, 0.0f, 1.0f};
+    colors[COLOR_OPEN]       = {prim, prim,  sec, 1.0f};
+    colors[COLOR_CLOSED]     = { sec, prim, prim, 1.0f};
+    colors[COLOR_BACKGROUND] = {back, back, back, 1.0f};
+}
+
+namespace {
+
+    class Writer {
+
+        private:
+            std::vector<u8> buffer;
+
+        public:
+            inline void put(u8 b) { buffer.push_back(b); }
+
+            void putU16(u16 v)
+            {
+                put(v & 0xff);
+                put(v >> 8);
+            }
+
+            void putU32(u32 v)
+            {
+                for (i32 s = 0; s < 32; s += 8) put(v >> s & 0xff);
+            }
+
+            void putFloat(float f)
+            {
+                u32 v;
+                memcpy(&v, &f, 4);
+                putU32(v);
+            }
+
+            void putVarint(u32 v)
+            {
+                while (v >= 0x80) {
+                    put((u8)(v | 0x80));
+                    v >>= 7;
+                }
+                put((u8)v);
+            }
+
+            void write(const std::string& path)
+            {
+                putU32(fnv(FNV_OFFSET, buffer.data(), buffer.size()));
+
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    throw std::runtime_error("Could not open " + path + " for writing");
+                }
+
+                file.write((const char*)buffer.data(), buffer.size());
+                if (!file) {
+                    throw std::runtime_error("Could not write " + path);
+                }
+            }
+
+    };
+
+    // Reads the file in chunks and hashes every byte as it is consumed, so
+    // the checksum is known once the last row was decoded
+    class Reader {
+
+        private:
+            static constexpr size_t CHUNK = 1 << 16;
+
+            std::ifstream file;
+            std::string path;
+            std::vector<u8> chunk;
+            size_t pos = 0;
+            size_t end = 0;
+            size_t hashed = 0;  // Bytes of the chunk already hashed
+            u32 hash = FNV_OFFSET;
+
+            void refill()
+            {
+                hash = fnv(hash, chunk.data() + hashed, end - hashed);
+
+                file.read((char*)chunk.data(), CHUNK);
+                end = file.gcount();
+                pos = hashed = 0;
+
+                if (end == 0) {
+                    throw std::runtime_error(path + " is truncated");
+                }
+            }
+
+        public:
+            Reader(const std::string& path) : file(path, std::ios::binary), path(path), chunk(CHUNK)
+            {
+                if (!file) {
+                    throw std::runtime_error("Could not open " + path);
+                }
+            }
+
+            inline u8 get()
+            {
+                if (pos == end) refill();
+                return chunk[pos++];
+            }
+
+            u16 getU16()
+            {
+                u16 v = get();
+                return v | (u16)get() << 8;
+            }
+
+            u32 getU32()
+            {
+                u32 v = 0;
+                for (i32 s = 0; s < 32; s += 8) v |= (u32)get() << s;
+                return v;
+            }
+
+            float getFloat()
+            {
+                u32 v = getU32();
+                float f;
+                memcpy(&f, &v, 4);
+                return f;
+            }
+
+            u32 getVarint()
+            {
+                u32 v = 0;
+                for (i32 s = 0; s < 35; s += 7) {
+                    u8 b = get();
+                    v |= (u32)(b & 0x7f) << s;
+                    if (!(b & 0x80)) return v;
+                }
+                throw std::runtime_error(path + " holds an invalid run length");
+            }
+
+            // Hash of everything read so far
+            u32 checksum()
+            {
+                hash = fnv(hash, chunk.data() + hashed, pos - hashed);
+                hashed = pos;
+                return hash;
+            }
+
+            bool atEnd()
+            {
+                return pos == end && file.peek() == std::char_traits<char>::eof();
+            }
+
+            [[noreturn]] void fail(const std::string& what) const
+            {
+                throw std::runtime_error(path + ": " + what);
+            }
+
+    };
+
+}
+
+// Sets the bits of columns [x0, x1)
+static inline void setSpan(u64* words, i32 x0, i32 x1)
+{
+    for (i32 i = x0 >> 6; i <= (x1 - 1) >> 6; i++) {
+        i32 lo = std::max(x0 - i * 64, 0);
+        i32 hi = std::min(x1 - i * 64, 64);
+        words[i] |= (hi == 64 ? ~0ULL : (1ULL << hi) - 1) & (~0ULL << lo);
+    }
+}
+
+// First column at or after 'x' whose bit differs from 'blocked', or 'width'
+static i32 nextChange(const u64* row, i32 stride, i32 width, i32 x, bool blocked)
+{
+    for (i32 i = x >> 6; i < stride; i++) {
+        u64 w = blocked ? ~row[i] : row[i];
+        if (i == x >> 6) w &= ~0ULL << (x & 63);
+        if (w) return std::min(width, i * 64 + __builtin_ctzll(w));
+    }
+
+    return width;
+}
+
+void saveScene(const std::string& path, const Scene& scene)
+{
+    const Grid& grid = scene.grid;
+    const i32 width  = grid.getWidth();
+    const i32 height = grid.getHeight();
+
+    bool costs = grid.maxCost() > 1;
+
+    Writer out;
+    for (char c : MAGIC) out.put(c);
+    out.putU16(VERSION);
+    out.putU16(costs ? FLAG_COSTS : 0);
+
+    for (i32 v : {width, height,
+                  scene.start.first, scene.start.second,
+                  scene.target.first, scene.target.second,
+                  scene.scalar, scene.delay}) {
+        out.putU32((u32)v);
+    }
+
+    for (const auto& color : scene.colors) {
+        for (float f : color) out.putFloat(f);
+    }
+
+    // Runs are found a word at a time, uniform stretches cost nothing
+    for (i32 y = 0; y < height; y++) {
+        const u64* row = grid.getRow(y);
+        bool blocked = false;
+        for (i32 x = 0; x < width; blocked = !blocked) {
+            i32 next = nextChange(row, grid.getStride(), width, x, blocked);
+            out.putVarint(next - x);
+            x = next;
+        }
+    }
+
+    if (costs) {
+        for (i32 y = 0; y < height; y++) {
+            const u8* row = grid.getCostRow(y);
+            for (i32 x = 0; x < width; ) {
+                i32 next = x + 1;
+                while (next < width && row[next] == row[x]) next++;
+
+                out.putVarint(next - x);
+                out.put(row[x]);
+                x = next;
+            }
+        }
+    }
+
+    out.write(path);
+}
+
+void loadScene(const std::string& path, Scene& scene)
+{
+    Reader in(path);
+
+    char magic[4];
+    for (char& c : magic) c = (char)in.get();
+    if (memcmp(magic, MAGIC, 4) != 0) {
+        in.fail("not a scene file");
+    }
+
+    u16 version = in.getU16();
+    if (version != VERSION) {
+        in.fail("unsupported scene version " + std::to_string(version));
+    }
+    u16 flags = in.getU16();
+
+    i32 header[8];
+    for (i32& v : header) v = (i32)in.getU32();
+
+    const i32 width  = header[0];
+    const i32 height = header[1];
+    if (width <= 0 || height <= 0 || width > MAX_SIDE || height > MAX_SIDE
+            || (i64)width * height > MAX_CELLS) {
+        in.fail("invalid grid size");
+    }
+
+    Scene loaded;
+    loaded.start  = {header[2], header[3]};
+    loaded.target = {header[4], header[5]};
+    loaded.scalar = header[6];
+    loaded.delay  = header[7];
+
+    if (loaded.scalar < 1) {
+        in.fail("invalid scaling factor");
+    }
+
+    for (auto& color : loaded.colors) {
+        for (float& f : color) f = in.getFloat();
+    }
+
+    // Each row is assembled from its runs a word at a time and stored whole
+    Grid& grid = loaded.grid;
+    grid.resize(width, height);
+    std::vector<u64> words(grid.getStride());
+
+    for (i32 y = 0; y < height; y++) {
+        std::fill(words.begin(), words.end(), 0);
+
+        bool blocked = false;
+        for (i32 x = 0; x < width; blocked = !blocked) {
+            u32 run = in.getVarint();
+            if (run > (u32)(width - x) || (run == 0 && (x > 0 || blocked))) {
+                in.fail("corrupt obstacle row " + std::to_string(y));
+            }
+
+            if (blocked) setSpan(words.data(), x, x + run);
+            x += run;
+        }
+
+        grid.setRow(y, words.data());
+    }
+
+    if (flags & FLAG_COSTS) {
+        for (i32 y = 0; y < height; y++) {
+            for (i32 x = 0; x < width; ) {
+                u32 run = in.getVarint();
+                u8 cost = in.get();
+                if (run == 0 || run > (u32)(width - x) || cost == 0) {
+                    in.fail("corrupt cost row " + std::to_string(y));
+                }
+
+                if (cost > 1) {
+                    for (i32 k = x; k < x + (i32)run; k++) grid.setCost({k, y}, cost);
+                }
+                x += run;
+            }
+        }
+    }
+
+    u32 expected = in.checksum();
+    if (in.getU32() != expected) {
+        in.fail("checksum mismatch");
+    }
+    if (!in.atEnd()) {
+        in.fail("trailing data");
+    }
+
+    if (!grid.inBounds(loaded.start) || !grid.inBounds(loaded.target)) {
+        in.fail("start or target outside of the grid");
+    }
+
+    scene = std::move(loaded);
+}
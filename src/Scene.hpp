@@ -0,0 +1,49 @@
+#ifndef SCENE_HPP
+#define SCENE_HPP
+
+#include <array>
+#include <string>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+
+enum SceneColors {
+    COLOR_START,
+    COLOR_TARGET,
+    COLOR_OBSTACLE,
+    COLOR_GRID,
+    COLOR_OPEN,
+    COLOR_CLOSED,
+    COLOR_BACKGROUND,
+    COLOR_COUNT
+};
+
+// Everything needed to restore an editing session, colors are RGBA
+struct Scene {
+    Grid grid;
+    std::pair<i32, i32> start  = {0, 0};
+    std::pair<i32, i32> target = {0, 0};
+    i32 scalar = 1;
+    i32 delay  = 0;
+    std::array<std::array<float, 4>, COLOR_COUNT> colors;
+
+    // The default colors of the editor
+    Scene();
+};
+
+// Binary scene files, little-endian:
+//
+//   "ASCN", u16 version, u16 flags, i32 width, height, start x/y, target x/y,
+//   scalar, delay, f32 RGBA colors, obstacle rows, [cost rows], u32 checksum
+//
+// An obstacle row is a list of varint run lengths, alternating between free
+// and blocked cells and starting with free ones. A cost row is a list of
+// (varint run length, u8 cost) pairs. Cost rows are only stored if a cell
+// costs more than 1. The checksum is FNV-1a over all preceding bytes.
+//
+// Both functions throw std::runtime_error. Loading decodes the rows while
+// streaming the file, straight into the words of the grid.
+void saveScene(const std::string& path, const Scene& scene);
+void loadScene(const std::string& path, Scene& scene);
+
+#endif //SCENE_HPP
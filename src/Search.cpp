@@ -0,0 +1,147 @@
+#include <limits>
+
+#include "Search.hpp"
+
+void search::adjacentSquares(
+        const Grid& grid,
+        const std::pair<i32, i32>& current,
+        std::vector<std::pair<i32, i32>>& out)
+{
+    out.clear();
+
+    i32 f = current.first;
+    i32 s = current.second;
+
+    if (!grid.isObstacle({f - 1, s})) out.push_back({f - 1, s});
+    if (!grid.isObstacle({f, s - 1})) out.push_back({f, s - 1});
+    if (!grid.isObstacle({f + 1, s})) out.push_back({f + 1, s});
+    if (!grid.isObstacle({f, s + 1})) out.push_back({f, s + 1});
+}
+
+void search::retracePath(
+        const std::pair<i32, i32>& target,
+        const std::unordered_map<std::pair<i32, i32>, std::pair<i32, i32>, pair_hash>& parents,
+        std::vector<std::pair<i32, i32>>& path)
+{
+    path = {target};
+
+    auto it = parents.find(target);
+    while (it != parents.end()) {
+        path.push_back(it->second);
+        it = parents.find(it->second);
+    }
+
+    std::reverse(path.begin(), path.end());
+}
+
+const char* AStarSearch::getName() const
+{
+    switch (priority) {
+        case PRIORITY_DIJKSTRA: return "Dijkstra";
+        case PRIORITY_GREEDY:   return "Greedy Best-First";
+        default:                return weight == 1.0 ? "A*" : "Weighted A*";
+    }
+}
+
+SearchResult AStarSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    SearchResult result;
+
+    const auto& start  = query.start;
+    const auto& target = query.target;
+
+    layout.configure(layout_kind, grid.getWidth(), grid.getHeight());
+    auto index = [&](const std::pair<i32, i32>& c) { return layout.index(c); };
+
+    nodes.reset(layout.size());
+    openHeap.clear();
+
+    // Min-heap
+    auto later = std::greater<std::pair<i64, std::pair<i32, i32>>>();
+
+    // Scaled by the cheapest cell the distance is admissible, the weight and
+    // the tie breaker then inflate it, so the cost is within the reported
+    // epsilon (weight + 0.1) of the optimum
+    double h_scale = priority == PRIORITY_DIJKSTRA ? 0.0 : grid.minCost() * (weight + TIE_BREAKER);
+    auto heuristic = [&](const std::pair<i32, i32>& square) {
+        return (i64)(search::manhattan(square, target) * h_scale);
+    };
+
+    // Greedy best-first still tracks g for the cost of its path
+    i64 g_factor = priority == PRIORITY_GREEDY ? 0 : 1;
+
+    nodes.set(index(start), {0, heuristic(start), -1, false});
+    openHeap.push_back({heuristic(start), start});
+    size_t touched = 1;
+
+    while (!openHeap.empty()) {
+        if (observer && observer->cancelled()) break;
+
+        if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+            result.timed_out = true;
+            break;
+        }
+
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [f, current] = openHeap.back();
+        openHeap.pop_back();
+
+        Node& node = nodes[index(current)];
+        if (node.closed || node.f != f) continue;
+
+        node.closed = true;
+        result.expanded++;
+
+        if (observer) observer->onClose(current);
+
+        if (current == target) {
+            result.found = true;
+            result.cost  = node.g;
+
+            for (i32 i = (i32)index(current); i >= 0; i = nodes[i].parent) {
+                result.path.push_back(layout.cell(i));
+            }
+            std::reverse(result.path.begin(), result.path.end());
+            break;
+        }
+
+        i64 g = node.g;
+        search::adjacentSquares(grid, current, adjacentSquares);
+        for (const std::pair<i32, i32> &square : adjacentSquares) {
+            size_t i = index(square);
+            i64 new_gScore = g + search::stepCost(grid, square);
+
+            if (nodes.has(i)) {
+                if (nodes[i].closed || new_gScore >= nodes[i].g) continue;
+            } else {
+                touched++;
+            }
+
+            i64 new_fScore = g_factor * new_gScore + heuristic(square);
+            nodes.set(i, {new_gScore, new_fScore, (i32)index(current), false});
+
+            openHeap.push_back({new_fScore, square});
+            std::push_heap(openHeap.begin(), openHeap.end(), later);
+            result.generated++;
+
+            if (observer) observer->onOpen(square, new_fScore);
+        }
+    }
+
+    if (priority == PRIORITY_DIJKSTRA) {
+        result.epsilon = 1.0;
+    } else if (priority == PRIORITY_GREEDY) {
+        result.epsilon = std::numeric_limits<double>::infinity();
+    } else {
+        result.epsilon = weight + TIE_BREAKER;
+    }
+    result.peak_nodes = touched;
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
@@ -0,0 +1,148 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <chrono>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Arena.hpp"
+#include "Layout.hpp"
+
+struct SearchQuery {
+    std::pair<i32, i32> start;
+    std::pair<i32, i32> target;
+
+    double budget_ms = 0.0;     // 0 means no deadline
+};
+
+struct SearchResult {
+    bool found = false;
+    bool timed_out = false;
+
+    i64 cost = 0;
+    double epsilon = 1.0;       // 'cost' is at most epsilon times the optimum
+
+    std::vector<std::pair<i32, i32>> path;  // From start to target, any-angle engines list waypoints only
+
+    u64 expanded = 0;
+    u64 generated = 0;
+    u64 reexpanded = 0;         // Work repeated because state was not kept
+    size_t peak_nodes = 0;      // Most search nodes held at once
+    double elapsed_ms = 0.0;
+};
+
+// Progress reports of a running engine, called on the search thread
+class SearchObserver {
+
+    public:
+        virtual ~SearchObserver() {}
+
+        virtual void onOpen(const std::pair<i32, i32>& cell, i64 f) { (void)cell; (void)f; }
+        virtual void onClose(const std::pair<i32, i32>& cell) { (void)cell; }
+        virtual void onDrop(const std::pair<i32, i32>& cell) { (void)cell; }
+        virtual void onImprove(const SearchResult& result) { (void)result; }
+        virtual bool cancelled() const { return false; }
+
+};
+
+class SearchEngine {
+
+    public:
+        virtual ~SearchEngine() {}
+
+        virtual const char* getName() const = 0;
+        virtual SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) = 0;
+
+};
+
+// Base step cost, entering a cell costs this times the cell's terrain cost
+static constexpr i32 STEP_COST = 10;
+
+// Helpers shared by the engines
+namespace search {
+
+    typedef std::chrono::steady_clock Clock;
+
+    inline i64 manhattan(const std::pair<i32, i32>& a, const std::pair<i32, i32>& b)
+    {
+        return STEP_COST * (i64)(abs(a.first - b.first) + abs(a.second - b.second));
+    }
+
+    inline i64 stepCost(const Grid& grid, const std::pair<i32, i32>& square)
+    {
+        return STEP_COST * grid.getCost(square);
+    }
+
+    inline double millisSince(Clock::time_point t0)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    }
+
+    // Free 4-neighbours of 'current'
+    void adjacentSquares(
+            const Grid& grid,
+            const std::pair<i32, i32>& current,
+            std::vector<std::pair<i32, i32>>& out);
+
+    // Walks 'parents' back from 'target' and stores the path start first
+    void retracePath(
+            const std::pair<i32, i32>& target,
+            const std::unordered_map<std::pair<i32, i32>, std::pair<i32, i32>, pair_hash>& parents,
+            std::vector<std::pair<i32, i32>>& path);
+
+}
+
+// Order of the open list of AStarSearch
+enum Priorities {
+    PRIORITY_ASTAR,     // g + weight * h
+    PRIORITY_DIJKSTRA,  // g, the heuristic is ignored
+    PRIORITY_GREEDY     // h, the cost so far is ignored
+};
+
+// Classic (weighted) A* on the 4-connected grid, and the two best-first
+// searches at either end of it
+class AStarSearch : public SearchEngine {
+
+    private:
+        // Tie braker:
+        // https://theory.stanford.edu/~amitp/GameProgramming/Heuristics.html#breaking-ties
+        static constexpr double TIE_BREAKER = 0.1;
+
+        double weight;
+        short priority;
+        short layout_kind;
+        CellLayout layout;
+
+        struct Node {
+            i64 g;
+            i64 f;
+            i32 parent;     // Slot in 'layout', -1 for the start
+            bool closed;
+        };
+
+        // Scratch of the last search, one record per cell in the order of
+        // 'layout', forgotten in O(1) by the next search
+        StampedArray<Node> nodes;
+
+        // Binary heap ordered like a set of (f, cell). Entries whose cell got
+        // a lower f since are skipped when they come up.
+        std::vector<std::pair<i64, std::pair<i32, i32>>> openHeap;
+
+        std::vector<std::pair<i32, i32>> adjacentSquares;
+
+    public:
+        AStarSearch(double weight = 1.0, short priority = PRIORITY_ASTAR, short layout = LAYOUT_ROWS)
+            : weight(weight), priority(priority), layout_kind(layout) {}
+
+        const char* getName() const override;
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+#endif //SEARCH_HPP
@@ -0,0 +1,682 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "Server.hpp"
+#include "Headless.hpp"
+#include "Protocol.hpp"
+#include "Scene.hpp"
+#include "SubgoalGraph.hpp"
+#include "PathDatabase.hpp"
+
+using namespace protocol;
+
+// epoll tags of the fds that are not connections, connection ids start above
+enum ServerTags {
+    TAG_LISTEN,
+    TAG_EVENTS,
+    TAG_SIGNALS,
+    TAG_FIRST_CONNECTION
+};
+
+static std::runtime_error systemError(const std::string& what)
+{
+    return std::runtime_error(what + ": " + strerror(errno));
+}
+
+static void addFd(int epoll_fd, int fd, u32 events, u64 tag)
+{
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = tag;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        throw systemError("epoll_ctl");
+    }
+}
+
+Server::Server(const std::string& socket_path, u32 threads, const EngineConfig& engine_config)
+    : socket_path(socket_path), engine_config(engine_config)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + socket_path);
+    }
+    strcpy(address.sun_path, socket_path.c_str());
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) throw systemError("socket");
+
+    // A socket file nobody listens on is left over from a daemon that died
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0) {
+        bool alive = connect(probe, (sockaddr*)&address, sizeof(address)) == 0;
+        ::close(probe);
+        if (alive) {
+            throw std::runtime_error(socket_path + " is served already");
+        }
+    }
+    unlink(socket_path.c_str());
+
+    if (bind(listen_fd, (sockaddr*)&address, sizeof(address)) != 0) throw systemError("bind " + socket_path);
+    if (listen(listen_fd, SOMAXCONN) != 0) throw systemError("listen");
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || event_fd < 0) throw systemError("epoll");
+
+    // Blocked before the workers start, so they inherit the mask and the
+    // signals are only ever read from the signalfd
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) throw systemError("signalfd");
+
+    addFd(epoll_fd, listen_fd, EPOLLIN, TAG_LISTEN);
+    addFd(epoll_fd, event_fd,  EPOLLIN, TAG_EVENTS);
+    addFd(epoll_fd, signal_fd, EPOLLIN, TAG_SIGNALS);
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (u32 t = 0; t < threads; t++) {
+        workers.emplace_back([this] { work(); });
+    }
+
+    next_connection = TAG_FIRST_CONNECTION;
+    latencies_us.reserve(LATENCY_SAMPLES);
+}
+
+Server::~Server()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        stopping = true;
+    }
+    job_ready.notify_all();
+    for (auto& w : workers) w.join();
+
+    for (auto& [id, connection] : connections) ::close(connection.fd);
+
+    for (int fd : {listen_fd, epoll_fd, event_fd, signal_fd}) {
+        if (fd >= 0) ::close(fd);
+    }
+
+    if (listen_fd >= 0) unlink(socket_path.c_str());
+}
+
+u32 Server::addMap(Grid grid, const std::string& data_path)
+{
+    auto map = std::make_shared<Map>();
+    map->grid = std::move(grid);
+    map->components.build(map->grid);
+    map->data_path = data_path;
+
+    std::lock_guard<std::mutex> lock(maps_mutex);
+    maps.push_back(std::move(map));
+    return (u32)maps.size() - 1;
+}
+
+u32 Server::loadMap(const std::string& path)
+{
+    // One map per file, however it is named
+    char* resolved = realpath(path.c_str(), nullptr);
+    std::string key = resolved ? resolved : path;
+    free(resolved);
+
+    auto lookup = [&]() -> i64 {
+        auto it = map_paths.find(key);
+        if (it != map_paths.end()) return it->second;
+        if (maps.size() >= MAX_MAPS) {
+            throw std::runtime_error("No more than " + std::to_string(MAX_MAPS) + " maps can be loaded");
+        }
+        return -1;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(maps_mutex);
+        i64 map = lookup();
+        if (map >= 0) return (u32)map;
+    }
+
+    Scene scene;
+    loadScene(path, scene);
+
+    // The scene keeps its preprocessed data next to it
+    auto loaded = std::make_shared<Map>();
+    loaded->grid = std::move(scene.grid);
+    loaded->components.build(loaded->grid);
+    loaded->data_path = key;
+
+    // Another worker may have loaded it meanwhile
+    std::lock_guard<std::mutex> lock(maps_mutex);
+    i64 map = lookup();
+    if (map >= 0) return (u32)map;
+
+    maps.push_back(std::move(loaded));
+    map_paths[key] = (u32)maps.size() - 1;
+    return (u32)maps.size() - 1;
+}
+
+void Server::work()
+{
+    Engines engines(engineList().size());
+
+    std::unique_lock<std::mutex> lock(jobs_mutex);
+    while (true) {
+        job_ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping) return;
+
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        lock.unlock();
+
+        job(engines);
+
+        lock.lock();
+    }
+}
+
+void Server::submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        jobs.push_back(std::move(job));
+    }
+    job_ready.notify_one();
+}
+
+void Server::deliver(Reply reply)
+{
+    {
+        std::lock_guard<std::mutex> lock(replies_mutex);
+        replies.push_back(std::move(reply));
+    }
+
+    u64 one = 1;
+    if (write(event_fd, &one, sizeof(one)) < 0) {
+        // Only fails if the counter would overflow, the loop wakes up anyway
+    }
+}
+
+void Server::run()
+{
+    started = search::Clock::now();
+
+    epoll_event events[64];
+    bool running = true;
+
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw systemError("epoll_wait");
+        }
+
+        for (int k = 0; k < n; k++) {
+            u64 tag = events[k].data.u64;
+
+            if (tag == TAG_LISTEN) {
+                accept();
+            } else if (tag == TAG_EVENTS) {
+                u64 count;
+                while (read(event_fd, &count, sizeof(count)) > 0) {}
+                collect();
+            } else if (tag == TAG_SIGNALS) {
+                running = false;
+            } else {
+                // A paused connection only reports hang-ups and errors
+                auto it = connections.find(tag);
+                if (it == connections.end()) continue;
+                if (it->second.paused && events[k].events & (EPOLLHUP | EPOLLERR)) {
+                    close(tag);
+                    continue;
+                }
+
+                if (events[k].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(tag);
+                if (events[k].events & EPOLLOUT && connections.count(tag)) send(tag);
+            }
+        }
+
+        // Everything that arrived in this round goes out in as few batches
+        // as keep the workers busy
+        dispatch();
+    }
+}
+
+void Server::accept()
+{
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+
+        u64 id = next_connection++;
+        connections[id].fd = fd;
+        connections[id].events = EPOLLIN;
+        addFd(epoll_fd, fd, EPOLLIN, id);
+    }
+}
+
+void Server::watch(u64 id)
+{
+    Connection& connection = connections.at(id);
+    u32 events = 0;
+    if (!connection.paused) events |= EPOLLIN;
+    if (connection.writing) events |= EPOLLOUT;
+    if (connection.events == events) return;
+    connection.events = events;
+
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = id;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd, &event);
+}
+
+void Server::close(u64 id)
+{
+    auto it = connections.find(id);
+    if (it == connections.end()) return;
+
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    ::close(it->second.fd);
+    connections.erase(it);
+}
+
+void Server::receive(u64 id)
+{
+    Connection& connection = connections.at(id);
+
+    // A chunk at a time, so a full connection stops reading after the
+    // frames it could still take
+    u8 chunk[1 << 16];
+    while (!connection.paused) {
+        ssize_t n = recv(connection.fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            connection.in.insert(connection.in.end(), chunk, chunk + n);
+            if (!parse(id)) return;
+            continue;
+        }
+
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close(id);
+            return;
+        }
+        if (errno != EINTR) break;
+    }
+
+    if (!connection.out.empty()) send(id);
+}
+
+bool Server::parse(u64 id)
+{
+    Connection& connection = connections.at(id);
+
+    size_t pos = 0;
+    const std::vector<u8>& in = connection.in;
+    while (in.size() - pos >= 4 && !connection.full()) {
+        u32 size = get32(&in[pos]);
+        if (size < HEADER_SIZE - 4 || size > MAX_FRAME) {
+            close(id);
+            return false;
+        }
+        if (in.size() - pos - 4 < size) break;
+
+        const u8* frame = &in[pos];
+        handle(id, frame[4], get32(frame + 8), frame + HEADER_SIZE, size - (HEADER_SIZE - 4));
+        pos += 4 + size;
+    }
+
+    connection.in.erase(connection.in.begin(), connection.in.begin() + pos);
+
+    // The rest waits in 'in' until replies were taken
+    if (connection.full() && !connection.paused) {
+        connection.paused = true;
+        watch(id);
+    }
+
+    return true;
+}
+
+void Server::resume(u64 id)
+{
+    Connection& connection = connections.at(id);
+    if (!connection.paused || connection.full()) return;
+
+    connection.paused = false;
+    watch(id);
+
+    // Frames read before the pause go out with this round, the socket is
+    // read again on its next EPOLLIN
+    parse(id);
+}
+
+void Server::send(u64 id)
+{
+    Connection& connection = connections.at(id);
+
+    while (connection.written < connection.out.size()) {
+        ssize_t n = ::send(connection.fd, connection.out.data() + connection.written,
+                connection.out.size() - connection.written, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Sent bytes are dropped once they are half the buffer, so
+                // it does not grow while the client keeps a backlog
+                if (connection.written >= connection.out.size() / 2) {
+                    connection.out.erase(connection.out.begin(), connection.out.begin() + connection.written);
+                    connection.written = 0;
+                }
+
+                connection.writing = true;
+                watch(id);
+                resume(id);
+                return;
+            }
+            close(id);
+            return;
+        }
+        connection.written += n;
+    }
+
+    connection.out.clear();
+    connection.written = 0;
+    connection.writing = false;
+    watch(id);
+    resume(id);
+}
+
+void Server::fail(u64 id, u32 request, const std::string& message)
+{
+    errors++;
+    putError(connections.at(id).out, request, message);
+}
+
+void Server::handle(u64 id, u8 type, u32 request, const u8* payload, u32 size)
+{
+    switch (type) {
+        case MSG_QUERY: {
+            if (size != QUERY_SIZE) {
+                fail(id, request, "malformed query");
+                return;
+            }
+
+            u32 map = get32(payload);
+            {
+                std::lock_guard<std::mutex> lock(maps_mutex);
+                if (map >= maps.size()) {
+                    fail(id, request, "unknown map " + std::to_string(map));
+                    return;
+                }
+            }
+
+            Query query;
+            query.connection = id;
+            query.id     = request;
+            query.engine = payload[4];
+            query.flags  = payload[5];
+            query.query.start  = {(i32)get32(payload + 8),  (i32)get32(payload + 12)};
+            query.query.target = {(i32)get32(payload + 16), (i32)get32(payload + 20)};
+            query.query.budget_ms = get32(payload + 24) / 1000.0;
+            query.arrived = search::Clock::now();
+
+            if (query.engine >= engineList().size()) {
+                fail(id, request, "unknown engine " + std::to_string(query.engine));
+                return;
+            }
+
+            connections.at(id).in_flight++;
+            pending[map].push_back(query);
+            break;
+        }
+
+        case MSG_LOAD: {
+            std::string path((const char*)payload, size);
+
+            // Loading a large scene takes a while, it runs on a worker
+            connections.at(id).in_flight++;
+            submit([this, id, request, path](Engines&) {
+                Reply reply;
+                reply.connection = id;
+                reply.requests = 1;
+
+                try {
+                    u32 map = loadMap(path);
+                    std::pair<i32, i32> dimensions;
+                    {
+                        std::lock_guard<std::mutex> lock(maps_mutex);
+                        dimensions = maps[map]->grid.getDimensions();
+                    }
+                    auto [width, height] = dimensions;
+
+                    size_t frame = beginFrame(reply.frames, MSG_LOAD | MSG_REPLY, request);
+                    put32(reply.frames, map);
+                    put32(reply.frames, (u32)width);
+                    put32(reply.frames, (u32)height);
+                    endFrame(reply.frames, frame);
+                } catch (const std::exception& e) {
+                    putError(reply.frames, request, e.what());
+                }
+
+                deliver(std::move(reply));
+            });
+            break;
+        }
+
+        case MSG_STATS:
+            answerStats(id, request);
+            break;
+
+        default:
+            fail(id, request, "unknown message type " + std::to_string(type));
+    }
+}
+
+void Server::dispatch()
+{
+    for (auto& [map_id, queries] : pending) {
+        std::shared_ptr<Map> map;
+        {
+            std::lock_guard<std::mutex> lock(maps_mutex);
+            map = maps[map_id];
+        }
+
+        size_t per = (queries.size() + workers.size() - 1) / workers.size();
+        per = std::min(std::max<size_t>(per, 1), MAX_BATCH);
+
+        for (size_t first = 0; first < queries.size(); first += per) {
+            Batch batch;
+            batch.map = map;
+            batch.queries.assign(queries.begin() + first,
+                    queries.begin() + std::min(first + per, queries.size()));
+
+            batches++;
+            batched_queries += batch.queries.size();
+
+            submit([this, batch](Engines& engines) mutable {
+                std::vector<Reply> out;
+                runBatch(batch, engines, out);
+                for (auto& reply : out) deliver(std::move(reply));
+            });
+        }
+    }
+
+    pending.clear();
+}
+
+void Server::share(Map& map, SearchEngine& engine)
+{
+    if (auto* subgoals = dynamic_cast<SubgoalSearch*>(&engine)) {
+        std::lock_guard<std::mutex> lock(map.mutex);
+        if (!map.subgoals)
+            map.subgoals = SubgoalSearch::graphOf(map.grid, map.data_path.empty() ? "" : map.data_path + ".ssg");
+        subgoals->adopt(map.grid, map.subgoals);
+    }
+
+    if (auto* database = dynamic_cast<PathDatabaseSearch*>(&engine)) {
+        std::lock_guard<std::mutex> lock(map.mutex);
+        if (!map.database_ready) {
+            map.database = PathDatabaseSearch::databaseOf(map.grid, map.data_path.empty() ? "" : map.data_path + ".cpd");
+            map.database_ready = true;
+        }
+        database->adopt(map.grid, map.database);
+    }
+}
+
+void Server::runBatch(const Batch& batch, Engines& engines, std::vector<Reply>& out)
+{
+    Map& map = *batch.map;
+    const Grid& grid = map.grid;
+    std::vector<bool> shared(engines.size());
+
+    for (const Query& q : batch.queries) {
+        SearchResult result;
+        u8 status = STATUS_INVALID;
+        if (!grid.isObstacle(q.query.start) && !grid.isObstacle(q.query.target)) {
+            // Across components there is no path, and no engine has to search
+            // the whole start component to find that out
+            status = STATUS_NO_PATH;
+            if (map.components.sameComponent(q.query.start, q.query.target)) {
+                auto& engine = engines[q.engine];
+                if (!engine) engine = createEngine(engineList()[q.engine].name, engine_config);
+                if (!shared[q.engine]) {
+                    share(map, *engine);
+                    shared[q.engine] = true;
+                }
+
+                result = engine->search(grid, q.query);
+                status = result.timed_out ? STATUS_TIMED_OUT : result.found ? STATUS_FOUND : STATUS_NO_PATH;
+            }
+        }
+
+        // Replies to one connection travel together
+        auto reply = std::find_if(out.begin(), out.end(),
+                [&](const Reply& r) { return r.connection == q.connection; });
+        if (reply == out.end()) {
+            out.push_back({q.connection, {}, {}, 0});
+            reply = out.end() - 1;
+        }
+
+        std::vector<u8>& frames = reply->frames;
+        size_t frame = beginFrame(frames, MSG_QUERY | MSG_REPLY, q.id);
+        put8(frames, status);
+        put8(frames, 0);
+        put8(frames, 0);
+        put8(frames, 0);
+        put64(frames, (u64)result.cost);
+        put32(frames, (u32)result.expanded);
+
+        bool path = q.flags & FLAG_PATH && (HEADER_SIZE + RESULT_SIZE + 8 * result.path.size() <= MAX_FRAME);
+        put32(frames, path ? (u32)result.path.size() : 0);
+        if (path) {
+            for (const auto& cell : result.path) {
+                put32(frames, (u32)cell.first);
+                put32(frames, (u32)cell.second);
+            }
+        }
+        endFrame(frames, frame);
+
+        reply->arrived.push_back(q.arrived);
+        reply->requests++;
+    }
+}
+
+void Server::collect()
+{
+    std::vector<Reply> ready;
+    {
+        std::lock_guard<std::mutex> lock(replies_mutex);
+        ready.swap(replies);
+    }
+
+    auto now = search::Clock::now();
+
+    for (auto& reply : ready) {
+        for (auto arrived : reply.arrived) {
+            u32 us = (u32)std::chrono::duration_cast<std::chrono::microseconds>(now - arrived).count();
+            if (latencies_us.size() < LATENCY_SAMPLES) {
+                latencies_us.push_back(us);
+            } else {
+                latencies_us[latency_next] = us;
+            }
+            latency_next = (latency_next + 1) % LATENCY_SAMPLES;
+        }
+        queries_answered += reply.arrived.size();
+
+        auto it = connections.find(reply.connection);
+        if (it == connections.end()) continue;
+
+        it->second.in_flight -= reply.requests;
+
+        auto& out = it->second.out;
+        out.insert(out.end(), reply.frames.begin(), reply.frames.end());
+        send(reply.connection);
+    }
+}
+
+void Server::answerStats(u64 id, u32 request)
+{
+    std::vector<u32> sorted = latencies_us;
+    std::sort(sorted.begin(), sorted.end());
+
+    auto percentile = [&](double p) -> double {
+        if (sorted.empty()) return 0.0;
+        return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+    };
+
+    double uptime = std::chrono::duration<double>(search::Clock::now() - started).count();
+
+    u32 map_count;
+    {
+        std::lock_guard<std::mutex> lock(maps_mutex);
+        map_count = (u32)maps.size();
+    }
+
+    std::vector<u8>& out = connections.at(id).out;
+    size_t frame = beginFrame(out, MSG_STATS | MSG_REPLY, request);
+    put64(out, queries_answered);
+    put64(out, batches);
+    put64(out, errors);
+    putDouble(out, uptime);
+    putDouble(out, uptime > 0 ? queries_answered / uptime : 0.0);
+    putDouble(out, batches ? (double)batched_queries / batches : 0.0);
+    putDouble(out, percentile(0.5));
+    putDouble(out, percentile(0.9));
+    putDouble(out, percentile(0.99));
+    putDouble(out, percentile(0.999));
+    putDouble(out, sorted.empty() ? 0.0 : sorted.back());
+    put32(out, (u32)workers.size());
+    put32(out, map_count);
+    endFrame(out, frame);
+}
+
+int runServer(const Options& options)
+{
+    Grid grid;
+    SearchQuery query;
+    std::mt19937 rng(options.seed);
+    buildMap(options, grid, query, rng);
+
+    auto [width, height] = grid.getDimensions();
+
+    Server server(options.serve, options.threads, options.engine_config);
+    // Without a data path the map's scene names its preprocessed files
+    server.addMap(std::move(grid), options.engine_config.data_path.empty() ? options.scene : options.engine_config.data_path);
+
+    printf("Serving map 0 (%dx%d) on %s\n", width, height, options.serve.c_str());
+    fflush(stdout);
+
+    server.run();
+
+    return EXIT_SUCCESS;
+}
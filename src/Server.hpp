@@ -0,0 +1,181 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Components.hpp"
+#include "Engines.hpp"
+#include "Options.hpp"
+#include "Search.hpp"
+
+class SubgoalGraph;
+class PathDatabase;
+
+// Query daemon: keeps maps resident and answers path queries over a Unix
+// domain socket, in the format of Protocol.hpp.
+//
+// One thread runs an epoll loop over the listening socket, the clients, an
+// eventfd the workers signal and a signalfd for SIGINT and SIGTERM. Queries
+// read in the same round of the loop are grouped by map and cut into
+// batches, one per worker at most, so a burst keeps the whole pool busy
+// while single queries go out right away. Workers keep one engine of each
+// kind with its scratch memory between batches, while preprocessed data is
+// built once per map and shared by all of them.
+//
+// A client with MAX_IN_FLIGHT requests unanswered or MAX_QUEUED bytes of
+// replies it has not read is not read from until it catches up.
+class Server {
+
+    private:
+        struct Connection {
+            int fd;
+            std::vector<u8> in;
+            std::vector<u8> out;
+            size_t written = 0;     // Bytes of 'out' already sent
+            u32 in_flight = 0;      // Requests queued or running on a worker
+            bool writing = false;   // Waiting for EPOLLOUT
+            bool paused = false;    // Not waiting for EPOLLIN
+            u32 events = 0;         // Registered with epoll
+
+            inline bool full() const { return in_flight >= MAX_IN_FLIGHT || out.size() - written >= MAX_QUEUED; }
+        };
+
+        struct Query {
+            u64 connection;
+            u32 id;
+            u8 engine;
+            u8 flags;
+            SearchQuery query;
+            search::Clock::time_point arrived;
+        };
+
+        // A resident map and the data engines derive from it
+        struct Map {
+            Grid grid;
+            Components components;  // Built with the map, which never changes after
+            std::string data_path;  // Preprocessed files, this plus .ssg or .cpd, empty for none
+
+            std::mutex mutex;       // Held while the data below is prepared
+            std::shared_ptr<const SubgoalGraph> subgoals;
+            std::shared_ptr<const PathDatabase> database;   // Null if the map is too large
+            bool database_ready = false;
+        };
+
+        struct Batch {
+            std::shared_ptr<Map> map;
+            std::vector<Query> queries;
+        };
+
+        // Encoded replies of a batch, for one connection each
+        struct Reply {
+            u64 connection;
+            std::vector<u8> frames;
+            std::vector<search::Clock::time_point> arrived;     // One per query answered
+            u32 requests = 0;       // Requests of the connection answered
+        };
+
+        typedef std::vector<std::unique_ptr<SearchEngine>> Engines;
+        typedef std::function<void(Engines&)> Job;
+
+        static constexpr size_t LATENCY_SAMPLES = 1 << 16;
+        static constexpr size_t MAX_BATCH = 256;
+        static constexpr u32 MAX_IN_FLIGHT = 256;
+        static constexpr size_t MAX_QUEUED = 4 << 20;
+        static constexpr size_t MAX_MAPS = 64;
+
+        std::string socket_path;
+        EngineConfig engine_config;
+
+        int listen_fd = -1;
+        int epoll_fd = -1;
+        int event_fd = -1;      // Written by the workers once replies are ready
+        int signal_fd = -1;
+
+        std::unordered_map<u64, Connection> connections;
+        u64 next_connection;
+
+        // Parsed in the current round of the loop, by map
+        std::unordered_map<u32, std::vector<Query>> pending;
+
+        std::mutex maps_mutex;
+        std::vector<std::shared_ptr<Map>> maps;
+        std::unordered_map<std::string, u32> map_paths;    // Maps loaded by clients, by real path
+
+        // Worker pool
+        std::vector<std::thread> workers;
+        std::deque<Job> jobs;
+        bool stopping = false;
+        std::mutex jobs_mutex;
+        std::condition_variable job_ready;
+
+        std::mutex replies_mutex;
+        std::vector<Reply> replies;
+
+        // Statistics, only touched by the loop
+        search::Clock::time_point started;
+        u64 queries_answered = 0;
+        u64 batches = 0;
+        u64 batched_queries = 0;
+        u64 errors = 0;
+        std::vector<u32> latencies_us;  // Ring of the latest latencies
+        size_t latency_next = 0;
+
+        void work();
+        void submit(Job job);
+        void deliver(Reply reply);
+
+        void accept();
+        void receive(u64 id);
+        void send(u64 id);
+        void close(u64 id);
+        void watch(u64 id);
+        bool parse(u64 id);
+        void resume(u64 id);
+
+        void handle(u64 id, u8 type, u32 request, const u8* payload, u32 size);
+        void dispatch();
+        void collect();
+        void answerStats(u64 id, u32 request);
+        void fail(u64 id, u32 request, const std::string& message);
+
+        void runBatch(const Batch& batch, Engines& engines, std::vector<Reply>& out);
+
+        // Hands 'engine' the preprocessed data of 'map', preparing it first
+        // if no worker did yet
+        void share(Map& map, SearchEngine& engine);
+
+        // Map of the scene in 'path', loaded unless it was before. Throws
+        // std::runtime_error if it cannot be or MAX_MAPS are loaded already.
+        u32 loadMap(const std::string& path);
+
+    public:
+        // Binds the socket and starts the workers, 0 threads for one per core
+        Server(const std::string& socket_path, u32 threads, const EngineConfig& engine_config);
+        ~Server();
+
+        Server(const Server&) = delete;
+        Server& operator=(const Server&) = delete;
+
+        // Returns the id queries refer to the map by. Preprocessed data of
+        // the map is kept in 'data_path' plus the engine's extension.
+        u32 addMap(Grid grid, const std::string& data_path = "");
+
+        // Serves until SIGINT or SIGTERM
+        void run();
+
+};
+
+// Loads the map described by 'options' as map 0 and serves on
+// 'options.serve'. Returns the process exit code.
+int runServer(const Options& options);
+
+#endif //SERVER_HPP
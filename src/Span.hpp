@@ -0,0 +1,67 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include "Util.hpp"
+
+// Read-only views into storage owned by somebody else, for handing out
+// engine state without copying it. A view is only valid as long as the
+// storage is left alone, callers keep whatever lock guards it.
+
+// Contiguous elements
+template<class T>
+class Span {
+
+    private:
+        const T* first = nullptr;
+        size_t count = 0;
+
+    public:
+        Span() {}
+        Span(const T* first, size_t count) : first(first), count(count) {}
+        Span(const std::vector<T>& v) : first(v.data()), count(v.size()) {}
+
+        inline const T* begin() const { return first; }
+        inline const T* end()   const { return first + count; }
+        inline size_t size()  const { return count; }
+        inline bool   empty() const { return count == 0; }
+        inline const T& operator[](size_t k) const { return first[k]; }
+        inline const T& front() const { return first[0]; }
+        inline const T& back()  const { return first[count - 1]; }
+
+};
+
+// Row-major cell indices of a grid 'width' wide, iterated as cells
+class CellSpan {
+
+    private:
+        Span<i32> indices;
+        i32 width = 1;
+
+    public:
+        class Iterator {
+
+            private:
+                const i32* at;
+                i32 width;
+
+            public:
+                Iterator(const i32* at, i32 width) : at(at), width(width) {}
+
+                inline std::pair<i32, i32> operator*() const { return {*at % width, *at / width}; }
+                inline Iterator& operator++() { at++; return *this; }
+                inline bool operator!=(const Iterator& other) const { return at != other.at; }
+                inline bool operator==(const Iterator& other) const { return at == other.at; }
+
+        };
+
+        CellSpan() {}
+        CellSpan(Span<i32> indices, i32 width) : indices(indices), width(width) {}
+
+        inline Iterator begin() const { return {indices.begin(), width}; }
+        inline Iterator end()   const { return {indices.end(),   width}; }
+        inline size_t size()  const { return indices.size(); }
+        inline bool   empty() const { return indices.empty(); }
+
+};
+
+#endif //SPAN_HPP
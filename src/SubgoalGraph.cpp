@@ -0,0 +1,430 @@
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#include "SubgoalGraph.hpp"
+#include "AtomicFile.hpp"
+
+static const char MAGIC[4] = {'A', 'S', 'S', 'G'};
+static constexpr u16 VERSION = 1;
+
+static constexpr i32 PARALLEL_MIN_CELLS = 1 << 16;
+
+// Subgoals a worker takes at a time while joining them
+static constexpr u32 CHUNK = 256;
+
+void SubgoalGraph::indexCells()
+{
+    id_of.assign((size_t)width * height, -1);
+    for (u32 s = 0; s < cells.size(); s++) id_of[cells[s]] = s;
+}
+
+void SubgoalGraph::build(const Grid& grid, u32 threads)
+{
+    auto t0 = search::Clock::now();
+
+    width  = grid.getWidth();
+    height = grid.getHeight();
+    fingerprint = grid.fingerprint();
+
+    u8 lowest = grid.minCost();
+    cost = lowest == grid.maxCost() ? lowest : 0;
+
+    cells.clear();
+    first.assign(1, 0);
+    edges.clear();
+    id_of.clear();
+
+    if (!usable()) {
+        build_ms = search::millisSince(t0);
+        return;
+    }
+
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if ((i64)width * height < PARALLEL_MIN_CELLS) threads = 1;
+    threads = std::min<u32>(threads, std::max(height, 1));
+
+    auto parallel = [&](auto&& work) {
+        std::vector<std::thread> workers;
+        for (u32 t = 1; t < threads; t++) workers.emplace_back(work, t);
+        work(0);
+
+        for (auto& w : workers) w.join();
+    };
+
+    auto free = [&](i32 x, i32 y) { return !grid.isObstacle({x, y}); };
+
+    // Subgoals by bands of rows, each band lists its own in row-major order
+    std::vector<std::vector<u32>> found(threads);
+    parallel([&](u32 t) {
+        i32 y0 = height * t / threads, y1 = height * (t + 1) / threads;
+        for (i32 y = y0; y < y1; y++) {
+            for (i32 x = 0; x < width; x++) {
+                if (!free(x, y)) continue;
+
+                bool corner = false;
+                for (i32 d = 0; d < 4; d++) {
+                    i32 dx = d & 1 ? 1 : -1, dy = d & 2 ? 1 : -1;
+                    corner |= !free(x + dx, y + dy) && free(x + dx, y) && free(x, y + dy);
+                }
+                if (corner) found[t].push_back((u32)(y * width + x));
+            }
+        }
+    });
+
+    for (const auto& band : found) cells.insert(cells.end(), band.begin(), band.end());
+    found.clear();
+    indexCells();
+
+    // Edges of every subgoal, chunks of consecutive subgoals are handed out
+    // in order so each chunk's edges land in one piece
+    u32 count = (u32)cells.size();
+    u32 chunks = (count + CHUNK - 1) / CHUNK;
+    std::vector<std::vector<Edge>> chunk_edges(chunks);
+    first.assign(count + 1, 0);
+
+    std::atomic<u32> next{0};
+    parallel([&](u32) {
+        Sweep scratch;
+        std::vector<u32> seen(count, UINT32_MAX);
+
+        for (u32 c = next++; c < chunks; c = next++) {
+            auto& out = chunk_edges[c];
+            for (u32 s = c * CHUNK; s < std::min(count, (c + 1) * CHUNK); s++) {
+                size_t before = out.size();
+                sweep(grid, cellOf(s), -1, scratch, [&](i32 id, u32 length) {
+                    if (seen[id] == s) return;
+                    seen[id] = s;
+                    out.push_back({(u32)id, length});
+                });
+                first[s + 1] = (u32)(out.size() - before);
+            }
+        }
+    });
+
+    for (u32 s = 0; s < count; s++) first[s + 1] += first[s];
+
+    edges.resize(first[count]);
+    for (u32 c = 0; c < chunks; c++) {
+        std::copy(chunk_edges[c].begin(), chunk_edges[c].end(), edges.begin() + first[c * CHUNK]);
+    }
+
+    build_ms = search::millisSince(t0);
+}
+
+void SubgoalGraph::save(const std::string& path) const
+{
+    AtomicFile file(path);
+
+    u16 version = VERSION, reserved = 0;
+    u32 stored_cost = cost, count = (u32)cells.size();
+    u64 edge_count = edges.size();
+
+    auto put = [&](const void* data, size_t size) { file.write(data, size); };
+    put(MAGIC, 4);
+    put(&version, 2);
+    put(&reserved, 2);
+    put(&width, 4);
+    put(&height, 4);
+    put(&fingerprint, 8);
+    put(&stored_cost, 4);
+    put(&count, 4);
+    put(&edge_count, 8);
+    put(cells.data(), cells.size() * sizeof(u32));
+    put(first.data(), first.size() * sizeof(u32));
+    put(edges.data(), edges.size() * sizeof(Edge));
+
+    file.commit();
+}
+
+bool SubgoalGraph::load(const std::string& path, const Grid& grid)
+{
+    auto t0 = search::Clock::now();
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    char magic[4];
+    u16 version, reserved;
+    i32 w, h;
+    u64 stored_fingerprint, edge_count;
+    u32 stored_cost, count;
+
+    auto get = [&](void* data, size_t size) { return (bool)file.read((char*)data, size); };
+    if (!get(magic, 4) || memcmp(magic, MAGIC, 4) != 0) return false;
+    if (!get(&version, 2) || version != VERSION || !get(&reserved, 2)) return false;
+    if (!get(&w, 4) || !get(&h, 4) || w != grid.getWidth() || h != grid.getHeight()) return false;
+    if (!get(&stored_fingerprint, 8) || stored_fingerprint != grid.fingerprint()) return false;
+    if (!get(&stored_cost, 4) || !get(&count, 4) || !get(&edge_count, 8)) return false;
+
+    // Larger counts than the grid allows are taken as a damaged file
+    u64 area = (u64)w * h;
+    if (stored_cost > 255 || count > area || edge_count > area * area) return false;
+
+    std::vector<u32> new_cells(count), new_first(count + 1);
+    std::vector<Edge> new_edges(edge_count);
+    if (!get(new_cells.data(), count * sizeof(u32))
+            || !get(new_first.data(), (count + 1) * sizeof(u32))
+            || !get(new_edges.data(), edge_count * sizeof(Edge))) {
+        return false;
+    }
+
+    if (new_first[0] != 0 || new_first[count] != edge_count) return false;
+    for (u32 s = 0; s < count; s++) {
+        if (new_cells[s] >= area || new_first[s] > new_first[s + 1]) return false;
+    }
+    for (const auto& edge : new_edges) {
+        if (edge.to >= count) return false;
+    }
+
+    width  = w;
+    height = h;
+    fingerprint = stored_fingerprint;
+    cost  = (u8)stored_cost;
+    cells = std::move(new_cells);
+    first = std::move(new_first);
+    edges = std::move(new_edges);
+    indexCells();
+
+    build_ms = search::millisSince(t0);
+
+    return true;
+}
+
+void SubgoalGraph::refine(
+        const Grid& grid,
+        const std::pair<i32, i32>& a,
+        const std::pair<i32, i32>& b,
+        std::vector<std::pair<i32, i32>>& path,
+        std::vector<u8>& scratch) const
+{
+    i32 sx = b.first > a.first ? 1 : -1;
+    i32 sy = b.second > a.second ? 1 : -1;
+    i32 w = abs(b.first - a.first) + 1;
+    i32 h = abs(b.second - a.second) + 1;
+
+    auto straight = [&](std::pair<i32, i32> cell, bool x_first) {
+        for (i32 leg = 0; leg < 2; leg++) {
+            bool along_x = (leg == 0) == x_first;
+            i32 steps = along_x ? w - 1 : h - 1;
+            for (i32 k = 0; k < steps; k++) {
+                (along_x ? cell.first : cell.second) += along_x ? sx : sy;
+                if (grid.isObstacle(cell)) return false;
+            }
+        }
+        return true;
+    };
+
+    // Most segments run along one of the two sides of their box
+    for (bool x_first : {true, false}) {
+        if (!straight(a, x_first)) continue;
+
+        auto cell = a;
+        for (i32 leg = 0; leg < 2; leg++) {
+            bool along_x = (leg == 0) == x_first;
+            i32 steps = along_x ? w - 1 : h - 1;
+            for (i32 k = 0; k < steps; k++) {
+                (along_x ? cell.first : cell.second) += along_x ? sx : sy;
+                path.push_back(cell);
+            }
+        }
+        return;
+    }
+
+    // Otherwise, every cell of the box that still leads on to 'b', back
+    // from 'b', then a walk from 'a' that never leaves them
+    scratch.assign((size_t)w * h, 0);
+    auto at = [&](i32 i, i32 j) -> u8& { return scratch[(size_t)j * w + i]; };
+
+    for (i32 j = h - 1; j >= 0; j--) {
+        for (i32 i = w - 1; i >= 0; i--) {
+            if (grid.isObstacle({a.first + sx * i, a.second + sy * j})) continue;
+            bool last = i == w - 1 && j == h - 1;
+            at(i, j) = last || (i + 1 < w && at(i + 1, j)) || (j + 1 < h && at(i, j + 1));
+        }
+    }
+
+    i32 i = 0, j = 0;
+    while (i < w - 1 || j < h - 1) {
+        if (i + 1 < w && at(i + 1, j)) {
+            i++;
+        } else {
+            j++;
+        }
+        path.push_back({a.first + sx * i, a.second + sy * j});
+    }
+}
+
+const char* SubgoalSearch::getName() const
+{
+    return "Subgoal graph";
+}
+
+std::shared_ptr<const SubgoalGraph> SubgoalSearch::graphOf(const Grid& grid, const std::string& path)
+{
+    auto graph = std::make_shared<SubgoalGraph>();
+    if (!path.empty() && graph->load(path, grid)) return graph;
+
+    graph->build(grid);
+
+    // The cache is only a shortcut, a search goes on without it
+    if (!path.empty()) {
+        try {
+            graph->save(path);
+        } catch (const std::runtime_error&) {
+        }
+    }
+
+    return graph;
+}
+
+bool SubgoalSearch::prepare(const Grid& grid)
+{
+    if (grid.getId() == grid_id && grid.getEdits() == grid_edits) return false;
+
+    grid_id = grid.getId();
+    grid_edits = grid.getEdits();
+    if (current->matches(grid)) return false;
+
+    current = graphOf(grid, path);
+    return true;
+}
+
+void SubgoalSearch::adopt(const Grid& grid, std::shared_ptr<const SubgoalGraph> graph)
+{
+    current = std::move(graph);
+    grid_id = grid.getId();
+    grid_edits = grid.getEdits();
+}
+
+SearchResult SubgoalSearch::search(
+        const Grid& grid,
+        const SearchQuery& query,
+        SearchObserver* observer)
+{
+    auto t0 = search::Clock::now();
+
+    prepare(grid);
+
+    const SubgoalGraph& graph = *current;
+    if (!graph.usable()) {
+        SearchResult result = fallback.search(grid, query, observer);
+        result.elapsed_ms = search::millisSince(t0);
+        return result;
+    }
+
+    SearchResult result;
+
+    const auto& start  = query.start;
+    const auto& target = query.target;
+    if (!grid.inBounds(start) || !grid.inBounds(target) || grid.isObstacle(start) || grid.isObstacle(target)) {
+        result.elapsed_ms = search::millisSince(t0);
+        return result;
+    }
+
+    i64 unit = STEP_COST * (i64)graph.getCost();
+    i32 count = (i32)graph.size();
+    i32 s = count, t = count + 1;
+    i32 target_index = target.second * grid.getWidth() + target.first;
+
+    auto cellOf = [&](i32 n) { return n == s ? start : n == t ? target : graph.cellOf(n); };
+    auto heuristic = [&](const std::pair<i32, i32>& cell) { return graph.getCost() * search::manhattan(cell, target); };
+
+    // The subgoals next to both ends; the target itself may be in reach
+    to_target.reset(count);
+    if (target != start) {
+        graph.sweep(grid, target, -1, sweep, [&](i32 id, u32 length) { to_target.set(id, length); });
+        i32 own = graph.idOf(target);
+        if (own >= 0) to_target.set(own, 0);
+    }
+
+    from_start.clear();
+    graph.sweep(grid, start, target_index, sweep, [&](i32 id, u32 length) {
+        from_start.push_back({id == SubgoalGraph::GOAL ? t : id, length});
+    });
+    if (start == target) from_start.push_back({t, 0});
+
+    nodes.reset(count + 2);
+    openHeap.clear();
+
+    auto later = std::greater<std::pair<i64, i32>>();
+
+    size_t touched = 1;
+    auto relax = [&](i32 from, i32 to, i64 g) {
+        if (nodes.has(to)) {
+            if (nodes[to].closed || g >= nodes[to].g) return;
+        } else {
+            touched++;
+        }
+
+        i64 f = g + heuristic(cellOf(to));
+        nodes.set(to, {g, f, from, false});
+
+        openHeap.push_back({f, to});
+        std::push_heap(openHeap.begin(), openHeap.end(), later);
+        result.generated++;
+
+        if (observer) observer->onOpen(cellOf(to), f);
+    };
+
+    nodes.set(s, {0, heuristic(start), -1, false});
+    openHeap.push_back({nodes[s].f, s});
+
+    while (!openHeap.empty()) {
+        if (observer && observer->cancelled()) break;
+
+        if (query.budget_ms > 0 && search::millisSince(t0) > query.budget_ms) {
+            result.timed_out = true;
+            break;
+        }
+
+        std::pop_heap(openHeap.begin(), openHeap.end(), later);
+        auto [f, n] = openHeap.back();
+        openHeap.pop_back();
+
+        Node& node = nodes[n];
+        if (node.closed || node.f != f) continue;
+
+        node.closed = true;
+        result.expanded++;
+
+        if (observer) observer->onClose(cellOf(n));
+
+        if (n == t) {
+            result.found = true;
+            result.cost  = node.g;
+            break;
+        }
+
+        i64 g = node.g;
+        if (n == s) {
+            for (const auto& [to, length] : from_start) relax(n, to, g + unit * length);
+            continue;
+        }
+
+        if (to_target.has(n)) relax(n, t, g + unit * to_target[n]);
+        for (auto* edge = graph.edgesBegin(n); edge != graph.edgesEnd(n); edge++) {
+            relax(n, edge->to, g + unit * edge->length);
+        }
+    }
+
+    result.peak_nodes = touched;
+
+    // Subgoals first, then the cells between each two of them
+    if (result.found) {
+        std::vector<i32> chain;
+        for (i32 n = t; n >= 0; n = nodes[n].parent) chain.push_back(n);
+        std::reverse(chain.begin(), chain.end());
+
+        result.path = {start};
+        for (size_t k = 1; k < chain.size(); k++) {
+            graph.refine(grid, cellOf(chain[k - 1]), cellOf(chain[k]), result.path, refine_scratch);
+        }
+    }
+
+    result.elapsed_ms = search::millisSince(t0);
+
+    return result;
+}
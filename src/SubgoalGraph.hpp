@@ -0,0 +1,245 @@
+#ifndef SUBGOAL_GRAPH_HPP
+#define SUBGOAL_GRAPH_HPP
+
+#include <memory>
+#include <string>
+
+#include "Util.hpp"
+#include "Grid.hpp"
+#include "Arena.hpp"
+#include "Search.hpp"
+
+// Simple Subgoal Graph of a 4-connected grid. Its nodes are the subgoals,
+// the free cells diagonal to the corner of an obstacle whose two cells in
+// between are free; every shortest path can be made to bend only at them.
+// Two subgoals are joined if a monotone (Manhattan length) path leads from
+// one to the other without passing another subgoal. A shortest path on the
+// grid then is a shortest path on this graph from the start to the target,
+// both joined to the subgoals they reach the same way.
+//
+// Only grids of one terrain cost have such a graph; for any other grid it
+// stays empty.
+class SubgoalGraph {
+
+    public:
+        struct Edge {
+            u32 to;
+            u32 length;     // In cells
+        };
+
+        // Reach of a monotone sweep. Cells of the current and the previous
+        // row, by their distance from the origin along the row.
+        struct Sweep {
+            std::vector<u8> previous;
+            std::vector<u8> current;
+        };
+
+        static constexpr i32 GOAL = -2;
+
+    private:
+        i32 width  = 0;
+        i32 height = 0;
+        u64 fingerprint = 0;
+        u8 cost = 0;                // Terrain cost of every cell, 0 if they differ
+
+        // Compressed sparse rows: subgoal 's' lies on cell 'cells[s]'
+        // (row-major) and its edges are [first[s], first[s + 1])
+        std::vector<u32> cells;
+        std::vector<u32> first;
+        std::vector<Edge> edges;
+
+        std::vector<i32> id_of;     // Subgoal of every cell, -1 for none
+
+        double build_ms = 0.0;
+
+        void indexCells();
+
+    public:
+        SubgoalGraph() {}
+
+        // 'threads' 0 uses one per core
+        void build(const Grid& grid, u32 threads = 0);
+
+        // Binary files, in the byte order of the host:
+        //
+        //   "ASSG", u16 version, u16 0, i32 width, height, u64 fingerprint,
+        //   u32 cost, u32 subgoals, u64 edges, u32 cells[subgoals],
+        //   u32 first[subgoals + 1], (u32 to, u32 length) edges[edges]
+        //
+        // save() throws std::runtime_error. load() returns false if the file
+        // is missing, damaged or was built for another grid.
+        void save(const std::string& path) const;
+        bool load(const std::string& path, const Grid& grid);
+
+        inline bool matches(const Grid& grid) const
+        {
+            return width == grid.getWidth() && height == grid.getHeight() && fingerprint == grid.fingerprint();
+        }
+
+        // Calls 'visit(id, length)' for every subgoal that a monotone path
+        // from 'origin' reaches without passing another one, more than once
+        // for those straight in line with it. The cell with row-major index
+        // 'goal' counts as a subgoal with id GOAL.
+        template<class F>
+        void sweep(const Grid& grid, const std::pair<i32, i32>& origin, i32 goal, Sweep& scratch, F&& visit) const;
+
+        // Appends the cells after 'a' up to 'b' of a monotone free path
+        // between them
+        void refine(
+                const Grid& grid,
+                const std::pair<i32, i32>& a,
+                const std::pair<i32, i32>& b,
+                std::vector<std::pair<i32, i32>>& path,
+                std::vector<u8>& scratch) const;
+
+        inline bool usable() const { return cost > 0; }
+        inline u8 getCost() const { return cost; }
+        inline size_t size() const { return cells.size(); }
+        inline size_t edgeCount() const { return edges.size(); }
+        inline size_t bytes() const
+            { return (cells.size() + first.size()) * sizeof(u32) + edges.size() * sizeof(Edge) + id_of.size() * sizeof(i32); }
+        inline double getBuildMs() const { return build_ms; }
+
+        inline i32 idOf(const std::pair<i32, i32>& cell) const { return id_of[(size_t)cell.second * width + cell.first]; }
+        inline std::pair<i32, i32> cellOf(u32 id) const { return {(i32)(cells[id] % width), (i32)(cells[id] / width)}; }
+        inline const Edge* edgesBegin(u32 id) const { return edges.data() + first[id]; }
+        inline const Edge* edgesEnd(u32 id) const { return edges.data() + first[id + 1]; }
+
+};
+
+template<class F>
+void SubgoalGraph::sweep(const Grid& grid, const std::pair<i32, i32>& origin, i32 goal, Sweep& scratch, F&& visit) const
+{
+    enum { NONE, PASS, STOP };
+    static const i32 QUADRANTS[4][2] = {{1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+
+    auto& previous = scratch.previous;
+    auto& current  = scratch.current;
+    previous.resize(width + 1);
+    current.resize(width + 1);
+
+    // Marks the cell at (k, j) of the quadrant, stopping at subgoals
+    auto reach = [&](i32 x, i32 y, u32 length) {
+        i32 i = y * width + x;
+        if (i == goal) {
+            visit(GOAL, length);
+            return (u8)STOP;
+        }
+        if (id_of[i] >= 0) {
+            visit(id_of[i], length);
+            return (u8)STOP;
+        }
+        return (u8)PASS;
+    };
+
+    for (const auto& q : QUADRANTS) {
+        i32 dx = q[0], dy = q[1];
+        auto [ox, oy] = origin;
+
+        // The row of the origin, up to the first obstacle or subgoal
+        previous[0] = PASS;
+        i32 lo = 0, hi = 0;
+        for (i32 k = 1; ; k++) {
+            i32 x = ox + dx * k;
+            if (grid.isObstacle({x, oy})) break;
+
+            previous[k] = reach(x, oy, k);
+            if (previous[k] == STOP) break;
+            hi = k;
+        }
+
+        // Every further row is entered from the row before or the cell
+        // before; only cells in [lo, hi] of the row before can pass
+        for (i32 j = 1; ; j++) {
+            i32 y = oy + dy * j;
+            if (y < 0 || y >= height) break;
+
+            i32 next_lo = -1, next_hi = -1;
+            for (i32 k = lo; ; k++) {
+                i32 x = ox + dx * k;
+                if (x < 0 || x >= width) break;
+
+                bool entered = (k <= hi && previous[k] == PASS) || (k > lo && current[k - 1] == PASS);
+                if (!entered || grid.isObstacle({x, y})) {
+                    current[k] = NONE;
+                    if (k >= hi) break;
+                    continue;
+                }
+
+                current[k] = reach(x, y, k + j);
+                if (current[k] == PASS) {
+                    if (next_lo < 0) next_lo = k;
+                    next_hi = k;
+                }
+            }
+
+            if (next_lo < 0) break;
+
+            std::swap(previous, current);
+            lo = next_lo;
+            hi = next_hi;
+        }
+    }
+}
+
+// Searches the subgoal graph of the grid, built on the first search and
+// again whenever the grid changed, or loaded from 'path' if it holds the
+// graph of this grid. A search only compares the grid's id and edit count
+// with those of the last one; a grid it has not seen yet is hashed once to
+// tell whether the graph still fits. Grids of more than one terrain cost are
+// searched with plain A* instead.
+class SubgoalSearch : public SearchEngine {
+
+    private:
+        std::string path;   // Empty keeps the graph in memory only
+        AStarSearch fallback;
+
+        // Graph of the grid last prepared, possibly shared with other engines
+        std::shared_ptr<const SubgoalGraph> current;
+        u64 grid_id = 0;
+        u64 grid_edits = 0;
+
+        struct Node {
+            i64 g;
+            i64 f;
+            i32 parent;     // Node id, -1 for the start
+            bool closed;
+        };
+
+        // Subgoals are nodes 0 to size() - 1, the start and the target follow
+        StampedArray<Node> nodes;
+        StampedArray<u32> to_target;   // Length of the subgoals next to the target
+        std::vector<std::pair<i64, i32>> openHeap;
+
+        std::vector<std::pair<i32, u32>> from_start;
+        SubgoalGraph::Sweep sweep;
+        std::vector<u8> refine_scratch;
+
+    public:
+        SubgoalSearch(const std::string& path = "")
+            : path(path), fallback(1.0), current(std::make_shared<SubgoalGraph>()) {}
+
+        const char* getName() const override;
+
+        // Graph of 'grid', loaded from 'path' if it holds it, else built and
+        // saved there. An empty 'path' only builds.
+        static std::shared_ptr<const SubgoalGraph> graphOf(const Grid& grid, const std::string& path);
+
+        // Loads or builds the graph unless it matches 'grid' already.
+        // Returns true if it did.
+        bool prepare(const Grid& grid);
+
+        // Searches 'grid' with a graph prepared for it elsewhere, so engines
+        // on several threads can share one
+        void adopt(const Grid& grid, std::shared_ptr<const SubgoalGraph> graph);
+
+        inline const SubgoalGraph& getGraph() const { return *current; }
+
+        SearchResult search(
+                const Grid& grid,
+                const SearchQuery& query,
+                SearchObserver* observer = nullptr) override;
+
+};
+
+#endif //SUBGOAL_GRAPH_HPP
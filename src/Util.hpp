@@ -1,6 +1,7 @@
 #ifndef UTIL_HPP
 #define UTIL_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <utility>
 #include <set>
@@ -12,8 +13,12 @@
 #include <algorithm>
 #include <thread>
 
-typedef  int32_t i32;
-typedef uint32_t u32;
+typedef   uint8_t u8;
+typedef  uint16_t u16;
+typedef   int32_t i32;
+typedef  uint32_t u32;
+typedef   int64_t i64;
+typedef  uint64_t u64;
 
 struct pair_hash {
     template <class T1, class T2>
@@ -2,12 +2,19 @@
 
 Visualization::Visualization()
 {
-    aStar = AStar({0, 0}, {BASE_WIDTH - 1, BASE_HEIGHT - 1});
+    aStar.setStart({0, 0});
+    aStar.setTarget({BASE_WIDTH - 1, BASE_HEIGHT - 1});
     aStar.setDimensions({BASE_WIDTH, BASE_HEIGHT});
     aStar.calcDeltaLength(WIDTH, HEIGHT);
     aStar.setSelected(NONE);
     aStar.setDelay(50);
 
+    // Plain A* against both ends of the best-first family and a greedier A*
+    compare_lanes.resize(Comparison::MAX_LANES);
+    compare_lanes[1].engine = "dijkstra";
+    compare_lanes[2].engine = "greedy";
+    compare_lanes[3].config.weight = 2.0;
+
     float color = 70.0f / 255.0f;
     background_color = {color, color, color, 1.0f};
     menu_bar_height = 0;
@@ -55,6 +62,8 @@ void Visualization::InitSdl()
         throw std::runtime_error("Could not create renderer!");
     }
 
+    painter.setRenderer(renderer);
+
     SDL_Surface* icon = IMG_Load("res/aStar.png");
     SDL_SetWindowIcon(window, icon);
     SDL_FreeSurface(icon);
@@ -118,6 +127,10 @@ void Visualization::Update()
     ImGui::NewFrame();
 
     MenuBar();
+
+    if (compare_mode) {
+        CompareTable();
+    }
 }
 
 void Visualization::Render()
@@ -141,8 +154,12 @@ void Visualization::MenuBar()
     menu_open = false;
     if (ImGui::BeginMainMenuBar()) {
         ResizeWindow();
+        FileMenu();
         EditMenu();
         RunMenu();
+        CompareMenu();
+        AgentMenu();
+        ToolMenu();
         GridMenu();
         ColorMenu();
         ImGui::EndMainMenuBar();
@@ -160,6 +177,32 @@ void Visualization::ResizeWindow()
     }
 }
 
+void Visualization::FileMenu()
+{
+    if (ImGui::BeginMenu("File")) {
+        menu_open = true;
+
+        ImGui::InputText("Path", scene_path, sizeof(scene_path));
+
+        if (ImGui::MenuItem("Save Scene", "Ctrl+S")) {
+            OnSaveScene();
+        }
+
+        ImGui::BeginDisabled(compare_mode);
+        if (ImGui::MenuItem("Open Scene", "Ctrl+O")) {
+            OnOpenScene();
+        }
+        ImGui::EndDisabled();
+
+        if (!scene_status.empty()) {
+            ImGui::Separator();
+            ImGui::TextUnformatted(scene_status.c_str());
+        }
+
+        ImGui::EndMenu();
+    }
+}
+
 void Visualization::EditMenu() 
 {
     if (ImGui::BeginMenu("Edit")) {
@@ -177,6 +220,14 @@ void Visualization::EditMenu()
         }
         ImGui::EndDisabled();
 
+        ImGui::Separator();
+
+        i32 limit_kib = (i32)(edit_stack.getMemoryLimit() >> 10);
+        ImGui::SliderInt("History (KiB)", &limit_kib, 16, 16384);
+        edit_stack.setMemoryLimit((size_t)limit_kib << 10);
+
+        ImGui::Text("Used: %zu bytes", edit_stack.getMemoryUsage());
+
         ImGui::EndMenu();
     }
 }
@@ -186,7 +237,7 @@ void Visualization::RunMenu()
     if (ImGui::BeginMenu("Run")) {
         menu_open = true;
         
-        ImGui::BeginDisabled(!aStar.stateEditing());
+        ImGui::BeginDisabled(!aStar.stateEditing() || compare_mode || agent_mode);
         if (ImGui::MenuItem("Run", "Ctrl+R")) {
             aStar.startSimulation();
         }
@@ -215,6 +266,322 @@ void Visualization::RunMenu()
         ImGui::SliderInt("Delay (ms)", &delay, 0, 100);
         aStar.setDelay(delay);
 
+        ImGui::Separator();
+
+        ImGui::BeginDisabled(!aStar.stateEditing());
+        if (ImGui::BeginMenu("Engine")) {
+            for (const auto& engine : engineList()) {
+                if (ImGui::MenuItem(engine.label, nullptr, aStar.getEngine() == engine.name)) {
+                    aStar.setEngine(engine.name);
+                }
+            }
+            ImGui::EndMenu();
+        }
+
+        EngineConfig config = aStar.getEngineConfig();
+        if (aStar.getEngine() == "ara") {
+            float epsilon = (float)config.epsilon;
+            float step    = (float)config.epsilon_step;
+            ImGui::SliderFloat("Initial Epsilon", &epsilon, 1.0f, 10.0f);
+            ImGui::SliderFloat("Epsilon Step", &step, 0.05f, 2.0f);
+            config.epsilon      = epsilon;
+            config.epsilon_step = step;
+        } else if (aStar.getEngine() == "sma") {
+            i32 cap = (i32)config.node_cap;
+            ImGui::SliderInt("Node Cap", &cap, 16, 1 << 20, "%d", ImGuiSliderFlags_Logarithmic);
+            config.node_cap = cap;
+        } else if (aStar.getEngine() == "ida") {
+            i32 size = (i32)config.table_size;
+            ImGui::SliderInt("Table Size", &size, 1, 1 << 20, "%d", ImGuiSliderFlags_Logarithmic);
+            config.table_size = size;
+        }
+        aStar.setEngineConfig(config);
+
+        i32 budget = (i32)aStar.getBudget();
+        ImGui::SliderInt("Budget (ms)", &budget, 0, 10000);
+        aStar.setBudget(budget);
+        ImGui::EndDisabled();
+
+        if (!aStar.getExtraTargets().empty()) {
+            ImGui::Text("Nearest of %zu targets, multi-target A*", aStar.getExtraTargets().size() + 1);
+        }
+
+        if (!aStar.stateEditing()) {
+            ImGui::Text("Epsilon bound: %.3f", aStar.getEpsilonBound());
+        }
+
+        // Memory held against work repeated to stay within it
+        if (aStar.getState() == FINISHED) {
+            SearchResult result = aStar.getLastResult();
+            ImGui::Text("Peak nodes: %zu", result.peak_nodes);
+            ImGui::Text("Reexpanded: %llu of %llu",
+                    (unsigned long long)result.reexpanded, (unsigned long long)result.expanded);
+
+            if (aStar.editedSinceSearch()) {
+                ImGui::TextUnformatted("Map edited during the search");
+            }
+        }
+
+        ImGui::EndMenu();
+    }
+}
+
+void Visualization::CompareMenu()
+{
+    if (ImGui::BeginMenu("Compare")) {
+        menu_open = true;
+
+        ImGui::BeginDisabled(!aStar.stateEditing() || agent_mode);
+        if (ImGui::Checkbox("Compare Mode", &compare_mode) && !compare_mode) {
+            comparison.cancel();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::BeginDisabled(!compare_mode || comparison.running());
+        if (ImGui::MenuItem("Run Comparison", "Ctrl+R")) {
+            StartComparison();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::BeginDisabled(!comparison.running());
+        if (ImGui::MenuItem("Stop", "Ctrl+A")) {
+            comparison.cancel();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::Separator();
+
+        ImGui::BeginDisabled(comparison.running());
+        ImGui::SliderInt("Engines", &compare_count, 2, (i32)Comparison::MAX_LANES);
+
+        for (i32 i = 0; i < compare_count; i++) {
+            LaneConfig& lane = compare_lanes[i];
+            ImGui::PushID(i);
+
+            const char* current = lane.engine.c_str();
+            for (const auto& engine : engineList()) {
+                if (lane.engine == engine.name) current = engine.label;
+            }
+
+            std::string label = "Engine " + std::to_string(i + 1);
+            if (ImGui::BeginCombo(label.c_str(), current)) {
+                for (const auto& engine : engineList()) {
+                    if (ImGui::Selectable(engine.label, lane.engine == engine.name)) {
+                        lane.engine = engine.name;
+                    }
+                }
+                ImGui::EndCombo();
+            }
+
+            if (lane.engine == "astar") {
+                float weight = (float)lane.config.weight;
+                ImGui::SliderFloat("Weight", &weight, 1.0f, 5.0f);
+                lane.config.weight = weight;
+            }
+
+            ImGui::PopID();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::EndMenu();
+    }
+}
+
+void Visualization::StartComparison()
+{
+    comparison.configure(std::vector<LaneConfig>(
+                compare_lanes.begin(), 
+                compare_lanes.begin() + compare_count));
+
+    SearchQuery query;
+    query.start  = aStar.getStart();
+    query.target = aStar.getTarget();
+    query.budget_ms = aStar.getBudget();
+
+    comparison.start(aStar.getGrid(), query, aStar.getDelay());
+}
+
+void Visualization::AgentMenu()
+{
+    if (ImGui::BeginMenu("Agents")) {
+        menu_open = true;
+
+        ImGui::BeginDisabled(!aStar.stateEditing() || compare_mode);
+        ImGui::Checkbox("Agent Mode", &agent_mode);
+        ImGui::EndDisabled();
+
+        ImGui::BeginDisabled(!agent_mode);
+        if (ImGui::MenuItem("Place Randomly")) {
+            PlaceAgents();
+        }
+
+        if (ImGui::MenuItem("Plan", "Ctrl+R")) {
+            PlanAgents();
+        }
+        ImGui::EndDisabled();
+
+        ImGui::Separator();
+
+        ImGui::SliderInt("Agents", &agent_count, 1, 512, "%d", ImGuiSliderFlags_Logarithmic);
+        ImGui::SliderInt("Window", &agent_window, 0, 64);
+        ImGui::SliderInt("Step (ms)", &agent_step_ms, 10, 1000);
+
+        if (!agent_status.empty()) {
+            ImGui::Separator();
+            ImGui::TextUnformatted(agent_status.c_str());
+        }
+
+        if (!agent_plan.paths.empty()) {
+            ImGui::Text("Arrived: %u of %zu", agent_plan.arrived, agent_plan.paths.size());
+            ImGui::Text("Makespan: %u", agent_plan.makespan);
+            ImGui::Text("Sum of costs: %llu", (unsigned long long)agent_plan.sum_of_costs);
+            ImGui::Text("Expanded: %llu in %u replans",
+                    (unsigned long long)agent_plan.expanded, agent_plan.replans);
+            ImGui::Text("Time: %.3f ms", agent_plan.elapsed_ms);
+            ImGui::Text("Conflicts: %llu", (unsigned long long)countConflicts(agent_plan.paths));
+        }
+
+        ImGui::EndMenu();
+    }
+}
+
+// Distinct starts and distinct targets on free cells, each pair in one
+// component of the grid
+void Visualization::PlaceAgents()
+{
+    const Grid& grid = aStar.getGrid();
+    std::uniform_int_distribution<i32> xs(0, grid.getWidth() - 1);
+    std::uniform_int_distribution<i32> ys(0, grid.getHeight() - 1);
+
+    Components components;
+    std::unordered_set<std::pair<i32, i32>, pair_hash> starts, targets;
+
+    agent_tasks.clear();
+    agent_plan = AgentPlan();
+
+    // Gives up on crowded maps instead of looking for the last free cells
+    for (i32 tries = 0; (i32)agent_tasks.size() < agent_count && tries < 100 * agent_count; tries++) {
+        std::pair<i32, i32> from = {xs(agent_rng), ys(agent_rng)};
+        std::pair<i32, i32> to   = {xs(agent_rng), ys(agent_rng)};
+        if (grid.isObstacle(from) || grid.isObstacle(to) || !components.connected(grid, from, to)) continue;
+        if (starts.count(from) || targets.count(to)) continue;
+
+        starts.insert(from);
+        targets.insert(to);
+        agent_tasks.push_back({from, to});
+    }
+
+    agent_status = "Placed " + std::to_string(agent_tasks.size()) + " agents";
+}
+
+void Visualization::PlanAgents()
+{
+    // Places agents first, or again if the grid changed under them
+    bool placed = !agent_tasks.empty();
+    for (const auto& task : agent_tasks) {
+        const Grid& grid = aStar.getGrid();
+        placed = placed && grid.inBounds(task.start) && grid.inBounds(task.target)
+            && !grid.isObstacle(task.start) && !grid.isObstacle(task.target);
+    }
+    if (!placed) PlaceAgents();
+
+    CooperativePlanner planner((u32)agent_window);
+    try {
+        agent_plan = planner.plan(aStar.getGrid(), agent_tasks, aStar.getBudget());
+    } catch (const std::runtime_error& error) {
+        agent_status = error.what();
+        return;
+    }
+
+    agent_status = (agent_window > 0 ? "WHCA*, window " + std::to_string(agent_window) : std::string("Cooperative A*"))
+        + ", table " + std::to_string(planner.reservationBytes() >> 10) + " KiB"
+        + (agent_plan.timed_out ? ", out of time" : "");
+
+    agent_clock = SDL_GetTicks();
+}
+
+void Visualization::CompareTable()
+{
+    ImGui::SetNextWindowPos(ImVec2(10.0f, menu_bar_height + 10.0f), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Comparison", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+
+    // Times leave out the delay, expansions are the same at any speed
+    if (ImGui::BeginTable("lanes", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Engine");
+        ImGui::TableSetupColumn("Expanded");
+        ImGui::TableSetupColumn("Generated");
+        ImGui::TableSetupColumn("Cost");
+        ImGui::TableSetupColumn("Time (ms)");
+        ImGui::TableSetupColumn("First Path (ms)");
+        ImGui::TableHeadersRow();
+
+        for (size_t i = 0; i < comparison.size(); i++) {
+            LaneStats stats = comparison.getStats(i);
+
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s%s", stats.name.c_str(), stats.running ? " ..." : "");
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)stats.expanded);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)stats.generated);
+            ImGui::TableNextColumn();
+            if (stats.found) {
+                ImGui::Text("%lld", (long long)stats.cost);
+            } else {
+                ImGui::TextUnformatted(stats.running ? "" : "no path");
+            }
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", stats.elapsed_ms);
+            ImGui::TableNextColumn();
+            if (stats.solution_ms >= 0) ImGui::Text("%.3f", stats.solution_ms);
+
+            // Name each panel as well
+            SDL_Rect panel = LanePanel(i);
+            ImGui::GetBackgroundDrawList()->AddText(
+                    ImVec2((float)panel.x + 4.0f, (float)panel.y + 2.0f), 
+                    IM_COL32(255, 255, 255, 255), 
+                    stats.name.c_str());
+        }
+
+        ImGui::EndTable();
+    }
+
+    ImGui::End();
+}
+
+void Visualization::ToolMenu()
+{
+    if (ImGui::BeginMenu("Tools")) {
+        menu_open = true;
+
+        int t = tool;
+        ImGui::RadioButton("Brush", &t, TOOL_BRUSH);
+        ImGui::RadioButton("Rectangle", &t, TOOL_RECT);
+        ImGui::RadioButton("Line", &t, TOOL_LINE);
+        ImGui::RadioButton("Flood Fill", &t, TOOL_FLOOD);
+        ImGui::RadioButton("Invert Region", &t, TOOL_INVERT);
+        ImGui::RadioButton("Cost Brush", &t, TOOL_COST);
+        ImGui::RadioButton("Targets", &t, TOOL_TARGETS);
+        tool = t;
+
+        ImGui::Separator();
+
+        ImGui::BeginDisabled(tool != TOOL_COST);
+        ImGui::SliderInt("Cost", &cost_value, 1, 255);
+        ImGui::SliderInt("Radius", &brush_radius, 0, 8);
+        ImGui::EndDisabled();
+
+        ImGui::Separator();
+
+        // Clicks add or remove targets, the search goes to the nearest
+        ImGui::Text("Extra targets: %zu", aStar.getExtraTargets().size());
+        ImGui::BeginDisabled(!aStar.stateEditing() || aStar.getExtraTargets().empty());
+        if (ImGui::MenuItem("Clear Targets")) {
+            aStar.clearTargets();
+        }
+        ImGui::EndDisabled();
+
         ImGui::EndMenu();
     }
 }
@@ -229,7 +596,11 @@ void Visualization::GridMenu()
 
         ImGui::Separator();
 
-        if (ImGui::BeginMenu("Scaling Factor")) {
+        // Only grids of the window's shape scale, resizing any other one
+        // would drop most of it
+        bool scalable = dims.first == BASE_WIDTH * aStar.getScalar()
+            && dims.second == BASE_HEIGHT * aStar.getScalar();
+        if (ImGui::BeginMenu("Scaling Factor", scalable)) {
             int scalar = aStar.getScalar();
             ImGui::RadioButton(" x1", &scalar,  1);
             ImGui::RadioButton(" x2", &scalar,  2);
@@ -238,22 +609,34 @@ void Visualization::GridMenu()
             ImGui::RadioButton(" x8", &scalar,  8);
             ImGui::RadioButton("x10", &scalar, 10);
 
-            aStar.setScalar(scalar);
-            aStar.calcDeltaLength(WIDTH, HEIGHT);
+            if (scalar != aStar.getScalar()) {
+                aStar.setScalar(scalar);
+                aStar.calcDeltaLength(WIDTH, HEIGHT);
+            }
 
             ImGui::EndMenu();
         }
 
         ImGui::BeginDisabled(!aStar.stateEditing());
         if (ImGui::MenuItem("Clear Obstacles", "Ctrl+D")) {
-            auto obsts = aStar.getObstacles();
-            std::vector<std::pair<i32, i32>> data(obsts.begin(), obsts.end());
-            edit_stack.WriteStack(data, DELETE_OBST);
+            OnClearObstacles();
+        }
+        ImGui::EndDisabled();
 
-            aStar.clearObstacles();
+        ImGui::BeginDisabled(!aStar.stateEditing());
+        if (ImGui::MenuItem("Clear Costs")) {
+            aStar.clearCosts();
         }
         ImGui::EndDisabled();
 
+        bool costs = aStar.costsAreShown();
+        ImGui::Checkbox("Cost Heatmap", &costs);
+        aStar.setCostsShown(costs);
+
+        bool flow = aStar.flowIsShown();
+        ImGui::Checkbox("Flow Field", &flow);
+        aStar.setFlowShown(flow);
+
         bool show = aStar.gridIsShown();
         ImGui::Checkbox("Show", &show);
         if (show) aStar.showGrid();
@@ -304,49 +687,91 @@ void Visualization::ColorMenu()
 
 void Visualization::OnMouseButtonDown(const SDL_Event& e)
 {
+    // Edits may overlap a running search, it reads the grid as published
+    // when it started
     if (!menu_open 
-            && aStar.getState() == EDITING
+            && !compare_mode
+            && !agent_mode
+            && aStar.getState() != FINISHED
             && aStar.getSelected() == NONE 
             && e.button.button == SDL_BUTTON_LEFT) {
         int x, y;
         SDL_GetMouseState(&x, &y);
         
         auto mouse_pos = aStar.mouseGetOver(x, y - menu_bar_height);
-        auto obstacles = aStar.getObstacles();
+        if (aStar.mouseOutOfBounds(mouse_pos)) {
+            return;
+        }
 
-        stack_pair.first = {mouse_pos};
         if (mouse_pos == aStar.getTarget()) {
             aStar.setSelected(TARGET);
-            stack_pair.second = MOVE_TARGET;
+            stroke_op = MOVE_TARGET;
         } else if (mouse_pos == aStar.getStart()) {
             aStar.setSelected(START);
-            stack_pair.second = MOVE_START;
-        } else if (obstacles.find(mouse_pos) != obstacles.end()) {
+            stroke_op = MOVE_START;
+        } else if (tool == TOOL_TARGETS) {
+            if (!aStar.isObstacle(mouse_pos)) {
+                edit_stack.Begin(TOGGLE_TARGET, false);
+                edit_stack.Append(mouse_pos);
+                edit_stack.Commit();
+                aStar.toggleTarget(mouse_pos);
+            }
+            return;
+        } else if (tool == TOOL_COST) {
+            cost_drag = true;
+            aStar.paintCost(mouse_pos, brush_radius, (u8)cost_value);
+            return;
+        } else if (tool == TOOL_FLOOD) {
+            bool value = !aStar.isObstacle(mouse_pos);
+
+            edit_stack.Begin(value ? INSERT_OBST : DELETE_OBST, false);
+            aStar.floodObstacles(mouse_pos, value, 
+                    [this](const std::pair<i32, i32>& cell) { edit_stack.Append(cell); });
+            edit_stack.Commit();
+            return;
+        } else if (tool != TOOL_BRUSH) {
+            region_drag   = true;
+            region_anchor = mouse_pos;
+            region_end    = mouse_pos;
+            return;
+        } else if (aStar.isObstacle(mouse_pos)) {
             aStar.setSelected(OBSTACLE);
             aStar.removeObstacle(mouse_pos);
-            stack_pair.second = DELETE_OBST;
+            stroke_op = DELETE_OBST;
         } else {
             aStar.setSelected(BLANCK);
             aStar.addObstacle(mouse_pos);
-            stack_pair.second = INSERT_OBST;
+            stroke_op = INSERT_OBST;
         }
+
+        edit_stack.Begin(stroke_op);
+        edit_stack.Append(mouse_pos);
     }
 }
 
 void Visualization::OnMouseButtonUp(const SDL_Event& e)
 {
-    int x, y;
-    SDL_GetMouseState(&x, &y);
-    auto mouse_pos = aStar.mouseGetOver(x, y - menu_bar_height);
+    if (cost_drag && e.button.button == SDL_BUTTON_LEFT) {
+        cost_drag = false;
+        return;
+    }
+
+    if (region_drag && e.button.button == SDL_BUTTON_LEFT) {
+        region_drag = false;
+        ApplyRegionTool();
+        return;
+    }
 
     if (aStar.getSelected() != NONE && e.button.button == SDL_BUTTON_LEFT) {
         aStar.setSelected(NONE);
 
-        if (stack_pair.second == MOVE_START || stack_pair.second == MOVE_TARGET) {
-            stack_pair.first.push_back(mouse_pos);
+        if (stroke_op == MOVE_START) {
+            edit_stack.Append(aStar.getStart());
+        } else if (stroke_op == MOVE_TARGET) {
+            edit_stack.Append(aStar.getTarget());
         }
 
-        edit_stack.WriteStack(stack_pair.first, stack_pair.second);
+        edit_stack.Commit();
     }
 }
 
@@ -357,30 +782,29 @@ void Visualization::OnMouseMotion(const SDL_Event& e)
             e.motion.y - menu_bar_height);
 
     if (!menu_open 
-            && aStar.getState() == EDITING
+            && !compare_mode
+            && !agent_mode
+            && aStar.getState() != FINISHED
             && !aStar.mouseOutOfBounds(mouse_pos)) {
         bool mouse_on_other_tile = aStar.mouseOnOtherTile(mouse_pos, aStar.getSelected());
 
-        if (aStar.getSelected() == START && !mouse_on_other_tile) {
+        if (region_drag) {
+            region_end = mouse_pos;
+        } else if (cost_drag) {
+            aStar.paintCost(mouse_pos, brush_radius, (u8)cost_value);
+        } else if (aStar.getSelected() == START && !mouse_on_other_tile) {
             aStar.setStart(mouse_pos);
         } else if (aStar.getSelected() == TARGET && !mouse_on_other_tile) {
             aStar.setTarget(mouse_pos);
         } else if (aStar.getSelected() == OBSTACLE && !mouse_on_other_tile) {
-            aStar.removeObstacle(mouse_pos);
-            stack_pair.first.push_back(mouse_pos);
-        } else if (aStar.getSelected() == BLANCK && !mouse_on_other_tile) {
-            bool added = false;
-            for (const auto& p : stack_pair.first) {
-                if (p == mouse_pos) {
-                    added = true;
-                    break;
-                }
+            if (aStar.isObstacle(mouse_pos)) {
+                aStar.removeObstacle(mouse_pos);
+                edit_stack.Append(mouse_pos);
             }
-
-            auto obsts = aStar.getObstacles();
-            if (obsts.find(mouse_pos) == obsts.end() && !added) {
+        } else if (aStar.getSelected() == BLANCK && !mouse_on_other_tile) {
+            if (!aStar.isObstacle(mouse_pos)) {
                 aStar.addObstacle(mouse_pos);
-                stack_pair.first.push_back(mouse_pos);
+                edit_stack.Append(mouse_pos);
             }
         }
     }
@@ -394,27 +818,45 @@ void Visualization::OnKeyDown(const SDL_Event& e)
     if (mod & KMOD_LCTRL || mod & KMOD_RCTRL) {
         switch (key) {
             case SDLK_r:
-                aStar.startSimulation();
+                if (compare_mode) {
+                    StartComparison();
+                } else if (agent_mode) {
+                    PlanAgents();
+                } else {
+                    aStar.startSimulation();
+                }
                 break;
 
             case SDLK_a:
-                if (aStar.getState() == SIMULATING) {
+                if (compare_mode) {
+                    comparison.cancel();
+                } else if (aStar.getState() == SIMULATING) {
                     aStar.setState(FINISHED);
                 } else {
                     aStar.setState(EDITING);
                 }
                 break;
 
+            // Clearing, undo and redo wait for a drag to end, its stroke is
+            // still open in the history
             case SDLK_d:
-                aStar.clearObstacles();
+                if (aStar.stateEditing() && !edit_stack.isRecording()) OnClearObstacles();
+                break;
+
+            case SDLK_s:
+                OnSaveScene();
+                break;
+
+            case SDLK_o:
+                if (!compare_mode) OnOpenScene();
                 break;
 
             case SDLK_z:
-                if (edit_stack.getUndoSize() > 0) OnUndo();
+                if (aStar.stateEditing() && !edit_stack.isRecording() && edit_stack.getUndoSize() > 0) OnUndo();
                 break;
 
             case SDLK_y:
-                if (edit_stack.getRedoSize() > 0) OnRedo();
+                if (aStar.stateEditing() && !edit_stack.isRecording() && edit_stack.getRedoSize() > 0) OnRedo();
                 break;
         }
     }
@@ -423,7 +865,7 @@ void Visualization::OnKeyDown(const SDL_Event& e)
 void Visualization::OnUndo()
 {
     short op;
-    auto data = edit_stack.Undo(&op);
+    const auto& data = edit_stack.Undo(&op);
 
     switch (op) {
         case MOVE_START:
@@ -443,13 +885,21 @@ void Visualization::OnUndo()
         case DELETE_OBST:
             aStar.addObstacle(data);
             break;
+
+        case INVERT_REGION:
+            aStar.invertObstacles(data[0], data[1]);
+            break;
+
+        case TOGGLE_TARGET:
+            aStar.toggleTarget(data[0]);
+            break;
     }
 }
 
 void Visualization::OnRedo()
 {
     short op;
-    auto data = edit_stack.Redo(&op);
+    const auto& data = edit_stack.Redo(&op);
 
     switch (op) {
         case MOVE_START:
@@ -469,171 +919,172 @@ void Visualization::OnRedo()
                 aStar.removeObstacle(p);
             }
             break;
-            
+
+        case INVERT_REGION:
+            aStar.invertObstacles(data[0], data[1]);
+            break;
+
+        case TOGGLE_TARGET:
+            aStar.toggleTarget(data[0]);
+            break;
     }
 }
 
-void Visualization::DrawAStar()
+void Visualization::OnClearObstacles()
 {
-    i32 dl = (i32)aStar.getDeltaLength();
+    edit_stack.Begin(DELETE_OBST, false);
+    aStar.getGrid().forEachObstacle(
+            [this](const std::pair<i32, i32>& cell) { edit_stack.Append(cell); });
+    edit_stack.Commit();
 
-    DrawObstacles(dl);
-    DrawState(dl);
-    DrawStartTarget(dl);
-    DrawGrid(dl);
+    aStar.clearObstacles();
 }
 
-void Visualization::DrawObstacles(i32 dl)
+void Visualization::OnSaveScene()
 {
-    ImVec4 color;
-    SDL_Rect rect;
-
-    // Draw Obstacles
-    color = aStar.getObstacleColor();
-    SDL_SetRenderDrawColor(renderer, 
-            (Uint8)(color.x * 255), 
-            (Uint8)(color.y * 255), 
-            (Uint8)(color.z * 255), 
-            (Uint8)(color.w * 255));
+    Scene scene = aStar.toScene();
+    scene.colors[COLOR_BACKGROUND] = {background_color.x, background_color.y, background_color.z, background_color.w};
+
+    try {
+        saveScene(scene_path, scene);
+        scene_status = std::string("Saved ") + scene_path;
+
+        // Preprocessed data is kept next to the scene from now on
+        EngineConfig config = aStar.getEngineConfig();
+        config.data_path = scene_path;
+        aStar.setEngineConfig(config);
+    } catch (const std::exception& e) {
+        scene_status = e.what();
+    }
+}
 
-    auto obstacles = aStar.getObstacles();
-    for (const auto& obstacle : obstacles) {
-        rect = {obstacle.first * dl, menu_bar_height + obstacle.second * dl, dl, dl};
-        SDL_RenderFillRect(renderer, &rect);
+void Visualization::OnOpenScene()
+{
+    try {
+        OpenScene(scene_path);
+        scene_status = std::string("Opened ") + scene_path;
+    } catch (const std::exception& e) {
+        scene_status = e.what();
     }
 }
 
-void Visualization::DrawState(i32 dl)
+void Visualization::OpenScene(const std::string& path)
 {
-    ImVec4 color;
-    SDL_Rect rect;
+    Scene scene;
+    loadScene(path, scene);
+
+    // The largest cells that fit, scenes saved by the editor fill the window
+    auto [w, h] = scene.grid.getDimensions();
+    i32 delta_length = std::min<i32>(WIDTH / w, HEIGHT / h);
+    if (delta_length < 1) {
+        throw std::runtime_error(path + ": the grid does not fit into the window");
+    }
 
-    // Draw Current State Of A*
-    short state = aStar.getState();
-    if (state == SIMULATING || state == FINISHED) {
-        auto openSet   = aStar.getOpenSet();
-        auto closedSet = aStar.getClosedSet();
+    aStar.applyScene(scene);
+    aStar.setDeltaLength(delta_length);
 
-        color = aStar.getOpenColor();
-        SDL_SetRenderDrawColor(renderer, 
-                (Uint8)(color.x * 255), 
-                (Uint8)(color.y * 255), 
-                (Uint8)(color.z * 255), 
-                (Uint8)(color.w * 255));
-
-        for (const auto& tile : openSet) {
-            rect = {tile.second.first * dl, menu_bar_height + tile.second.second * dl, dl, dl};
-            SDL_RenderFillRect(renderer, &rect);
-        }
+    EngineConfig config = aStar.getEngineConfig();
+    config.data_path = path;
+    aStar.setEngineConfig(config);
 
-        for (const auto& tile : closedSet) {
-            if (aStar.closedColorIsStatic()) {
-                color = aStar.getClosedColor();
-            } else {
-                i32 heuristic = aStar.getHeuristic(tile, aStar.getTarget());
-                color = HSL2RGB(
-                        (heuristic / aStar.getScalar()) % 360, 
-                        1.0f, 
-                        0.5f);
-            }
+    const auto& back = scene.colors[COLOR_BACKGROUND];
+    background_color = {back[0], back[1], back[2], back[3]};
 
-            SDL_SetRenderDrawColor(renderer, 
-                    (Uint8)(color.x * 255), 
-                    (Uint8)(color.y * 255), 
-                    (Uint8)(color.z * 255), 
-                    (Uint8)(color.w * 255));
+    // The history and the agents refer to cells of the old grid
+    edit_stack = EditStack();
+    region_drag = cost_drag = false;
+    agent_tasks.clear();
+    agent_plan = AgentPlan();
 
-            rect = {tile.first * dl, menu_bar_height + tile.second * dl, dl, dl};
-            SDL_RenderFillRect(renderer, &rect);
-        }
-    }
+    snprintf(scene_path, sizeof(scene_path), "%s", path.c_str());
+}
 
-    // Draw A* Result
-    if (state == FINISHED) {
-        auto final_path = aStar.getFinalPath();
-        SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-        
-        std::pair<i32, i32> previous = {-1, -1};
-        for (const auto& tile : final_path) {
-            if (previous == std::pair<i32, i32>(-1, -1)) {
-                previous = tile;
-                continue;
-            }
+void Visualization::ApplyRegionTool()
+{
+    auto record = [this](const std::pair<i32, i32>& cell) { edit_stack.Append(cell); };
 
-            SDL_RenderDrawLine(renderer, 
-                    previous.first  * dl + dl / 2, 
-                    previous.second * dl + dl / 2 + menu_bar_height,
-                    tile.first  * dl + dl / 2, 
-                    tile.second * dl + dl / 2 + menu_bar_height
-                    );
+    switch (tool) {
+        case TOOL_RECT:
+            edit_stack.Begin(INSERT_OBST, false);
+            aStar.fillObstacles(region_anchor, region_end, true, record);
+            edit_stack.Commit();
+            break;
 
-            previous = tile;
-        }
+        case TOOL_LINE:
+            edit_stack.Begin(INSERT_OBST, false);
+            aStar.lineObstacles(region_anchor, region_end, true, record);
+            edit_stack.Commit();
+            break;
+
+        case TOOL_INVERT:
+            // Inverting is its own inverse, the corners are all we need
+            aStar.invertObstacles(region_anchor, region_end);
+            edit_stack.WriteStack({region_anchor, region_end}, INVERT_REGION);
+            break;
     }
 }
 
-void Visualization::DrawStartTarget(i32 dl)
+void Visualization::DrawAStar()
 {
-    ImVec4 color;
-    SDL_Rect rect;
+    if (compare_mode) {
+        DrawComparison();
+        return;
+    }
 
-    // Draw Start/Target
-    auto start  = aStar.getStart();
-    auto target = aStar.getTarget();
+    painter.setTop(menu_bar_height);
+    painter.Draw(aStar);
 
-    // Start
-    color = aStar.getStartColor();
-    SDL_SetRenderDrawColor(renderer, 
-            (Uint8)(color.x * 255), 
-            (Uint8)(color.y * 255), 
-            (Uint8)(color.z * 255), 
-            (Uint8)(color.w * 255));
+    if (agent_mode) {
+        double time = (double)(SDL_GetTicks() - agent_clock) / agent_step_ms;
+        painter.DrawAgents(aStar, agent_tasks, agent_plan, time);
+    }
 
-    rect = {start.first * dl, menu_bar_height + start.second * dl, dl, dl};
-    SDL_RenderFillRect(renderer, &rect);
+    DrawToolPreview((i32)aStar.getDeltaLength());
+}
 
-    // Target
-    color = aStar.getTargetColor();
-    SDL_SetRenderDrawColor(renderer, 
-            (Uint8)(color.x * 255), 
-            (Uint8)(color.y * 255), 
-            (Uint8)(color.z * 255), 
-            (Uint8)(color.w * 255));
+// Two panels side by side, three or four in the quadrants of the window
+SDL_Rect Visualization::LanePanel(size_t lane) const
+{
+    i32 w = WIDTH / 2;
+    i32 h = (HEIGHT - menu_bar_height) / 2;
+    i32 y = menu_bar_height;
 
-    rect = {target.first * dl, menu_bar_height + target.second * dl, dl, dl};
-    SDL_RenderFillRect(renderer, &rect);
+    if (comparison.size() <= 2) {
+        y += h / 2;
+    }
+
+    return {(i32)(lane % 2) * w, y + (i32)(lane / 2) * h, w, h};
 }
 
-void Visualization::DrawGrid(i32 dl)
+void Visualization::DrawComparison()
 {
-    ImVec4 color;
-    SDL_Rect rect;
+    for (size_t i = 0; i < comparison.size(); i++) {
+        painter.DrawLane(aStar, comparison, i, LanePanel(i));
+    }
+}
 
-    // Draw Grid
-    if (aStar.gridIsShown()) {
-        color = aStar.getGridColor();
-        SDL_SetRenderDrawColor(renderer, 
-                (Uint8)(color.x * 255), 
-                (Uint8)(color.y * 255), 
-                (Uint8)(color.z * 255), 
-                (Uint8)(color.w * 255));
+void Visualization::DrawToolPreview(i32 dl)
+{
+    if (!region_drag) {
+        return;
+    }
 
-        auto dims = aStar.getDimensions();
-        for (i32 i = 1; i < dims.first; i++) {
-            SDL_RenderDrawLine(renderer, 
-                    i * dl, 
-                    menu_bar_height, 
-                    i * dl, 
-                    menu_bar_height + HEIGHT);
-        }
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 
-        for (i32 i = 1; i < dims.second; i++) {
-            SDL_RenderDrawLine(renderer, 
-                    0, 
-                    menu_bar_height + i * dl, 
-                    WIDTH, 
-                    menu_bar_height + i * dl);
-        }
+    if (tool == TOOL_LINE) {
+        Grid::walkLine(region_anchor, region_end, [&](const std::pair<i32, i32>& cell) {
+            SDL_Rect rect = {cell.first * dl, menu_bar_height + cell.second * dl, dl, dl};
+            SDL_RenderDrawRect(renderer, &rect);
+            return true;
+        });
+    } else {
+        i32 x0 = std::min(region_anchor.first,  region_end.first);
+        i32 y0 = std::min(region_anchor.second, region_end.second);
+        i32 x1 = std::max(region_anchor.first,  region_end.first);
+        i32 y1 = std::max(region_anchor.second, region_end.second);
+
+        SDL_Rect rect = {x0 * dl, menu_bar_height + y0 * dl, (x1 - x0 + 1) * dl, (y1 - y0 + 1) * dl};
+        SDL_RenderDrawRect(renderer, &rect);
     }
 }
 
@@ -645,46 +1096,3 @@ void Visualization::run()
         Render();
     }
 }
-
-ImVec4 HSL2RGB(double h, double s, double l)
-{
-    // Formula From: https://dystopiancode.blogspot.com/2012/06/hsl-rgb-conversion-algorithms-in-c.html
-
-    double r, g, b;
-    r = g = b = 0;
-
-    double c, x, m;
-
-    c = (1.0f - fabs(2.0f * l - 1.0f)) * s;
-    x = c * (1.0f - fabs(fmod(h / 60.0f, 2) - 1.0f));
-    m = l - c * 0.5f;
-
-    if (0 <= h && h < 60.0f) {
-        r = c;
-        g = x;
-    } else if (60.0f <= h && h < 120.0f) {
-        r = x;
-        g = c;
-    } else if (120.0f <= h && h < 180.0f) {
-        g = c;
-        b = x;
-    } else if (180.0f <= h && h < 240.0f) {
-        g = x;
-        b = c;
-    } else if (240.0f <= h && h < 300.0f) {
-        r = x;
-        b = c;
-    } else {
-        r = c;
-        b = x;
-    }
-
-    ImVec4 color = {
-        static_cast<float>(r + m), 
-        static_cast<float>(g + m), 
-        static_cast<float>(b + m), 
-        1.0f
-    };
-    
-    return color;
-}
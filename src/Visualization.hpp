@@ -1,6 +1,8 @@
 #ifndef VISUALIZATION_HPP
 #define VISUALIZATION_HPP
 
+#include <random>
+
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
@@ -11,6 +13,19 @@
 #include "Util.hpp"
 #include "AStar.hpp"
 #include "EditStack.hpp"
+#include "Painter.hpp"
+#include "Comparison.hpp"
+#include "Cooperative.hpp"
+
+enum EditTools {
+    TOOL_BRUSH,
+    TOOL_RECT,
+    TOOL_LINE,
+    TOOL_FLOOD,
+    TOOL_INVERT,
+    TOOL_COST,
+    TOOL_TARGETS
+};
 
 class Visualization {
 
@@ -26,13 +41,46 @@ class Visualization {
         SDL_Window* window;
 
         AStar aStar;
+        Painter painter;
 
         i32 menu_bar_height;
         ImVec4 background_color;
 
-        std::pair<std::vector<std::pair<i32, i32>>, short> stack_pair;
+        short stroke_op;
         EditStack edit_stack;
 
+        short tool = TOOL_BRUSH;
+        bool region_drag = false;
+        std::pair<i32, i32> region_anchor;
+        std::pair<i32, i32> region_end;
+
+        bool cost_drag = false;
+        i32 cost_value = 5;
+        i32 brush_radius = 1;
+
+        // Compare mode replaces the grid by one panel per engine
+        bool compare_mode = false;
+        i32 compare_count = 2;
+        std::vector<LaneConfig> compare_lanes;
+        Comparison comparison;
+
+        // Agent mode plans a group of agents on the grid and plays their
+        // moves back together, one timestep every 'agent_step_ms'
+        bool agent_mode = false;
+        i32 agent_count = 16;
+        i32 agent_window = 16;     // 0 plans every agent in full
+        i32 agent_step_ms = 250;
+        std::vector<AgentTask> agent_tasks;
+        AgentPlan agent_plan;
+        u32 agent_clock = 0;        // SDL ticks at timestep 0
+        std::mt19937 agent_rng;
+        std::string agent_status;
+
+        // Scene file named in the File menu, and the outcome of the last
+        // save or open
+        char scene_path[256] = "scene.astar";
+        std::string scene_status;
+
         // Init
         void InitSdl();
         void InitImGui();
@@ -45,8 +93,16 @@ class Visualization {
         // Menu Bar
         void MenuBar();
         void ResizeWindow();
+        void FileMenu();
         void EditMenu();
         void RunMenu();
+        void CompareMenu();
+        void CompareTable();
+        void StartComparison();
+        void AgentMenu();
+        void PlaceAgents();
+        void PlanAgents();
+        void ToolMenu();
         void GridMenu();
         void ColorMenu();
 
@@ -59,13 +115,18 @@ class Visualization {
         // Undo / Redo Operations Methods 
         void OnUndo();
         void OnRedo();
+        void OnClearObstacles();
+        void ApplyRegionTool();
+
+        // Scenes
+        void OnSaveScene();
+        void OnOpenScene();
 
         // Draw 
         void DrawAStar();
-        void DrawObstacles(i32 dl);
-        void DrawState(i32 dl);
-        void DrawStartTarget(i32 dl);
-        void DrawGrid(i32 dl);
+        void DrawComparison();
+        SDL_Rect LanePanel(size_t lane) const;
+        void DrawToolPreview(i32 dl);
 
 
     public:
@@ -74,8 +135,11 @@ class Visualization {
         
         void run();
 
-};
+        // Replaces the grid, the colors and the edit history by the scene
+        // in 'path'. Throws std::runtime_error if it cannot be read or does
+        // not fit into the window.
+        void OpenScene(const std::string& path);
 
-ImVec4 HSL2RGB(double h, double s, double l);
+};
 
 #endif //VISUALIZATION_HPP
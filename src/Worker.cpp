@@ -0,0 +1,72 @@
+#include "Worker.hpp"
+
+Worker::Worker()
+{
+    thread = std::thread([this] { loop(); });
+}
+
+Worker::~Worker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    cancelAll();
+    wake.notify_one();
+    thread.join();
+}
+
+void Worker::loop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (stopping && jobs.empty()) return;
+
+        auto [job, token] = std::move(jobs.front());
+        jobs.pop_front();
+
+        running = token;
+        busy = true;
+        lock.unlock();
+
+        if (!token.cancelled()) job(token);
+
+        lock.lock();
+        busy = false;
+
+        if (jobs.empty()) idle.notify_all();
+    }
+}
+
+CancelToken Worker::submit(Job job)
+{
+    CancelToken token;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({std::move(job), token});
+    }
+    wake.notify_one();
+
+    return token;
+}
+
+void Worker::cancelAll()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto& entry : jobs) entry.second.cancel();
+    jobs.clear();
+
+    if (busy) running.cancel();
+
+    idle.notify_all();
+}
+
+void Worker::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return !busy && jobs.empty(); });
+}
@@ -0,0 +1,67 @@
+#ifndef WORKER_HPP
+#define WORKER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "Util.hpp"
+
+// Cooperative cancellation flag shared between whoever started a job and the
+// job itself. Copies refer to the same flag.
+class CancelToken {
+
+    private:
+        std::shared_ptr<std::atomic<bool>> flag;
+
+    public:
+        CancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+        inline void cancel() const { flag->store(true, std::memory_order_relaxed); }
+        inline bool cancelled() const { return flag->load(std::memory_order_relaxed); }
+
+};
+
+// A single long-lived thread running jobs in submission order. Jobs are
+// expected to poll their token and return early once it is cancelled.
+// The destructor cancels whatever is left and joins the thread.
+class Worker {
+
+    public:
+        typedef std::function<void(const CancelToken&)> Job;
+
+    private:
+        std::thread thread;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+
+        std::deque<std::pair<Job, CancelToken>> jobs;
+        CancelToken running;    // Token of the job being run
+        bool busy = false;
+        bool stopping = false;
+
+        void loop();
+
+    public:
+        Worker();
+        ~Worker();
+
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        // Queues 'job', the returned token cancels it
+        CancelToken submit(Job job);
+
+        // Cancels the running job and drops the queued ones
+        void cancelAll();
+
+        // Blocks until no job is queued or running
+        void wait();
+
+};
+
+#endif //WORKER_HPP
@@ -0,0 +1,160 @@
+/*
+ * libastar: the search engines of A-Star behind a C ABI, without SDL or
+ * ImGui. Build it with 'make lib', which writes bin/libastar.a and
+ * bin/libastar.so.
+ *
+ * Grids are bitmaps of obstacles: 'height' rows of ASTAR_GRID_WORDS(width)
+ * 64 bit words, bit x % 64 of word x / 64 set if cell x of the row is
+ * blocked. A grid either owns its bitmap or works in place on a buffer of
+ * the caller. Cells outside of the grid count as blocked.
+ *
+ * Functions that can fail return ASTAR_OK or a negative astar_status, or
+ * NULL, and leave a message for astar_last_error(). A grid may be searched
+ * from several threads at once while nobody edits it. An engine keeps its
+ * scratch memory between searches and must only be used by one thread at
+ * a time.
+ */
+
+#ifndef LIBASTAR_H
+#define LIBASTAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define ASTAR_API __attribute__((visibility("default")))
+#else
+#define ASTAR_API
+#endif
+
+/* Bumped on every incompatible change of this header */
+#define ASTAR_ABI_VERSION 2
+
+#define ASTAR_GRID_WORDS(width) (((width) + 63) / 64)
+
+typedef enum astar_status {
+    ASTAR_OK             =  0,
+    ASTAR_ERROR_ARGUMENT = -1,  /* Null handle, bad size, cell outside of the grid */
+    ASTAR_ERROR_ENGINE   = -2,  /* Unknown engine name */
+    ASTAR_ERROR_INTERNAL = -3   /* Out of memory and the like */
+} astar_status;
+
+/* astar_result.status */
+typedef enum astar_outcome {
+    ASTAR_FOUND     = 0,
+    ASTAR_NO_PATH   = 1,
+    ASTAR_TIMED_OUT = 2,    /* Budget ran out, a path may still have been found */
+    ASTAR_INVALID   = 3     /* Start or target outside of the grid or blocked */
+} astar_outcome;
+
+/* astar_engine_config.layout */
+typedef enum astar_layout {
+    ASTAR_LAYOUT_ROWS   = 0,
+    ASTAR_LAYOUT_TILES  = 1,
+    ASTAR_LAYOUT_MORTON = 2
+} astar_layout;
+
+typedef struct astar_grid astar_grid;
+typedef struct astar_engine astar_engine;
+
+typedef struct astar_engine_config {
+    const char* name;       /* astar, dijkstra, greedy, ara, ida, sma, theta, lazytheta,
+                               padded, padded8, subgoal, cpd */
+    double weight;          /* Weighted A* */
+    double epsilon;         /* ARA*, initial heuristic inflation */
+    double epsilon_step;    /* ARA*, decrease per pass */
+    size_t node_cap;        /* SMA*, most nodes kept in memory */
+    size_t table_size;      /* IDA*, transposition table entries */
+    int32_t layout;         /* astar_layout, A*, Dijkstra and greedy */
+} astar_engine_config;
+
+typedef struct astar_query {
+    int32_t start_x, start_y;
+    int32_t target_x, target_y;
+    double budget_ms;       /* 0 for none */
+} astar_query;
+
+typedef struct astar_result {
+    int32_t status;         /* astar_outcome */
+    int32_t truncated;      /* 1 if the path did not fit into the path buffer */
+    int64_t cost;           /* 10 per step times the terrain cost entered */
+    double epsilon;         /* The cost is at most epsilon times the optimum */
+    uint64_t path_offset;   /* First cell of the path in the path buffer */
+    uint64_t path_length;   /* Cells written */
+    uint64_t path_cells;    /* Cells of the whole path */
+    uint64_t expanded;
+    double elapsed_ms;
+} astar_result;
+
+ASTAR_API int32_t astar_abi_version(void);
+
+/* Message of the last error on the calling thread, empty if there was none */
+ASTAR_API const char* astar_last_error(void);
+
+/* Grids */
+ASTAR_API astar_grid* astar_grid_create(int32_t width, int32_t height);
+
+/* Zero-copy: searches and edits work on 'bits' directly, which must hold
+ * height * ASTAR_GRID_WORDS(width) words and outlive the grid. Bits past
+ * the width of a row are cleared. */
+ASTAR_API astar_grid* astar_grid_wrap(int32_t width, int32_t height, uint64_t* bits);
+
+ASTAR_API void astar_grid_destroy(astar_grid* grid);
+
+ASTAR_API int32_t astar_grid_width(const astar_grid* grid);
+ASTAR_API int32_t astar_grid_height(const astar_grid* grid);
+
+/* 1 if blocked, 0 if free, negative astar_status on error */
+ASTAR_API int32_t astar_grid_get(const astar_grid* grid, int32_t x, int32_t y);
+
+ASTAR_API int32_t astar_grid_set(astar_grid* grid, int32_t x, int32_t y, int32_t blocked);
+
+/* Sets or clears the rectangle between both corners, clipped to the grid */
+ASTAR_API int32_t astar_grid_fill(astar_grid* grid, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t blocked);
+
+ASTAR_API int32_t astar_grid_clear(astar_grid* grid);
+
+/* Terrain cost of entering the cell, 1 to 255 */
+ASTAR_API int32_t astar_grid_set_cost(astar_grid* grid, int32_t x, int32_t y, uint8_t cost);
+
+/* Call after writing the bits of a wrapped grid directly, batches and
+ * engines keep data derived from the grid, like its connected components,
+ * and rebuild it only when told of a change */
+ASTAR_API int32_t astar_grid_touch(astar_grid* grid);
+
+/* Engines */
+ASTAR_API void astar_engine_config_default(astar_engine_config* config);
+/* NULL on failure, with ASTAR_ERROR_ENGINE in 'status' for an unknown name
+ * or ASTAR_ERROR_ARGUMENT for a bad config. 'status' may be NULL. */
+ASTAR_API astar_engine* astar_engine_create(const astar_engine_config* config, int32_t* status);
+ASTAR_API void astar_engine_destroy(astar_engine* engine);
+
+/* Runs 'count' queries and fills one result per query. The cells of the
+ * paths are written one after another into 'path_xy' as x, y pairs, which
+ * holds 'path_capacity' cells. A path that does not fit is left out and
+ * marked as truncated, the following ones are still written if they fit.
+ * 'path_xy' may be NULL if 'path_capacity' is 0. Start and target in
+ * different connected components are ASTAR_NO_PATH without a search.
+ *
+ * 'threads' queries are searched at once, 0 for one per core; the engine
+ * is cloned for every extra thread and the clones are kept for the next
+ * batch. Returns ASTAR_OK or a negative astar_status. */
+ASTAR_API int32_t astar_search_batch(
+        astar_engine* engine,
+        const astar_grid* grid,
+        const astar_query* queries,
+        size_t count,
+        astar_result* results,
+        int32_t* path_xy,
+        size_t path_capacity,
+        uint32_t threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBASTAR_H */
@@ -1,13 +1,41 @@
 #include <stdexcept>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
+#include "Options.hpp"
+#include "Headless.hpp"
+#include "Recorder.hpp"
+#include "Server.hpp"
 #include "Visualization.hpp"
 
-int main() 
+int main(int argc, char** argv) 
 {
     try {
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+                printUsage(std::cout);
+                return EXIT_SUCCESS;
+            }
+        }
+
+        Options options = parseOptions(argc, argv);
+        if (!options.serve.empty()) {
+            return runServer(options);
+        }
+
+        if (!options.record_dir.empty() || !options.record_raw.empty()) {
+            return runRecording(options);
+        }
+
+        if (options.headless) {
+            return runHeadless(options);
+        }
+
         Visualization app;
+        if (!options.scene.empty()) {
+            app.OpenScene(options.scene);
+        }
         app.run();
 
     } catch (const std::exception& e) {